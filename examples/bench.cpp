@@ -0,0 +1,533 @@
+// Load generator for unary calls, against an in-process Greeter server
+// unless --target is given. Prints one JSON object with the results.
+//
+// usage: bench [--mode=closed|open] [--concurrency=64] [--rate=20000]
+//              [--connections=4] [--threads=2] [--server-threads=2]
+//              [--payload=16] [--seconds=10] [--warmup=2]
+//              [--target=host:port] [--method=/pkg.Service/Method]
+//              [--request=file] [--keys=0] [--zipf=1.0] [--work-us=0]
+//              [--server-cache=0] [--cache-ttl-ms=1000]
+//              [--server=typed|generic]
+//
+// closed: `concurrency` calls in flight at all times.
+// open:   calls are due at `rate` per second whether or not earlier ones
+//         finished. Past `concurrency` in flight, due calls queue up and
+//         start as earlier ones complete. Latency counts from when a call
+//         was due, so a stalled client or server does not hide the stall
+//         (coordinated omission). Calls still queued when the measurement
+//         ends never started: they count as errors, and as "dropped".
+//
+// Without --method the typed SayHello with a `payload` bytes name is used.
+// With it, the call goes through a generic stub and sends the serialized
+// request in --request (a SayHello request by default).
+//
+// With --keys, typed calls pick one of `keys` names by a Zipf distribution of
+// exponent `zipf`, a few hot keys and a long tail. The in-process handler
+// spins for `work-us` per call, and with --server-cache=1 its replies are
+// cached for `cache-ttl-ms` (see `call_options::cache`).
+//
+// --server=generic serves every method through `async_generic_call_data`
+// instead, echoing the request bytes unparsed, to compare the CPU per call
+// against the typed path across payload sizes (SayHello's request and reply
+// have the same layout).
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <random>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <async_grpc/grpc_executor.h>
+#include <async_grpc/generic_server.h>
+#include <async_grpc/grpc_sharded_executor.h>
+#include <async_grpc/metrics.h>
+#include <async_grpc/response_cache.h>
+#include <async_grpc/rpcs.h>
+#include <grpcpp/generic/generic_stub.h>
+#include <grpcpp/grpcpp.h>
+#include <unifex/inplace_stop_token.hpp>
+#include <unifex/scheduler_concepts.hpp>
+#include <unifex/task.hpp>
+#include <sys/resource.h>
+#include <helloworld/helloworld.grpc.pb.h>
+#include <helloworld/helloworld.pb.h>
+
+// every allocation of the process, client and server alike
+constinit agrpc::sharded_counter g_allocs;
+
+void* operator new(std::size_t n) {
+    g_allocs.add();
+    if (void* p = std::malloc(n == 0 ? 1 : n)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+
+namespace {
+
+using clock_type = std::chrono::steady_clock;
+
+struct config {
+    std::string mode = "closed";
+    int concurrency = 64;
+    double rate = 20000;
+    std::size_t connections = 4;
+    std::size_t threads = 2;
+    std::size_t server_threads = 2;
+    std::size_t payload = 16;
+    int seconds = 10;
+    int warmup = 2;
+    std::string target;
+    std::string method;
+    std::string request;
+    std::size_t keys = 0;
+    double zipf = 1.0;
+    int work_us = 0;
+    bool server_cache = false;
+    int cache_ttl_ms = 1000;
+    std::string server = "typed";
+};
+
+bool parse(int argc, char** argv, config& c) {
+    for (int i = 1; i < argc; ++i) {
+        std::string_view arg = argv[i];
+        auto eq = arg.find('=');
+        if (arg.substr(0, 2) != "--" || eq == std::string_view::npos) {
+            std::cerr << "bad argument: " << arg << std::endl;
+            return false;
+        }
+        auto key = arg.substr(2, eq - 2);
+        auto value = std::string(arg.substr(eq + 1));
+        if (key == "mode") {
+            c.mode = value;
+        } else if (key == "concurrency") {
+            c.concurrency = std::atoi(value.c_str());
+        } else if (key == "rate") {
+            c.rate = std::atof(value.c_str());
+        } else if (key == "connections") {
+            c.connections = std::strtoul(value.c_str(), nullptr, 10);
+        } else if (key == "threads") {
+            c.threads = std::strtoul(value.c_str(), nullptr, 10);
+        } else if (key == "server-threads") {
+            c.server_threads = std::strtoul(value.c_str(), nullptr, 10);
+        } else if (key == "payload") {
+            c.payload = std::strtoul(value.c_str(), nullptr, 10);
+        } else if (key == "seconds") {
+            c.seconds = std::atoi(value.c_str());
+        } else if (key == "warmup") {
+            c.warmup = std::atoi(value.c_str());
+        } else if (key == "target") {
+            c.target = value;
+        } else if (key == "method") {
+            c.method = value;
+        } else if (key == "request") {
+            c.request = value;
+        } else if (key == "keys") {
+            c.keys = std::strtoul(value.c_str(), nullptr, 10);
+        } else if (key == "zipf") {
+            c.zipf = std::atof(value.c_str());
+        } else if (key == "work-us") {
+            c.work_us = std::atoi(value.c_str());
+        } else if (key == "server-cache") {
+            c.server_cache = std::atoi(value.c_str()) != 0;
+        } else if (key == "cache-ttl-ms") {
+            c.cache_ttl_ms = std::atoi(value.c_str());
+        } else if (key == "server") {
+            c.server = value;
+        } else {
+            std::cerr << "unknown option: " << key << std::endl;
+            return false;
+        }
+    }
+    if (c.mode != "closed" && c.mode != "open") {
+        std::cerr << "--mode is closed or open" << std::endl;
+        return false;
+    }
+    if (c.server != "typed" && c.server != "generic") {
+        std::cerr << "--server is typed or generic" << std::endl;
+        return false;
+    }
+    c.connections = std::max<std::size_t>(c.connections, 1);
+    c.threads = std::max<std::size_t>(c.threads, 1);
+    c.server_threads = std::max<std::size_t>(c.server_threads, 1);
+    return c.rate > 0 && c.concurrency > 0;
+}
+
+struct load {
+    std::atomic<bool> stop{false};
+    std::atomic<bool> measuring{false};
+    std::atomic<int> active{0};
+    agrpc::sharded_counter done;
+    agrpc::sharded_counter failed;
+    // open loop calls that were due but never started, counted in `failed`
+    agrpc::sharded_counter dropped;
+    agrpc::histogram latency;
+
+    void record(bool ok, clock_type::duration d) noexcept {
+        if (!measuring.load(std::memory_order_relaxed)) {
+            return;
+        }
+        if (ok) {
+            done.add();
+            latency.record(static_cast<std::uint64_t>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(d).count()));
+        } else {
+            failed.add();
+        }
+    }
+};
+
+// Key `i` with probability proportional to 1 / (i + 1)^s.
+class zipf_keys {
+public:
+    zipf_keys(std::size_t n, double s) : cdf_(n) {
+        double sum = 0;
+        for (std::size_t i = 0; i < n; ++i) {
+            sum += 1 / std::pow(static_cast<double>(i + 1), s);
+            cdf_[i] = sum;
+        }
+        for (auto& p : cdf_) {
+            p /= sum;
+        }
+    }
+
+    std::size_t next() const {
+        thread_local std::minstd_rand rng(std::random_device{}());
+        std::uniform_real_distribution<double> u(0, 1);
+        auto it = std::lower_bound(cdf_.begin(), cdf_.end(), u(rng));
+        return std::min<std::size_t>(it - cdf_.begin(), cdf_.size() - 1);
+    }
+
+private:
+    std::vector<double> cdf_;
+};
+
+// One stub per connection, typed or generic.
+struct client {
+    std::vector<std::unique_ptr<helloworld::Greeter::Stub>> stubs;
+    std::vector<std::unique_ptr<grpc::GenericStub>> generic;
+    helloworld::HelloRequest request;
+    grpc::ByteBuffer raw_request;
+    std::string method;
+    // with --keys
+    std::vector<helloworld::HelloRequest> keyed;
+    std::unique_ptr<zipf_keys> zipf;
+
+    unifex::task<bool> call(agrpc::grpc_executor& ex, std::size_t conn) {
+        if (method.empty()) {
+            auto r = co_await agrpc::async_client_call<helloworld::HelloReply>(
+                ex,
+                &helloworld::Greeter::Stub::AsyncSayHello,
+                stubs[conn].get(),
+                zipf ? keyed[zipf->next()] : request);
+            co_return r.has_value();
+        }
+
+        grpc::ClientContext context;
+        grpc::ByteBuffer reply;
+        grpc::Status status;
+        std::unique_ptr<grpc::GenericClientAsyncResponseReader> responder;
+        bool ok = co_await ex.async([&](grpc::CompletionQueue* cq, void* tag) {
+            responder = generic[conn]->PrepareUnaryCall(&context, method, raw_request, cq);
+            responder->StartCall();
+            responder->Finish(&reply, &status, tag);
+        });
+        co_return ok && status.ok();
+    }
+};
+
+unifex::task<void> closed_worker(agrpc::grpc_executor& ex,
+                                 client& c,
+                                 std::size_t conn,
+                                 load& l) {
+    while (!l.stop.load(std::memory_order_relaxed)) {
+        auto start = clock_type::now();
+        bool ok = co_await c.call(ex, conn);
+        l.record(ok, clock_type::now() - start);
+    }
+    l.active.fetch_sub(1, std::memory_order_release);
+}
+
+unifex::task<void> open_call(agrpc::grpc_executor& ex,
+                             client& c,
+                             std::size_t conn,
+                             load& l,
+                             clock_type::time_point intended) {
+    bool ok = co_await c.call(ex, conn);
+    l.record(ok, clock_type::now() - intended);
+    l.active.fetch_sub(1, std::memory_order_release);
+}
+
+// Starts calls of one client shard at `rate` per second, over the
+// connections `first`, `first + stride`, ...
+unifex::task<void> open_pacer(agrpc::grpc_executor& ex,
+                              client& c,
+                              std::size_t first,
+                              std::size_t stride,
+                              load& l,
+                              double rate,
+                              int max_outstanding) {
+    auto interval = std::chrono::nanoseconds(static_cast<std::int64_t>(1e9 / rate));
+    auto next = clock_type::now();
+    std::size_t conn = first;
+    bool measured = false;
+    while (!l.stop.load(std::memory_order_relaxed)) {
+        auto now = clock_type::now();
+        bool measuring = l.measuring.load(std::memory_order_relaxed);
+        if (measured && !measuring) {
+            // the measurement is over, what is still queued never started
+            for (; next <= now; next += interval) {
+                l.failed.add();
+                l.dropped.add();
+            }
+        }
+        measured = measuring;
+        // timers tick in milliseconds, start everything that is due
+        while (next <= now && l.active.load(std::memory_order_relaxed) < max_outstanding) {
+            l.active.fetch_add(1, std::memory_order_relaxed);
+            ex.spawn_local(open_call(ex, c, conn, l, next));
+            conn = conn + stride < c.stubs.size() ? conn + stride : first;
+            next += interval;
+        }
+        if (next <= now) {
+            // `max_outstanding` in flight, the due calls wait for a slot
+            co_await unifex::schedule_after(ex.get_grpc_scheduler(),
+                                            std::chrono::microseconds(100));
+        } else {
+            co_await unifex::schedule_at(ex.get_grpc_scheduler(), next);
+        }
+    }
+    l.active.fetch_sub(1, std::memory_order_release);
+}
+
+std::uint64_t cpu_micros() {
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    auto us = [](const timeval& tv) {
+        return static_cast<std::uint64_t>(tv.tv_sec) * 1000000 + tv.tv_usec;
+    };
+    return us(usage.ru_utime) + us(usage.ru_stime);
+}
+
+std::string read_file(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(in), {});
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    config cfg;
+    if (!parse(argc, argv, cfg)) {
+        return 1;
+    }
+
+    // in-process server, unless there is a target
+    std::unique_ptr<helloworld::Greeter::AsyncService> service;
+    std::unique_ptr<grpc::AsyncGenericService> generic_service;
+    std::unique_ptr<agrpc::grpc_sharded_executor> server_ex;
+    std::unique_ptr<grpc::Server> server;
+    std::unique_ptr<agrpc::response_cache> cache;
+    std::string address = cfg.target;
+    if (address.empty()) {
+        grpc::ServerBuilder builder;
+        int port = 0;
+        builder.AddListeningPort("127.0.0.1:0", grpc::InsecureServerCredentials(), &port);
+        builder.SetMaxReceiveMessageSize(-1);
+        if (cfg.server == "generic") {
+            generic_service = std::make_unique<grpc::AsyncGenericService>();
+            builder.RegisterAsyncGenericService(generic_service.get());
+        } else {
+            service = std::make_unique<helloworld::Greeter::AsyncService>();
+            builder.RegisterService(service.get());
+        }
+        server_ex = std::make_unique<agrpc::grpc_sharded_executor>(
+            builder, cfg.server_threads, 1, false);
+        server = builder.BuildAndStart();
+        address = "127.0.0.1:" + std::to_string(port);
+
+        if (cfg.server_cache) {
+            cache = std::make_unique<agrpc::response_cache>(agrpc::response_cache::options{
+                .ttl = std::chrono::milliseconds(cfg.cache_ttl_ms)});
+        }
+        auto router = std::make_shared<agrpc::generic_router>();
+        router->set_fallback([work = std::chrono::microseconds(cfg.work_us)](
+                                 grpc::GenericServerContext&,
+                                 const grpc::ByteBuffer& req,
+                                 grpc::ByteBuffer& rep) -> unifex::task<grpc::Status> {
+            auto until = clock_type::now() + work;
+            while (clock_type::now() < until) {
+            }
+            // shares the slices, no copy
+            rep = req;
+            co_return grpc::Status::OK;
+        });
+        server_ex->for_each_shard([&](agrpc::grpc_executor& shard) {
+            if (generic_service) {
+                shard.spawn_local(agrpc::async_generic_call_data(
+                    shard, generic_service.get(), router, {.concurrency = 64}));
+                return;
+            }
+            shard.spawn_local(
+                agrpc::async_call_data<helloworld::HelloRequest, helloworld::HelloReply>(
+                    shard,
+                    &helloworld::Greeter::AsyncService::RequestSayHello,
+                    service.get(),
+                    [work = std::chrono::microseconds(cfg.work_us)](
+                        const grpc::ServerContext&,
+                        const helloworld::HelloRequest& req,
+                        helloworld::HelloReply& rep) -> bool {
+                        // stands in for computing the reply
+                        auto until = clock_type::now() + work;
+                        while (clock_type::now() < until) {
+                        }
+                        rep.set_message(req.name());
+                        return true;
+                    },
+                    false,
+                    {.concurrency = 64, .cache = cache.get()}));
+        });
+    }
+
+    client c;
+    c.method = cfg.method;
+    c.request.set_name(std::string(cfg.payload, 'x'));
+    if (cfg.keys > 0) {
+        for (std::size_t i = 0; i < cfg.keys; ++i) {
+            auto& r = c.keyed.emplace_back();
+            auto name = std::to_string(i);
+            r.set_name(name + std::string(cfg.payload - std::min(cfg.payload, name.size()), 'x'));
+        }
+        c.zipf = std::make_unique<zipf_keys>(cfg.keys, cfg.zipf);
+    }
+    auto raw = cfg.request.empty() ? c.request.SerializeAsString() : read_file(cfg.request);
+    grpc::Slice slice(raw);
+    c.raw_request = grpc::ByteBuffer(&slice, 1);
+    for (std::size_t i = 0; i < cfg.connections; ++i) {
+        grpc::ChannelArguments args;
+        // one connection each
+        args.SetInt("agrpc.bench.channel", static_cast<int>(i));
+        args.SetMaxReceiveMessageSize(-1);
+        auto channel =
+            grpc::CreateCustomChannel(address, grpc::InsecureChannelCredentials(), args);
+        c.stubs.push_back(helloworld::Greeter::NewStub(channel));
+        c.generic.push_back(std::make_unique<grpc::GenericStub>(channel));
+    }
+
+    std::vector<std::unique_ptr<grpc::CompletionQueue>> cqs;
+    for (std::size_t i = 0; i < cfg.threads; ++i) {
+        cqs.push_back(std::make_unique<grpc::CompletionQueue>());
+    }
+    agrpc::grpc_sharded_executor client_ex(std::move(cqs), 1, false);
+
+    unifex::inplace_stop_source stop_source;
+    std::thread server_th;
+    if (server_ex) {
+        server_th = std::thread([&]() { server_ex->run(stop_source.get_token(), true); });
+    }
+    std::thread client_th([&]() { client_ex.run(stop_source.get_token()); });
+
+    load l;
+    if (cfg.mode == "closed") {
+        l.active = cfg.concurrency;
+        for (int i = 0; i < cfg.concurrency; ++i) {
+            auto& shard = client_ex.shard(i % cfg.threads);
+            shard.spawn_local(closed_worker(shard, c, i % cfg.connections, l));
+        }
+    } else {
+        l.active = static_cast<int>(cfg.threads);
+        for (std::size_t i = 0; i < cfg.threads; ++i) {
+            auto& shard = client_ex.shard(i);
+            shard.spawn_local(open_pacer(shard,
+                                         c,
+                                         i % cfg.connections,
+                                         cfg.threads,
+                                         l,
+                                         cfg.rate / cfg.threads,
+                                         // the pacers are active too
+                                         cfg.concurrency + static_cast<int>(cfg.threads)));
+        }
+    }
+
+    std::this_thread::sleep_for(std::chrono::seconds(cfg.warmup));
+    auto allocs = g_allocs.load();
+    auto cpu = cpu_micros();
+    auto start = clock_type::now();
+    l.measuring = true;
+    std::this_thread::sleep_for(std::chrono::seconds(cfg.seconds));
+    l.measuring = false;
+    auto dt = std::chrono::duration<double>(clock_type::now() - start).count();
+    cpu = cpu_micros() - cpu;
+    allocs = g_allocs.load() - allocs;
+
+    l.stop = true;
+    while (l.active.load(std::memory_order_acquire) > 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    // cq Always after the associated server's Shutdown()!
+    if (server) {
+        server->Shutdown();
+    }
+    stop_source.request_stop();
+    if (server_th.joinable()) {
+        server_th.join();
+    }
+    client_th.join();
+
+    auto done = l.done.load();
+    auto h = l.latency.snapshot();
+    auto per_request = [&](double total) { return done == 0 ? 0.0 : total / done; };
+    auto us = [](std::uint64_t ns) { return ns / 1000.0; };
+
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(2) << "{\"mode\":\"" << cfg.mode << "\","
+        << "\"method\":\""
+        << (cfg.method.empty() ? "/helloworld.Greeter/SayHello" : cfg.method) << "\","
+        << "\"server\":\"" << (cfg.target.empty() ? "in-process " + cfg.server : cfg.target)
+        << "\","
+        << "\"connections\":" << cfg.connections << ","
+        << "\"threads\":" << cfg.threads << ","
+        << "\"concurrency\":" << cfg.concurrency << ","
+        << "\"rate\":" << (cfg.mode == "open" ? cfg.rate : 0) << ","
+        << "\"payload\":" << cfg.payload << ","
+        << "\"keys\":" << cfg.keys << ","
+        << "\"zipf\":" << cfg.zipf << ","
+        << "\"work_us\":" << cfg.work_us << ","
+        << "\"seconds\":" << dt << ","
+        << "\"requests\":" << done << ","
+        << "\"errors\":" << l.failed.load() << ","
+        << "\"dropped\":" << l.dropped.load() << ","
+        << "\"qps\":" << done / dt << ","
+        << "\"latency_us\":{"
+        << "\"mean\":" << h.mean() / 1000.0 << ","
+        << "\"p50\":" << us(h.percentile(0.5)) << ","
+        << "\"p90\":" << us(h.percentile(0.9)) << ","
+        << "\"p99\":" << us(h.percentile(0.99)) << ","
+        << "\"p999\":" << us(h.percentile(0.999)) << ","
+        << "\"max\":" << us(h.max) << "},"
+        // both ends of the call when the server is in-process
+        << "\"cpu_us_per_request\":" << per_request(static_cast<double>(cpu)) << ","
+        << "\"allocs_per_request\":" << per_request(static_cast<double>(allocs));
+    if (cache) {
+        out << ",\"server_cache\":" << agrpc::to_json(cache->stats());
+    }
+    out << "}";
+    std::cout << out.str() << std::endl;
+    return 0;
+}
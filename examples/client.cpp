@@ -49,7 +49,7 @@ int main() {
         ex, &helloworld::Greeter::Stub::AsyncSayHello, stub.get(), std::move(req));
     auto r = unifex::sync_wait(std::move(task));
     try {
-        auto rep = r->value();
+        const auto& rep = r->value();
         if (rep.ByteSizeLong() < 4000000) {
             std::cout << "got: " << rep.message() << std::endl;
         } else {
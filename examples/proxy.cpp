@@ -0,0 +1,242 @@
+// Pass-through proxy, forwarding every method to a backend.
+//
+// usage: proxy [--listen=0.0.0.0:50052] [--backend=127.0.0.1:50051]
+//              [--seconds=0] [--payload=1024] [--concurrency=32]
+//
+// With --seconds=0 it proxies to --backend until SIGINT/SIGTERM, e.g. in
+// front of examples/server. Otherwise it measures the pass-through overhead:
+// `concurrency` SayHello calls in a loop for `seconds`, first straight to an
+// in-process backend, then through the proxy, and prints both as JSON.
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <async_grpc/grpc_executor.h>
+#include <async_grpc/metrics.h>
+#include <async_grpc/proxy.h>
+#include <async_grpc/rpcs.h>
+#include <grpcpp/generic/async_generic_service.h>
+#include <grpcpp/generic/generic_stub.h>
+#include <grpcpp/grpcpp.h>
+#include <unifex/inplace_stop_token.hpp>
+#include <unifex/task.hpp>
+#include <sys/resource.h>
+#include <helloworld/helloworld.grpc.pb.h>
+#include <helloworld/helloworld.pb.h>
+
+namespace {
+
+struct config {
+    std::string listen = "0.0.0.0:50052";
+    std::string backend = "127.0.0.1:50051";
+    int seconds = 0;
+    std::size_t payload = 1024;
+    int concurrency = 32;
+};
+
+bool parse(int argc, char** argv, config& c) {
+    for (int i = 1; i < argc; ++i) {
+        std::string_view arg = argv[i];
+        auto eq = arg.find('=');
+        if (arg.substr(0, 2) != "--" || eq == std::string_view::npos) {
+            std::cerr << "bad argument: " << arg << std::endl;
+            return false;
+        }
+        auto key = arg.substr(2, eq - 2);
+        auto value = std::string(arg.substr(eq + 1));
+        if (key == "listen") {
+            c.listen = value;
+        } else if (key == "backend") {
+            c.backend = value;
+        } else if (key == "seconds") {
+            c.seconds = std::atoi(value.c_str());
+        } else if (key == "payload") {
+            c.payload = std::strtoul(value.c_str(), nullptr, 10);
+        } else if (key == "concurrency") {
+            c.concurrency = std::atoi(value.c_str());
+        } else {
+            std::cerr << "unknown option: " << key << std::endl;
+            return false;
+        }
+    }
+    return c.concurrency > 0;
+}
+
+std::uint64_t cpu_micros() {
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    auto us = [](const timeval& tv) {
+        return static_cast<std::uint64_t>(tv.tv_sec) * 1000000 + tv.tv_usec;
+    };
+    return us(usage.ru_utime) + us(usage.ru_stime);
+}
+
+// the proxy on `ex`, listening on `listen` and forwarding to `backend`
+struct proxy_server {
+    grpc::AsyncGenericService service;
+    std::unique_ptr<grpc::GenericStub> backend;
+    std::unique_ptr<agrpc::grpc_executor> ex;
+    std::unique_ptr<grpc::Server> server;
+    int port = 0;
+
+    proxy_server(const std::string& listen, const std::string& target) {
+        grpc::ServerBuilder builder;
+        builder.SetMaxReceiveMessageSize(-1);
+        builder.AddListeningPort(listen, grpc::InsecureServerCredentials(), &port);
+        builder.RegisterAsyncGenericService(&service);
+        ex = std::make_unique<agrpc::grpc_executor>(builder.AddCompletionQueue(), 1);
+        server = builder.BuildAndStart();
+
+        grpc::ChannelArguments args;
+        args.SetMaxReceiveMessageSize(-1);
+        backend = std::make_unique<grpc::GenericStub>(
+            grpc::CreateCustomChannel(target, grpc::InsecureChannelCredentials(), args));
+        ex->spawn_local(agrpc::async_proxy(*ex, &service, *backend, {.concurrency = 64}));
+    }
+};
+
+// SayHello backend, the reply echoes the request
+struct greeter_server {
+    helloworld::Greeter::AsyncService service;
+    std::unique_ptr<agrpc::grpc_executor> ex;
+    std::unique_ptr<grpc::Server> server;
+    int port = 0;
+
+    greeter_server() {
+        grpc::ServerBuilder builder;
+        builder.SetMaxReceiveMessageSize(-1);
+        builder.AddListeningPort("127.0.0.1:0", grpc::InsecureServerCredentials(), &port);
+        builder.RegisterService(&service);
+        ex = std::make_unique<agrpc::grpc_executor>(builder.AddCompletionQueue(), 1);
+        server = builder.BuildAndStart();
+        ex->spawn_local(
+            agrpc::async_call_data<helloworld::HelloRequest, helloworld::HelloReply>(
+                *ex,
+                &helloworld::Greeter::AsyncService::RequestSayHello,
+                &service,
+                [](const grpc::ServerContext&,
+                   const helloworld::HelloRequest& req,
+                   helloworld::HelloReply& rep) -> bool {
+                    rep.set_message(req.name());
+                    return true;
+                },
+                false,
+                {.concurrency = 64}));
+    }
+};
+
+unifex::task<void> worker(agrpc::grpc_executor& ex,
+                          helloworld::Greeter::Stub* stub,
+                          const helloworld::HelloRequest& request,
+                          std::atomic<bool>& stop,
+                          std::atomic<int>& active,
+                          agrpc::sharded_counter& done) {
+    while (!stop.load(std::memory_order_relaxed)) {
+        auto r = co_await agrpc::async_client_call<helloworld::HelloReply>(
+            ex, &helloworld::Greeter::Stub::AsyncSayHello, stub, request);
+        if (r.has_value()) {
+            done.add();
+        }
+    }
+    active.fetch_sub(1, std::memory_order_release);
+}
+
+// closed loop calls to `target` for `seconds`, as a JSON object
+std::string measure(const std::string& target, const config& cfg) {
+    grpc::ChannelArguments args;
+    args.SetMaxReceiveMessageSize(-1);
+    auto stub = helloworld::Greeter::NewStub(
+        grpc::CreateCustomChannel(target, grpc::InsecureChannelCredentials(), args));
+    helloworld::HelloRequest request;
+    request.set_name(std::string(cfg.payload, 'x'));
+
+    agrpc::grpc_executor ex(std::make_unique<grpc::CompletionQueue>(), 1);
+    std::atomic<bool> stop{false};
+    std::atomic<int> active{cfg.concurrency};
+    agrpc::sharded_counter done;
+    for (int i = 0; i < cfg.concurrency; ++i) {
+        ex.spawn_local(worker(ex, stub.get(), request, stop, active, done));
+    }
+    unifex::inplace_stop_source stop_source;
+    std::thread io([&]() { ex.run(stop_source.get_token()); });
+
+    auto cpu = cpu_micros();
+    auto start = std::chrono::steady_clock::now();
+    std::this_thread::sleep_for(std::chrono::seconds(cfg.seconds));
+    auto calls = done.load();
+    auto dt = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    cpu = cpu_micros() - cpu;
+
+    stop = true;
+    while (active.load(std::memory_order_acquire) > 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    stop_source.request_stop();
+    io.join();
+
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(2) << "{\"requests\":" << calls
+        << ",\"qps\":" << calls / dt << ",\"cpu_us_per_request\":"
+        << (calls == 0 ? 0.0 : static_cast<double>(cpu) / calls) << "}";
+    return out.str();
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    config cfg;
+    if (!parse(argc, argv, cfg)) {
+        return 1;
+    }
+
+    if (cfg.seconds == 0) {
+        sigset_t signals;
+        sigemptyset(&signals);
+        sigaddset(&signals, SIGINT);
+        sigaddset(&signals, SIGTERM);
+        pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+        proxy_server proxy(cfg.listen, cfg.backend);
+        std::thread io([&]() { proxy.ex->run(); });
+        std::cout << "proxying " << cfg.listen << " to " << cfg.backend << std::endl;
+
+        int sig = 0;
+        sigwait(&signals, &sig);
+        auto stats = proxy.ex->drain(*proxy.server,
+                                     std::chrono::system_clock::now() + std::chrono::seconds(10));
+        io.join();
+        std::cout << "completed: " << stats.completed << ", cancelled: " << stats.cancelled
+                  << std::endl;
+        return 0;
+    }
+
+    // in-process backend and proxy, both ends of every call in this process:
+    // the CPU per request through the proxy less the direct one is its cost
+    greeter_server backend;
+    auto backend_address = "127.0.0.1:" + std::to_string(backend.port);
+    proxy_server proxy("127.0.0.1:0", backend_address);
+    unifex::inplace_stop_source stop_source;
+    std::thread backend_io([&]() { backend.ex->run(stop_source.get_token()); });
+    std::thread proxy_io([&]() { proxy.ex->run(stop_source.get_token()); });
+
+    auto direct = measure(backend_address, cfg);
+    auto proxied = measure("127.0.0.1:" + std::to_string(proxy.port), cfg);
+
+    proxy.server->Shutdown();
+    backend.server->Shutdown();
+    stop_source.request_stop();
+    proxy_io.join();
+    backend_io.join();
+
+    std::cout << "{\"payload\":" << cfg.payload << ",\"concurrency\":" << cfg.concurrency
+              << ",\"direct\":" << direct << ",\"proxied\":" << proxied << "}" << std::endl;
+    return 0;
+}
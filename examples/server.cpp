@@ -1,15 +1,29 @@
 
+#include "async_grpc/admin_service.h"
 #include "async_grpc/common.h"
 #include "async_grpc/grpc_executor.h"
 #include "async_grpc/grpc_context.h"
+#include "async_grpc/method_stats.h"
 #include "async_grpc/rpcs.h"
+#include <chrono>
+#include <csignal>
 #include <iostream>
 #include <string>
+#include <thread>
 #include <utility>
 #include <grpcpp/grpcpp.h>
+#include <unifex/task.hpp>
 #include <helloworld/helloworld.grpc.pb.h>
 
 int main() {
+    // SIGINT/SIGTERM drain the server, blocked before any thread gets started
+    // so that only `sigwait` below sees them.
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
     grpc::ServerBuilder builder;
     builder.SetMaxReceiveMessageSize(100 * 1024 * 1024);
     // builder.SetMaxSendMessageSize(100 * 1024 * 1024);
@@ -17,6 +31,8 @@ int main() {
     agrpc::grpc_executor ex(builder.AddCompletionQueue());
     builder.AddListeningPort("0.0.0.0:50051", grpc::InsecureServerCredentials());
     builder.RegisterService(&service);
+    agrpc::admin_service admin;
+    builder.RegisterService(&admin);
     std::unique_ptr<grpc::Server> server = builder.BuildAndStart();
 
     // helloworld server
@@ -34,9 +50,86 @@ int main() {
                 rep.set_message(std::move(s));
                 return true;
             },
-            false);
+            false,
+            {.concurrency = 16,
+             .stats = &agrpc::default_stats_registry().get("/helloworld.Greeter/SayHello")});
     ex.spawn_local(std::move(greeter_rpc));
 
-    ex.run();
+    // helloworld stream server
+    auto greeter_stream_rpc =
+        agrpc::async_call_data_1m<helloworld::HelloRequest, helloworld::HelloReply>(
+            ex,
+            &helloworld::Greeter::AsyncService::RequestSayHelloStream,
+            &service,
+            [](const grpc::ServerContext&,
+               const helloworld::HelloRequest& req,
+               agrpc::server_writer<helloworld::HelloReply>& writer) -> bool {
+                for (int i = 0; i < 10; i++) {
+                    helloworld::HelloReply rep;
+                    rep.set_message("hello " + std::to_string(i) + ": " + req.name());
+                    if (!writer.write_blocking(std::move(rep))) {
+                        return false;
+                    }
+                }
+                return true;
+            });
+    ex.spawn_local(std::move(greeter_stream_rpc));
+
+    // helloworld client stream server
+    auto greeter_client_stream_rpc =
+        agrpc::async_call_data_m1<helloworld::HelloRequest, helloworld::HelloReply>(
+            ex,
+            &helloworld::Greeter::AsyncService::RequestSayHelloClientStream,
+            &service,
+            [](const grpc::ServerContext&,
+               agrpc::server_reader<helloworld::HelloRequest, helloworld::HelloReply>&
+                   reader,
+               helloworld::HelloReply& rep) -> unifex::task<bool> {
+                helloworld::HelloRequest req;
+                std::string s = "hello:";
+                while (co_await reader.read(req)) {
+                    s += " " + req.name();
+                }
+                rep.set_message(std::move(s));
+                co_return true;
+            });
+    ex.spawn_local(std::move(greeter_client_stream_rpc));
+
+    // helloworld bidi stream server
+    auto greeter_bidi_stream_rpc =
+        agrpc::async_call_data_mn<helloworld::HelloRequest, helloworld::HelloReply>(
+            ex,
+            &helloworld::Greeter::AsyncService::RequestSayHelloBidiStream,
+            &service,
+            [](const grpc::ServerContext&,
+               agrpc::server_reader_writer<helloworld::HelloRequest,
+                                           helloworld::HelloReply>& rw)
+                -> unifex::task<bool> {
+                helloworld::HelloRequest req;
+                helloworld::HelloReply rep;
+                while (co_await rw.read(req)) {
+                    rep.set_message("hello: " + req.name());
+                    if (!co_await rw.write(rep)) {
+                        co_return false;
+                    }
+                }
+                co_return true;
+            });
+    ex.spawn_local(std::move(greeter_bidi_stream_rpc));
+
+    // runtime metrics as JSON on /agrpc.Admin/Metrics
+    ex.spawn_local(agrpc::serve_admin(ex, admin, [&]() { return ex.metrics(); }));
+
+    std::thread io([&]() { ex.run(); });
+
+    int sig = 0;
+    sigwait(&signals, &sig);
+    std::cout << "draining" << std::endl;
+    auto stats =
+        ex.drain(*server, std::chrono::system_clock::now() + std::chrono::seconds(10));
+    io.join();
+    std::cout << "completed: " << stats.completed << ", cancelled: " << stats.cancelled
+              << std::endl;
+    agrpc::default_stats_registry().dump("server_stats.jsonl");
     return 0;
 }
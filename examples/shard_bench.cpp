@@ -0,0 +1,149 @@
+// Greeter throughput with 1, 2, 4 ... N server shards.
+//
+// usage: shard_bench [max_shards] [seconds] [concurrency]
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <async_grpc/grpc_executor.h>
+#include <async_grpc/grpc_sharded_executor.h>
+#include <async_grpc/rpcs.h>
+#include <grpcpp/grpcpp.h>
+#include <unifex/inplace_stop_token.hpp>
+#include <unifex/task.hpp>
+#include <helloworld/helloworld.grpc.pb.h>
+#include <helloworld/helloworld.pb.h>
+
+namespace {
+
+struct load {
+    std::atomic<bool> stop{false};
+    std::atomic<int> active{0};
+    std::atomic<uint64_t> done{0};
+    std::atomic<uint64_t> failed{0};
+};
+
+unifex::task<void> worker(agrpc::grpc_executor& ex,
+                          helloworld::Greeter::Stub* stub,
+                          load& l) {
+    while (!l.stop.load(std::memory_order_relaxed)) {
+        helloworld::HelloRequest req;
+        req.set_name("shard");
+        auto r = co_await agrpc::async_client_call<helloworld::HelloReply>(
+            ex, &helloworld::Greeter::Stub::AsyncSayHello, stub, std::move(req));
+        if (r.has_value()) {
+            l.done.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            l.failed.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    l.active.fetch_sub(1, std::memory_order_release);
+}
+
+double run_once(std::size_t shards, int seconds, int concurrency) {
+    grpc::ServerBuilder builder;
+    int port = 0;
+    builder.AddListeningPort("127.0.0.1:0", grpc::InsecureServerCredentials(), &port);
+    helloworld::Greeter::AsyncService service;
+    builder.RegisterService(&service);
+    agrpc::grpc_sharded_executor server_ex(builder, shards);
+    std::unique_ptr<grpc::Server> server = builder.BuildAndStart();
+
+    server_ex.for_each_shard([&](agrpc::grpc_executor& shard) {
+        shard.spawn_local(
+            agrpc::async_call_data<helloworld::HelloRequest, helloworld::HelloReply>(
+                shard,
+                &helloworld::Greeter::AsyncService::RequestSayHello,
+                &service,
+                [](const grpc::ServerContext&,
+                   const helloworld::HelloRequest& req,
+                   helloworld::HelloReply& rep) -> bool {
+                    rep.set_message("hello: " + req.name());
+                    return true;
+                },
+                false,
+                {.concurrency = 16}));
+    });
+
+    // the client gets as many completion queues as the server, so it is
+    // never the bottleneck being measured.
+    std::vector<std::unique_ptr<grpc::CompletionQueue>> cqs;
+    for (std::size_t i = 0; i < shards; ++i) {
+        cqs.push_back(std::make_unique<grpc::CompletionQueue>());
+    }
+    agrpc::grpc_sharded_executor client_ex(std::move(cqs), 1, false);
+
+    unifex::inplace_stop_source stop_source;
+    // a thread of its own, shard 0 may be pinned too
+    std::thread server_th([&]() { server_ex.run(stop_source.get_token(), true); });
+    std::thread client_th([&]() { client_ex.run(stop_source.get_token()); });
+
+    std::vector<std::unique_ptr<helloworld::Greeter::Stub>> stubs;
+    for (std::size_t i = 0; i < shards; ++i) {
+        grpc::ChannelArguments args;
+        // one connection per client shard
+        args.SetInt("agrpc.shard_bench.channel", static_cast<int>(i));
+        stubs.push_back(helloworld::Greeter::NewStub(grpc::CreateCustomChannel(
+            "127.0.0.1:" + std::to_string(port), grpc::InsecureChannelCredentials(), args)));
+    }
+
+    load l;
+    l.active = concurrency * static_cast<int>(shards);
+    for (std::size_t i = 0; i < shards; ++i) {
+        auto& shard = client_ex.shard(i);
+        for (int c = 0; c < concurrency; ++c) {
+            shard.spawn_local(worker(shard, stubs[i].get(), l));
+        }
+    }
+
+    std::this_thread::sleep_for(std::chrono::seconds(1));  // warm up
+    auto start_count = l.done.load();
+    auto start = std::chrono::steady_clock::now();
+    std::this_thread::sleep_for(std::chrono::seconds(seconds));
+    auto count = l.done.load() - start_count;
+    auto dt = std::chrono::duration<double>(std::chrono::steady_clock::now() - start);
+
+    l.stop = true;
+    while (l.active.load(std::memory_order_acquire) > 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    // cq Always after the associated server's Shutdown()!
+    server->Shutdown();
+    stop_source.request_stop();
+    server_th.join();
+    client_th.join();
+
+    if (l.failed.load() > 0) {
+        std::cerr << "failed calls: " << l.failed.load() << std::endl;
+    }
+    return count / dt.count();
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    std::size_t max_shards = argc > 1 ? std::atoi(argv[1])
+                                      : std::max(1u, std::thread::hardware_concurrency() / 2);
+    int seconds = argc > 2 ? std::atoi(argv[2]) : 5;
+    int concurrency = argc > 3 ? std::atoi(argv[3]) : 64;
+
+    std::cout << "shards\tqps\tspeedup" << std::endl;
+    double base = 0;
+    for (std::size_t shards = 1; shards <= max_shards; shards *= 2) {
+        auto qps = run_once(shards, seconds, concurrency);
+        if (shards == 1) {
+            base = qps;
+        }
+        std::cout << shards << "\t" << static_cast<uint64_t>(qps) << "\t"
+                  << (base > 0 ? qps / base : 0) << std::endl;
+    }
+    return 0;
+}
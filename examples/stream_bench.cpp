@@ -0,0 +1,172 @@
+// Bidi streaming messages/sec and memory per stream with many concurrent
+// streams against an in-process server.
+//
+// usage: stream_bench [streams] [seconds] [channels]
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <async_grpc/grpc_executor.h>
+#include <async_grpc/rpcs.h>
+#include <grpcpp/grpcpp.h>
+#include <unifex/async_manual_reset_event.hpp>
+#include <unifex/inplace_stop_token.hpp>
+#include <unifex/task.hpp>
+#include <unistd.h>
+#include <helloworld/helloworld.grpc.pb.h>
+#include <helloworld/helloworld.pb.h>
+
+namespace {
+
+using Stub = helloworld::Greeter::Stub;
+using rw_type =
+    agrpc::grpc_client_reader_writer<helloworld::HelloRequest, helloworld::HelloReply>;
+
+struct load {
+    std::atomic<bool> stop{false};
+    std::atomic<int> started{0};
+    std::atomic<int> active{0};
+    std::atomic<uint64_t> messages{0};
+    std::atomic<uint64_t> failed{0};
+};
+
+// resident set size in bytes
+std::size_t rss() {
+    std::ifstream statm("/proc/self/statm");
+    std::size_t pages = 0, resident = 0;
+    statm >> pages >> resident;
+    return resident * sysconf(_SC_PAGESIZE);
+}
+
+// writes until asked to stop, while the worker reads the echoes.
+unifex::task<void> writer(rw_type& rw, load& l, unifex::async_manual_reset_event& done) {
+    helloworld::HelloRequest req;
+    req.set_name("stream");
+    while (!l.stop.load(std::memory_order_relaxed)) {
+        if (!co_await rw.write(req)) {
+            break;
+        }
+    }
+    co_await rw.writes_done();
+    done.set();
+}
+
+unifex::task<void> worker(agrpc::grpc_executor& ex, Stub* stub, load& l) {
+    rw_type rw(ex);
+    if (!co_await rw.start(&Stub::AsyncSayHelloBidiStream, stub)) {
+        l.failed.fetch_add(1, std::memory_order_relaxed);
+        l.started.fetch_add(1, std::memory_order_relaxed);
+        l.active.fetch_sub(1, std::memory_order_release);
+        co_return;
+    }
+    l.started.fetch_add(1, std::memory_order_relaxed);
+
+    unifex::async_manual_reset_event writer_done;
+    ex.spawn_local(writer(rw, l, writer_done));
+
+    helloworld::HelloReply rep;
+    while (co_await rw.read(rep)) {
+        l.messages.fetch_add(1, std::memory_order_relaxed);
+    }
+    co_await writer_done.async_wait();
+
+    auto status = co_await rw.finish();
+    if (!status.ok()) {
+        l.failed.fetch_add(1, std::memory_order_relaxed);
+    }
+    l.active.fetch_sub(1, std::memory_order_release);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    int streams = argc > 1 ? std::atoi(argv[1]) : 10000;
+    int seconds = argc > 2 ? std::atoi(argv[2]) : 10;
+    int channels = argc > 3 ? std::atoi(argv[3]) : 8;
+
+    grpc::ServerBuilder builder;
+    int port = 0;
+    builder.AddListeningPort("127.0.0.1:0", grpc::InsecureServerCredentials(), &port);
+    helloworld::Greeter::AsyncService service;
+    builder.RegisterService(&service);
+    agrpc::grpc_executor server_ex(builder.AddCompletionQueue());
+    std::unique_ptr<grpc::Server> server = builder.BuildAndStart();
+
+    server_ex.spawn_local(
+        agrpc::async_call_data_mn<helloworld::HelloRequest, helloworld::HelloReply>(
+            server_ex,
+            &helloworld::Greeter::AsyncService::RequestSayHelloBidiStream,
+            &service,
+            [](const grpc::ServerContext&,
+               agrpc::server_reader_writer<helloworld::HelloRequest,
+                                           helloworld::HelloReply>& rw)
+                -> unifex::task<bool> {
+                helloworld::HelloRequest req;
+                helloworld::HelloReply rep;
+                while (co_await rw.read(req)) {
+                    rep.set_message(req.name());
+                    if (!co_await rw.write(rep)) {
+                        co_return false;
+                    }
+                }
+                co_return true;
+            },
+            {.concurrency = 64}));
+
+    agrpc::grpc_executor client_ex(std::make_unique<grpc::CompletionQueue>(), 1);
+
+    unifex::inplace_stop_source stop_source;
+    std::thread server_th([&]() { server_ex.run(stop_source.get_token()); });
+    std::thread client_th([&]() { client_ex.run(stop_source.get_token()); });
+
+    std::vector<std::unique_ptr<Stub>> stubs;
+    for (int i = 0; i < channels; ++i) {
+        grpc::ChannelArguments args;
+        args.SetInt("agrpc.stream_bench.channel", i);
+        stubs.push_back(helloworld::Greeter::NewStub(grpc::CreateCustomChannel(
+            "127.0.0.1:" + std::to_string(port), grpc::InsecureChannelCredentials(), args)));
+    }
+
+    load l;
+    auto base_rss = rss();
+    l.active = streams;
+    for (int i = 0; i < streams; ++i) {
+        client_ex.spawn_local(worker(client_ex, stubs[i % channels].get(), l));
+    }
+    while (l.started.load() < streams) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    // sampled under load: one message in flight each way per stream
+    auto open_rss = rss();
+
+    auto start_count = l.messages.load();
+    auto start = std::chrono::steady_clock::now();
+    std::this_thread::sleep_for(std::chrono::seconds(seconds));
+    auto count = l.messages.load() - start_count;
+    auto dt = std::chrono::duration<double>(std::chrono::steady_clock::now() - start);
+
+    l.stop = true;
+    while (l.active.load(std::memory_order_acquire) > 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    // cq Always after the associated server's Shutdown()!
+    server->Shutdown();
+    stop_source.request_stop();
+    server_th.join();
+    client_th.join();
+
+    // client and server share the process, so this is both ends of a stream
+    std::cout << "streams: " << streams << "\n"
+              << "messages/sec: " << static_cast<uint64_t>(count / dt.count()) << "\n"
+              << "bytes/stream: " << (open_rss - base_rss) / streams << "\n"
+              << "failed: " << l.failed.load() << std::endl;
+    return 0;
+}
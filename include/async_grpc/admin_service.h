@@ -0,0 +1,47 @@
+// built-in admin service, serving runtime metrics.
+#pragma once
+
+#include <functional>
+#include <async_grpc/grpc_executor.h>
+#include <async_grpc/metrics.h>
+#include <google/protobuf/empty.pb.h>
+#include <google/protobuf/wrappers.pb.h>
+#include <grpcpp/grpcpp.h>
+#include <unifex/task.hpp>
+
+namespace agrpc {
+
+// `agrpc.Admin` without a .proto of its own: the methods use protobuf's
+// well-known types, so any client can call them with the method name.
+//
+//     rpc Metrics(google.protobuf.Empty) returns (google.protobuf.StringValue);
+//
+// The reply holds `to_json(executor_metrics)`. Register it next to the
+// other services and start `serve_admin` on an executor:
+//
+//     agrpc::admin_service admin;
+//     builder.RegisterService(&admin);
+//     ...
+//     ex.spawn_local(agrpc::serve_admin(ex, admin, [&] { return ex.metrics(); }));
+//
+class admin_service : public grpc::Service {
+public:
+    static constexpr const char* kMetricsMethod = "/agrpc.Admin/Metrics";
+
+    admin_service();
+
+    // same shape as the generated `Request*` methods, for `async_call_data`
+    void RequestMetrics(grpc::ServerContext* context,
+                        google::protobuf::Empty* request,
+                        grpc::ServerAsyncResponseWriter<google::protobuf::StringValue>* writer,
+                        grpc::CompletionQueue* new_call_cq,
+                        grpc::ServerCompletionQueue* notification_cq,
+                        void* tag);
+};
+
+// Answer `Metrics` calls on `svc` with snapshots of `source`.
+unifex::task<void> serve_admin(grpc_executor& ex,
+                               admin_service& svc,
+                               std::function<executor_metrics()> source);
+
+}  // namespace agrpc
@@ -0,0 +1,329 @@
+// bounded async channel from any thread to the grpc_context.
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <utility>
+#include <vector>
+#include <async_grpc/grpc_context.h>
+#include <unifex/async_manual_reset_event.hpp>
+#include <unifex/get_stop_token.hpp>
+#include <unifex/ready_done_sender.hpp>
+#include <unifex/receiver_concepts.hpp>
+#include <unifex/stop_token_concepts.hpp>
+#include <unifex/sync_wait.hpp>
+#include <unifex/task.hpp>
+
+namespace agrpc {
+
+// Channel from producers on any thread to one consumer on the grpc_context,
+// e.g. from handlers on the thread pool to a server stream.
+//
+// `send` suspends while `capacity` items wait for the consumer, so a slow
+// consumer holds the producers back. The channel is a unifex stream:
+// `unifex::next(ch)` yields the items in order and is done once the channel
+// is closed and drained.
+//
+//     while (auto item = co_await unifex::done_as_optional(unifex::next(ch))) {
+//         co_await writer.write(std::move(*item));
+//     }
+//
+// Items reach the io thread in batches. Producers post a wakeup only when the
+// consumer waits and none is pending yet; the consumer then takes everything
+// buffered so far with one lock, and works through it without another one.
+template <class T>
+class channel : private task_base {
+public:
+    channel(grpc_context& ctx, std::size_t capacity)
+      : ctx_(ctx)
+      , capacity_(std::max<std::size_t>(capacity, 1)) {
+        this->execute_ = &on_wakeup;
+        shared_.reserve(capacity_);
+        batch_.reserve(capacity_);
+    }
+
+    channel(const channel&) = delete;
+    channel& operator=(const channel&) = delete;
+
+    // Completes once `item` is buffered, or with false if the channel is
+    // closed. May be called from any thread.
+    unifex::task<bool> send(T item) {
+        for (;;) {
+            bool sent = false;
+            bool wake = false;
+            {
+                std::lock_guard lock(mutex_);
+                if (closed_) {
+                    co_return false;
+                }
+                if (shared_.size() < capacity_) {
+                    shared_.push_back(std::move(item));
+                    sent = true;
+                    wake = consumerWaiting_ && !std::exchange(wakeupPending_, true);
+                } else {
+                    space_.reset();
+                }
+            }
+            if (sent) {
+                if (wake) {
+                    ctx_.post(this);
+                }
+                co_return true;
+            }
+            co_await space_.async_wait();
+        }
+    }
+
+    // `send` for the thread pool, blocks the calling thread while the
+    // channel is full.
+    bool send_blocking(T item) {
+        UNIFEX_ASSERT(!ctx_.is_running_on_io_thread());
+        return unifex::sync_wait(send(std::move(item))).value_or(false);
+    }
+
+    // No more sends. Waiting producers complete with false, the stream ends
+    // once the consumer took what is left. May be called from any thread.
+    void close() {
+        bool wake = false;
+        {
+            std::lock_guard lock(mutex_);
+            closed_ = true;
+            wake = consumerWaiting_ && !std::exchange(wakeupPending_, true);
+        }
+        space_.set();
+        if (wake) {
+            ctx_.post(this);
+        }
+    }
+
+private:
+    struct consumer_base {
+        void (*wakeup)(consumer_base*) noexcept;
+    };
+
+public:
+    class next_sender {
+        template <typename Receiver>
+        class operation : private consumer_base {
+        public:
+            void start() noexcept {
+                UNIFEX_ASSERT(channel_.ctx_.is_running_on_io_thread());
+                if constexpr (!unifex::is_stop_never_possible_v<stop_token_type>) {
+                    auto token = unifex::get_stop_token(receiver_);
+                    if (token.stop_requested()) {
+                        unifex::set_done(static_cast<Receiver&&>(receiver_));
+                        return;
+                    }
+                    if (channel_.ready() || !channel_.wait(this)) {
+                        deliver();
+                        return;
+                    }
+                    stopCallback_.emplace(std::move(token), cancel_callback{*this});
+                } else {
+                    if (channel_.ready() || !channel_.wait(this)) {
+                        deliver();
+                    }
+                }
+            }
+
+        private:
+            friend next_sender;
+
+            // Stop requests may come from any thread. They are forwarded to
+            // the io thread once, as `cancelTask_`.
+            struct cancel_callback {
+                operation& op_;
+                void operator()() noexcept {
+                    if (!op_.cancelRequested_.exchange(true, std::memory_order_acq_rel)) {
+                        op_.channel_.ctx_.post(&op_.cancelTask_);
+                    }
+                }
+            };
+
+            struct cancel_task : task_base {
+                operation* op_;
+            };
+
+            using stop_token_type = unifex::stop_token_type_t<Receiver>;
+            using stop_callback_type =
+                typename stop_token_type::template callback_type<cancel_callback>;
+
+            template <typename Receiver2>
+            operation(channel& ch, Receiver2&& r)
+              : channel_(ch)
+              , receiver_((Receiver2 &&) r) {
+                this->wakeup = &on_wakeup;
+                cancelTask_.op_ = this;
+                cancelTask_.execute_ = &on_cancel;
+            }
+
+            static void on_wakeup(consumer_base* base) noexcept {
+                auto& self = *static_cast<operation*>(base);
+                // waits for a stop callback running on another thread
+                self.stopCallback_.reset();
+                if (self.cancelRequested_.load(std::memory_order_acquire)) {
+                    // `cancelTask_` is queued, it has to run before completion
+                    self.woken_ = true;
+                    return;
+                }
+                self.deliver();
+            }
+
+            static void on_cancel(task_base* p, bool) noexcept {
+                auto& self = *static_cast<cancel_task*>(p)->op_;
+                if (self.channel_.cancel_wait(&self)) {
+                    self.stopCallback_.reset();
+                    unifex::set_done(static_cast<Receiver&&>(self.receiver_));
+                } else if (self.woken_) {
+                    unifex::set_done(static_cast<Receiver&&>(self.receiver_));
+                }
+            }
+
+            // the next item, or done if the channel is closed and drained
+            void deliver() noexcept {
+                auto& ch = channel_;
+                if (ch.batchPos_ == ch.batch_.size()) {
+                    unifex::set_done(static_cast<Receiver&&>(receiver_));
+                    return;
+                }
+                T item = std::move(ch.batch_[ch.batchPos_++]);
+                if constexpr (unifex::is_nothrow_receiver_of_v<Receiver, T>) {
+                    unifex::set_value(static_cast<Receiver&&>(receiver_), std::move(item));
+                } else {
+                    UNIFEX_TRY {
+                        unifex::set_value(static_cast<Receiver&&>(receiver_),
+                                          std::move(item));
+                    }
+                    UNIFEX_CATCH(...) {
+                        unifex::set_error(static_cast<Receiver&&>(receiver_),
+                                          std::current_exception());
+                    }
+                }
+            }
+
+            channel& channel_;
+            Receiver receiver_;
+            cancel_task cancelTask_;
+            std::atomic<bool> cancelRequested_{false};
+            bool woken_ = false;
+            std::optional<stop_callback_type> stopCallback_;
+        };
+
+    public:
+        // clang-format off
+        template <
+          template <typename...> class Variant,
+          template <typename...> class Tuple>
+        using value_types = Variant<Tuple<T>>;
+
+        template <template <typename...> class Variant>
+        using error_types = Variant<std::exception_ptr>;
+
+        static constexpr bool sends_done = true;
+
+        template <typename Receiver>
+        operation<std::remove_reference_t<Receiver>> connect(Receiver&& r) && {
+            return operation<std::remove_reference_t<Receiver>>{channel_, (Receiver &&) r};
+        }
+        // clang-format on
+
+    private:
+        friend channel;
+        explicit next_sender(channel& ch) noexcept : channel_(ch) {}
+        channel& channel_;
+    };
+
+    // unifex stream, consumed on the io thread by one consumer at a time
+    next_sender next() noexcept { return next_sender{*this}; }
+    unifex::ready_done_sender cleanup() noexcept { return {}; }
+
+private:
+    // Whether `deliver` can complete right away, with an item or done. Takes
+    // over the producers' buffer once the batch is used up. Only the wakeup
+    // clears `wakeupPending_`, `this` must not be posted twice.
+    bool ready() {
+        if (batchPos_ < batch_.size()) {
+            return true;
+        }
+        bool closed = false;
+        {
+            std::lock_guard lock(mutex_);
+            batch_.clear();
+            batchPos_ = 0;
+            std::swap(batch_, shared_);
+            closed = closed_;
+        }
+        if (batch_.empty()) {
+            return closed;
+        }
+        space_.set();
+        return true;
+    }
+
+    // Park the consumer until producers post a wakeup. False if something
+    // arrived meanwhile, the consumer goes on instead.
+    bool wait(consumer_base* consumer) {
+        std::lock_guard lock(mutex_);
+        if (!shared_.empty() || closed_) {
+            return false;
+        }
+        consumer_ = consumer;
+        consumerWaiting_ = true;
+        return true;
+    }
+
+    // Unpark `consumer` if it still waits.
+    bool cancel_wait(consumer_base* consumer) {
+        if (consumer_ != consumer) {
+            return false;
+        }
+        consumer_ = nullptr;
+        std::lock_guard lock(mutex_);
+        consumerWaiting_ = false;
+        return true;
+    }
+
+    static void on_wakeup(task_base* p, bool) noexcept {
+        auto& self = *static_cast<channel*>(p);
+        auto* consumer = std::exchange(self.consumer_, nullptr);
+        if (consumer == nullptr) {
+            // the consumer was cancelled meanwhile
+            std::lock_guard lock(self.mutex_);
+            self.wakeupPending_ = false;
+            return;
+        }
+        {
+            std::lock_guard lock(self.mutex_);
+            self.consumerWaiting_ = false;
+            self.wakeupPending_ = false;
+        }
+        // a stale wakeup, from before the consumer was cancelled and another
+        // one took the items
+        if (!self.ready() && self.wait(consumer)) {
+            return;
+        }
+        consumer->wakeup(consumer);
+    }
+
+    grpc_context& ctx_;
+    const std::size_t capacity_;
+
+    // shared with the producers
+    std::mutex mutex_;
+    std::vector<T> shared_;
+    bool closed_ = false;
+    bool consumerWaiting_ = false;
+    bool wakeupPending_ = false;
+    unifex::async_manual_reset_event space_;
+
+    // io thread only
+    std::vector<T> batch_;
+    std::size_t batchPos_ = 0;
+    consumer_base* consumer_ = nullptr;
+};
+
+}  // namespace agrpc
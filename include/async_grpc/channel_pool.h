@@ -0,0 +1,160 @@
+// pool of channels to one target, picked by fewest calls in flight.
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+#include <grpcpp/channel.h>
+#include <grpcpp/security/credentials.h>
+#include <grpcpp/support/channel_arguments.h>
+
+namespace agrpc {
+
+// N channels to the same target, created with distinct channel args so that
+// they don't share subchannels: N HTTP/2 connections, each with its own
+// MAX_CONCURRENT_STREAMS and no head-of-line blocking between them.
+//
+// Every call goes to the channel with the fewest calls in flight, ties go
+// round robin. Every `check_interval` channels whose average latency is
+// `outlier_factor` times the median of the pool, or whose share of failed
+// calls is above `max_error_rate`, get ejected for `ejection_time`, up to
+// `max_ejected` of the pool. Lock-free.
+//
+// Calls use it through a `stub_pool`.
+class channel_pool {
+public:
+    using clock = std::chrono::steady_clock;
+
+    struct options {
+        std::size_t size = 4;
+        // base args of every channel
+        grpc::ChannelArguments args = {};
+        // weight of a call in the average latency and error rate of its
+        // channel
+        double latency_weight = 0.1;
+        double outlier_factor = 3;
+        // no channel is an outlier below this latency
+        std::chrono::nanoseconds min_outlier_latency = std::chrono::milliseconds(1);
+        std::chrono::nanoseconds check_interval = std::chrono::seconds(1);
+        std::chrono::nanoseconds ejection_time = std::chrono::seconds(10);
+        // share of the channels that may be ejected at the same time
+        double max_ejected = 0.5;
+        // average share of failed calls above which a channel gets ejected
+        double max_error_rate = 0.5;
+    };
+
+    struct channel_stats {
+        std::size_t inflight = 0;
+        std::uint64_t calls = 0;
+        std::chrono::nanoseconds latency{0};
+        double error_rate = 0;
+        bool ejected = false;
+    };
+
+    struct stats_type {
+        std::vector<channel_stats> channels;
+        std::uint64_t ejections = 0;
+    };
+
+    // One call on channel `index()`, released on destruction.
+    class lease {
+    public:
+        lease() = default;
+        lease(lease&& other) noexcept;
+        lease& operator=(lease&& other) noexcept;
+        ~lease();
+
+        std::size_t index() const noexcept { return index_; }
+
+        // The call completed after `latency`, counted towards the channel's
+        // average unless it failed. Both count towards its error rate.
+        void done(std::chrono::nanoseconds latency, bool ok) noexcept;
+
+        // The call completed, counted towards the channel's error rate only,
+        // e.g. a stream whose lifetime says nothing of the channel.
+        void done(bool ok) noexcept;
+
+    private:
+        friend channel_pool;
+        lease(channel_pool* pool, std::size_t index) noexcept
+          : pool_(pool)
+          , index_(index) {}
+
+        channel_pool* pool_ = nullptr;
+        std::size_t index_ = 0;
+    };
+
+    channel_pool(const std::string& target,
+                 const std::shared_ptr<grpc::ChannelCredentials>& credentials,
+                 options options);
+
+    channel_pool(const channel_pool&) = delete;
+    channel_pool& operator=(const channel_pool&) = delete;
+
+    std::size_t size() const noexcept { return channels_.size(); }
+    const std::shared_ptr<grpc::Channel>& channel(std::size_t i) const { return channels_[i]; }
+
+    lease pick() noexcept;
+
+    stats_type stats() const;
+
+private:
+    struct alignas(64) slot {
+        std::atomic<std::size_t> inflight{0};
+        std::atomic<std::uint64_t> calls{0};
+        // nanoseconds, 0 until the first call
+        std::atomic<std::int64_t> latency{0};
+        // failed calls per million
+        std::atomic<std::int64_t> errorRate{0};
+        std::atomic<std::int64_t> ejectedUntil{0};
+    };
+
+    void release(std::size_t index) noexcept;
+    // a completed call, `latency` if it counts towards the average
+    void record(std::size_t index,
+                bool ok,
+                std::optional<std::chrono::nanoseconds> latency) noexcept;
+    // move `average` by `latency_weight` towards `sample`
+    void average_in(std::atomic<std::int64_t>& average, double sample) const noexcept;
+    // eject the outliers once per `check_interval`
+    void check(std::int64_t now) noexcept;
+    bool ejected(const slot& s, std::int64_t now) const noexcept;
+    static std::int64_t ticks() noexcept;
+
+    const options options_;
+    std::vector<std::shared_ptr<grpc::Channel>> channels_;
+    std::unique_ptr<slot[]> slots_;
+    std::atomic<std::size_t> next_{0};
+    std::atomic<std::int64_t> checkedAt_;
+    std::atomic<std::uint64_t> ejections_{0};
+};
+
+// One stub of type `Stub` per channel of a `channel_pool`, what
+// `async_client_call` and `grpc_client_stream_create` take in place of a
+// single stub.
+template <class Stub>
+class stub_pool {
+public:
+    explicit stub_pool(channel_pool& channels) : channels_(channels) {
+        stubs_.reserve(channels.size());
+        for (std::size_t i = 0; i < channels.size(); ++i) {
+            stubs_.push_back(std::make_unique<Stub>(channels.channel(i)));
+        }
+    }
+
+    channel_pool& channels() noexcept { return channels_; }
+    Stub* stub(std::size_t i) const noexcept { return stubs_[i].get(); }
+
+private:
+    channel_pool& channels_;
+    std::vector<std::unique_ptr<Stub>> stubs_;
+};
+
+std::string to_json(const channel_pool::stats_type& s);
+
+}  // namespace agrpc
@@ -0,0 +1,110 @@
+// single-flight and TTL cache of identical client calls.
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <async_grpc/metrics.h>
+#include <async_grpc/sharded_lru.h>
+#include <unifex/async_manual_reset_event.hpp>
+
+namespace agrpc {
+
+// Replies of unary client calls by stub, method and serialized request, see
+// `client_options::cache`:
+//
+//   - identical calls in flight at the same time share one RPC, the others
+//     wait for its result (single-flight), errors included.
+//   - successful replies are served for `ttl` without touching the network,
+//     then for `stale` more while one background call refreshes them
+//     (stale-while-revalidate).
+//
+// Replies are kept serialized, in a `detail::sharded_lru` of `max_bytes`.
+class client_cache {
+public:
+    using clock = std::chrono::steady_clock;
+
+    struct options {
+        std::chrono::nanoseconds ttl = std::chrono::seconds(1);
+        std::chrono::nanoseconds stale{0};
+        std::size_t max_bytes = 64 << 20;
+        std::size_t shards = 16;
+    };
+
+    struct stats_type : lru_stats {
+        std::uint64_t hits = 0;
+        std::uint64_t stale_hits = 0;
+        std::uint64_t misses = 0;
+        // calls that waited for an identical one in flight
+        std::uint64_t coalesced = 0;
+    };
+
+    // Outcome of a call shared by identical ones, set before `done`.
+    struct flight {
+        unifex::async_manual_reset_event done;
+        std::exception_ptr error;
+        std::string reply;
+    };
+
+    struct lookup_result {
+        enum { miss, fresh, stale } state = miss;
+        std::string reply;
+        // a stale hit that no one refreshes yet, the caller should
+        bool refresh = false;
+    };
+
+    explicit client_cache(options options);
+
+    client_cache(const client_cache&) = delete;
+    client_cache& operator=(const client_cache&) = delete;
+
+    // The key of a call, `method` tells the methods apart.
+    static std::string key_of(std::string_view method, std::string_view request);
+
+    lookup_result lookup(const std::string& key);
+
+    // Join the identical call in flight, or start one: the caller leads it
+    // if `leader` and must `land` it.
+    struct join_result {
+        std::shared_ptr<flight> call;
+        bool leader = false;
+    };
+    join_result join(const std::string& key);
+
+    // The call led by the caller completed, with `reply` unless `error`.
+    // Caches the reply and wakes those who joined.
+    void land(const std::string& key,
+              const std::shared_ptr<flight>& f,
+              std::exception_ptr error,
+              std::string reply);
+
+    void clear();
+    stats_type stats() const;
+
+private:
+    struct entry {
+        std::string reply;
+        clock::time_point freshUntil;
+        clock::time_point staleUntil;
+        bool refreshing = false;
+    };
+    // calls in flight of a shard, by key
+    using flights = std::unordered_map<std::string, std::shared_ptr<flight>>;
+
+    const options options_;
+    detail::sharded_lru<entry, flights> entries_;
+
+    sharded_counter hits_;
+    sharded_counter staleHits_;
+    sharded_counter misses_;
+    sharded_counter coalesced_;
+};
+
+std::string to_json(const client_cache::stats_type& s);
+
+}  // namespace agrpc
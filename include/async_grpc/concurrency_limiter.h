@@ -0,0 +1,99 @@
+// per method cap on calls in their handler.
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <grpcpp/server_context.h>
+#include <unifex/async_manual_reset_event.hpp>
+#include <unifex/task.hpp>
+
+namespace agrpc {
+
+// Admits at most `limit` calls into their handler at a time, up to `queue`
+// more wait for a slot in arrival order and the rest is rejected right
+// away, which `async_call_data` answers with RESOURCE_EXHAUSTED. Pass it
+// through `call_options::call_limiter`; may be shared by the shards of a
+// `grpc_sharded_executor`.
+//
+// The limit is fixed, or adapts to the handler latency:
+//
+//   aimd     - grows by one per `limit` calls finished within
+//              `latency_target`, shrinks by `backoff` on a slower or failed
+//              one.
+//   gradient - follows the ratio of the long term to the recent latency,
+//              shrinking as the recent one rises above the long term one,
+//              plus a headroom of sqrt(limit) to probe for more.
+class concurrency_limiter {
+public:
+    enum class limit_mode { fixed, aimd, gradient };
+
+    struct options {
+        limit_mode mode = limit_mode::fixed;
+        // initial limit, and the bounds it adapts within
+        std::size_t limit = 64;
+        std::size_t min_limit = 1;
+        std::size_t max_limit = 1024;
+        // calls waiting beyond the limit before calls get rejected
+        std::size_t queue = 0;
+        // aimd
+        std::chrono::nanoseconds latency_target = std::chrono::milliseconds(50);
+        double backoff = 0.9;
+        // gradient, weight of a call in the recent latency average
+        double smoothing = 0.2;
+    };
+
+    struct stats_type {
+        std::size_t limit = 0;
+        std::size_t inflight = 0;
+        std::size_t queued = 0;
+        std::uint64_t admitted = 0;
+        std::uint64_t rejected = 0;
+    };
+
+    explicit concurrency_limiter(options options);
+
+    concurrency_limiter(const concurrency_limiter&) = delete;
+    concurrency_limiter& operator=(const concurrency_limiter&) = delete;
+
+    // Completes with true once the call may run its handler, or with false
+    // if it is rejected. Every admitted call must be `release`d. A call of
+    // `context` that got cancelled while it waited gives its slot back and
+    // completes with false.
+    unifex::task<bool> acquire(const grpc::ServerContext* context = nullptr);
+
+    // An admitted call left its handler after `latency`, `ok` unless it
+    // failed.
+    void release(std::chrono::nanoseconds latency, bool ok);
+
+    stats_type stats() const;
+
+private:
+    struct waiter {
+        unifex::async_manual_reset_event admitted;
+    };
+
+    // with `mutex_` held, before the call leaves `inflight_`
+    void adapt(std::chrono::nanoseconds latency, bool ok);
+    // admit waiters into the slots free under the limit
+    void hand_over();
+    std::size_t current_limit() const noexcept;
+
+    const options options_;
+    mutable std::mutex mutex_;
+    double limit_;
+    std::size_t inflight_ = 0;
+    std::deque<waiter*> waiters_;
+    std::uint64_t admitted_ = 0;
+    std::uint64_t rejected_ = 0;
+    // gradient, latencies in nanoseconds
+    double longLatency_ = 0;
+    double shortLatency_ = 0;
+};
+
+std::string to_json(const concurrency_limiter::stats_type& s);
+
+}  // namespace agrpc
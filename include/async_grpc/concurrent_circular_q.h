@@ -0,0 +1,181 @@
+// lock-free circular q for one consumer and one or many producers.
+#pragma once
+
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <span>
+#include <type_traits>
+
+namespace agrpc {
+
+// Fixed size ring with the policy of `circular_q`: producers never wait, a
+// push into a full q overwrites the oldest item.
+//
+// The capacity is rounded up to a power of two. Every slot records the
+// position it holds and whether a write is in progress, the consumer copies
+// an item out and checks afterwards that no producer lapped it meanwhile
+// (a seqlock per slot). Hence items must be trivially copyable.
+//
+// With `MultiProducer` any number of threads may push, otherwise one at a
+// time. One thread at a time pops. A producer preempted between claiming a
+// slot and writing it holds the consumer up until it is done or lapped.
+template <typename T, bool MultiProducer>
+class basic_concurrent_circular_q {
+    static_assert(std::is_trivially_copyable_v<T>);
+
+public:
+    using value_type = T;
+
+    explicit basic_concurrent_circular_q(size_t max_items)
+      : mask_(std::bit_ceil(max_items > 0 ? max_items : size_t(1)) - 1)
+      , slots_(std::make_unique<slot[]>(mask_ + 1)) {}
+
+    basic_concurrent_circular_q(const basic_concurrent_circular_q&) = delete;
+    basic_concurrent_circular_q& operator=(const basic_concurrent_circular_q&) = delete;
+
+    // push back, overrun (oldest) item if no room left
+    void push_back(const T& item) noexcept {
+        if constexpr (MultiProducer) {
+            write(tail_.value.fetch_add(1, std::memory_order_acq_rel), item);
+        } else {
+            auto pos = tail_.value.load(std::memory_order_relaxed);
+            write(pos, item);
+            tail_.value.store(pos + 1, std::memory_order_release);
+        }
+    }
+
+    // push all of `items`, a single claim on the tail for many producers.
+    void push_n(std::span<const T> items) noexcept {
+        if (items.empty()) {
+            return;
+        }
+        std::uint64_t pos;
+        if constexpr (MultiProducer) {
+            pos = tail_.value.fetch_add(items.size(), std::memory_order_acq_rel);
+        } else {
+            pos = tail_.value.load(std::memory_order_relaxed);
+        }
+        // the first ones would be overwritten by the last ones right away
+        auto skip = items.size() > capacity() ? items.size() - capacity() : 0;
+        for (auto i = skip; i < items.size(); ++i) {
+            write(pos + i, items[i]);
+        }
+        if constexpr (!MultiProducer) {
+            tail_.value.store(pos + items.size(), std::memory_order_release);
+        }
+    }
+
+    // Pop the oldest item into `item`. Returns false if there is none.
+    bool pop_front(T& item) noexcept { return !pop_n(std::span<T>(&item, 1)).empty(); }
+
+    // Pop up to `out.size()` of the oldest items into `out`, returns the
+    // part of `out` filled.
+    std::span<T> pop_n(std::span<T> out) noexcept {
+        auto head = head_.value.load(std::memory_order_relaxed);
+        size_t n = 0;
+        while (n < out.size()) {
+            auto tail = tail_.value.load(std::memory_order_acquire);
+            if (tail - head > capacity()) {
+                // lapped, the oldest are gone
+                overrun_counter_.fetch_add(tail - capacity() - head,
+                                           std::memory_order_relaxed);
+                head = tail - capacity();
+            }
+            if (head == tail) {
+                break;
+            }
+
+            auto& s = slots_[head & mask_];
+            auto ready = 2 * head + 2;
+            auto seq = s.seq.load(std::memory_order_acquire);
+            if (seq < ready) {
+                // claimed by a producer, not written yet
+                break;
+            }
+            if (seq == ready) {
+                std::memcpy(&out[n], &s.value, sizeof(T));
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (s.seq.load(std::memory_order_relaxed) == ready) {
+                    ++n;
+                    ++head;
+                }
+            }
+            // otherwise overwritten meanwhile, the tail tells by how much
+        }
+        head_.value.store(head, std::memory_order_release);
+        return out.first(n);
+    }
+
+    // Return number of elements actually stored, approximate while pushes
+    // and pops run.
+    size_t size() const noexcept {
+        auto head = head_.value.load(std::memory_order_acquire);
+        auto tail = tail_.value.load(std::memory_order_acquire);
+        return tail - head > capacity() ? capacity() : tail - head;
+    }
+
+    bool empty() const noexcept { return size() == 0; }
+
+    size_t capacity() const noexcept { return mask_ + 1; }
+
+    // Items lost to overruns, counted once the consumer skips them.
+    size_t overrun_counter() const noexcept {
+        return overrun_counter_.load(std::memory_order_relaxed);
+    }
+
+private:
+    // `seq` is 2 * pos + 1 while position `pos` is written, 2 * pos + 2 once
+    // it is readable.
+    struct slot {
+        std::atomic<std::uint64_t> seq{0};
+        T value;
+    };
+
+    struct alignas(64) position {
+        std::atomic<std::uint64_t> value{0};
+    };
+
+    void write(std::uint64_t pos, const T& item) noexcept {
+        auto& s = slots_[pos & mask_];
+        auto writing = 2 * pos + 1;
+        if constexpr (MultiProducer) {
+            auto seq = s.seq.load(std::memory_order_relaxed);
+            for (;;) {
+                if (seq >= writing) {
+                    // a newer position took the slot, this item is overrun
+                    return;
+                }
+                if ((seq & 1) != 0) {
+                    // wait for the older write to finish
+                    seq = s.seq.load(std::memory_order_relaxed);
+                } else if (s.seq.compare_exchange_weak(
+                               seq, writing, std::memory_order_relaxed)) {
+                    break;
+                }
+            }
+        } else {
+            s.seq.store(writing, std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_release);
+        std::memcpy(&s.value, &item, sizeof(T));
+        s.seq.store(writing + 1, std::memory_order_release);
+    }
+
+    const size_t mask_;
+    std::unique_ptr<slot[]> slots_;
+    position head_;
+    std::atomic<size_t> overrun_counter_{0};
+    position tail_;
+};
+
+template <typename T>
+using spsc_circular_q = basic_concurrent_circular_q<T, false>;
+
+template <typename T>
+using mpsc_circular_q = basic_concurrent_circular_q<T, true>;
+
+}  // namespace agrpc
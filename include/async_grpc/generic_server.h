@@ -0,0 +1,65 @@
+// generic server calls on raw ByteBuffers, routed by method name.
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <async_grpc/grpc_executor.h>
+#include <async_grpc/rpcs.h>
+#include <grpcpp/generic/async_generic_service.h>
+#include <grpcpp/support/byte_buffer.h>
+#include <grpcpp/support/status.h>
+#include <unifex/task.hpp>
+
+namespace agrpc {
+
+// Handler of a generic unary call: the request as received and the reply to
+// send, neither parsed nor serialized. Both are slice-backed, e.g. an echo
+// hands the request slices on without copying them. The context is the
+// handler's to add initial and trailing metadata to.
+using generic_handler = std::function<unifex::task<grpc::Status>(
+    grpc::GenericServerContext&, const grpc::ByteBuffer&, grpc::ByteBuffer&)>;
+
+// Handlers by method name, "/package.Service/Method", no generated code
+// needed. A call goes to its exact method, else to the longest matching
+// prefix, else to the fallback, else it gets UNIMPLEMENTED.
+class generic_router {
+public:
+    void add(std::string method, generic_handler handler);
+    // e.g. "/package.Service/" for all methods of a service
+    void add_prefix(std::string prefix, generic_handler handler);
+    void set_fallback(generic_handler handler);
+
+    // null if nothing takes `method`
+    const generic_handler* route(std::string_view method) const;
+
+private:
+    // looked up by string_view, without a string per call
+    struct method_hash {
+        using is_transparent = void;
+        std::size_t operator()(std::string_view s) const noexcept {
+            return std::hash<std::string_view>{}(s);
+        }
+    };
+
+    std::unordered_map<std::string, generic_handler, method_hash, std::equal_to<>> methods_;
+    // longest first
+    std::vector<std::pair<std::string, generic_handler>> prefixes_;
+    generic_handler fallback_;
+};
+
+// Serve the calls of every method not registered otherwise, through `svc`
+// registered with `ServerBuilder::RegisterAsyncGenericService`. One request
+// and one reply per call. `options.concurrency`, `stats`, `accept_limiter`
+// and `call_limiter` apply as for `async_call_data`.
+unifex::task<void> async_generic_call_data(grpc_executor& ex,
+                                           grpc::AsyncGenericService* svc,
+                                           std::shared_ptr<const generic_router> router,
+                                           call_options options = {});
+
+}  // namespace agrpc
@@ -1,7 +1,15 @@
 #pragma once
 
 #include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <optional>
 #include <utility>
+#include <async_grpc/metrics.h>
+#include <async_grpc/timer_wheel.h>
+#include <grpc/support/time.h>
 #include <grpcpp/alarm.h>
 #include <grpcpp/grpcpp.h>
 #include <unifex/config.hpp>
@@ -27,16 +35,51 @@ struct task_base {
     execute_fn* execute_;
 };
 
+// task due at `deadline_`, linked into the timer wheel until then.
+struct timer_base
+  : task_base
+  , timer_wheel::node {
+    std::chrono::steady_clock::time_point deadline_;
+    // the context shut down before it was due, it completes done
+    bool stopped_ = false;
+};
+
+// Per iteration limit of one source of work in the run loop, 0 is unlimited.
+struct loop_budget {
+    std::size_t events = 0;
+    std::chrono::nanoseconds time{0};
+};
+
+// Each iteration of the run loop takes turns between the local queue, the
+// remote queue and the completion queue, each one within its budget. Smaller
+// budgets trade drain throughput for tail latency.
+//
+// With nothing to do, the loop polls for `idle_spin` before it goes to sleep
+// in the completion queue. Work handed over from other threads meanwhile
+// needs no wakeup, which otherwise costs an alarm and a completion queue
+// round trip. Spinning burns the io thread's core while idle.
+struct loop_options {
+    loop_budget completion_queue{64};
+    loop_budget local{256};
+    loop_budget remote{256};
+    std::chrono::nanoseconds idle_spin{0};
+};
+
 class grpc_context {
 public:
+    using clock = std::chrono::steady_clock;
+    using time_point = clock::time_point;
+
     template <class Func>
     class grpc_sender;
     class schedule_sender;
+    class schedule_at_sender;
     class scheduler;
     using task_queue = unifex::intrusive_queue<task_base, &task_base::next_>;
     using remote_queue =
         unifex::atomic_intrusive_queue<task_base, &task_base::next_>;
-    explicit grpc_context(std::unique_ptr<grpc::CompletionQueue> cq);
+    explicit grpc_context(std::unique_ptr<grpc::CompletionQueue> cq,
+                          loop_options options = {});
     ~grpc_context();
     grpc_context(const grpc_context&) = delete;
     grpc_context& operator=(const grpc_context&) = delete;
@@ -51,36 +94,74 @@ public:
     template <class F>
     grpc_sender<F> async(F&& f);
 
-private:
+    // Run `op` on the io thread, from any thread. For types that embed a
+    // `task_base` instead of allocating one per handoff; `op` must not be
+    // posted again before it ran.
+    void post(task_base* op) { schedule_impl(op); }
+
+    // Whether the calling thread is the one currently inside `run()`.
     bool is_running_on_io_thread() const noexcept;
+
+    // Shut the completion queue down from any thread. `run()` keeps going
+    // until every pending tag came back, runs what is left on the local and
+    // remote queues and returns. Work scheduled after that is never run, and
+    // pending timers never fire.
+    void shutdown();
+
+    // Snapshots of the run loop counters and histograms, from any thread.
+    loop_stats stats() const noexcept;
+    // completion queue events per turn
+    histogram_snapshot cq_batch() const { return cqBatch_.snapshot(); }
+    // time per sleep in the completion queue
+    histogram_snapshot blocked_time() const { return blockedTime_.snapshot(); }
+
+private:
+    struct shutdown_task : task_base {
+        grpc_context* ctx;
+    };
+
+    void shutdown_local() noexcept;
+
     void run_impl(const bool& shouldStop);
 
     void schedule_impl(task_base* op);
     void schedule_local(task_base* op) noexcept;
-    void schedule_local(task_queue ops) noexcept;
     void schedule_remote(task_base* op) noexcept;
 
+    // Timers, on the io thread only.
+    void schedule_timer(timer_base* op) noexcept;
+    void cancel_timer(timer_base* op) noexcept;
+    // (Re)arm `timerAlarm_` for the earliest timer.
+    void update_timer_alarm() noexcept;
+    void on_timer_alarm() noexcept;
+    std::uint64_t to_tick(time_point tp) const noexcept;
+
     inline grpc::CompletionQueue* get_completion_queue() const noexcept {
         return completionQueue_.get();
     }
 
-    // Execute all ready-to-run items on the local queue.
+    // Execute ready-to-run items on the local queue, within the local budget.
     // Will not run other items that were enqueued during the execution of the
     // items that were already enqueued.
     // This bounds the amount of work to a finite amount.
     void execute_pending_local() noexcept;
 
-    // Check if any completion queue items are available and if so add them
-    // to the local queue.
-    void acquire_completion_queue_items();
+    // Execute items handed over by other threads, within the remote budget.
+    // Once `remoteBacklog_` ran dry the remote queue is collected again,
+    // unless it is inactive (`remoteQueueReadSubmitted_`).
+    void execute_pending_remote() noexcept;
 
-    // collect the contents of the remote queue and pass them to schedule_local
+    // Execute completion queue items within the completion queue budget,
+    // waiting for the first one until `deadline`.
     //
-    // Returns true if successful.
+    // Returns false once the completion queue is shut down and drained.
+    bool acquire_completion_queue_items(gpr_timespec deadline);
+
+    // Nothing is ready to run: spin for `idle_spin`, then mark the remote
+    // queue inactive and sleep in the completion queue.
     //
-    // Returns false if some other thread concurrently enqueued work to the
-    // remote queue.
-    bool try_schedule_local_remote_queue_contents() noexcept;
+    // Returns false once the completion queue is shut down and drained.
+    bool wait_for_work();
 
     // Signal the remote queue by grpc::Alarm.
     //
@@ -90,12 +171,55 @@ private:
     void signal_remote_queue();
 
 private:
+    struct loop_counters {
+        std::atomic<std::uint64_t> iterations{0};
+        std::atomic<std::uint64_t> cqEvents{0};
+        std::atomic<std::uint64_t> localEvents{0};
+        std::atomic<std::uint64_t> remoteEvents{0};
+        std::atomic<std::uint64_t> cqExhausted{0};
+        std::atomic<std::uint64_t> localExhausted{0};
+        std::atomic<std::uint64_t> remoteExhausted{0};
+        std::atomic<std::uint64_t> sleeps{0};
+        std::atomic<std::uint64_t> spinWakeups{0};
+        std::atomic<std::uint64_t> alarmWakeups{0};
+        std::atomic<std::uint64_t> timerWakeups{0};
+        std::atomic<std::uint64_t> localScheduled{0};
+        sharded_counter remoteScheduled;
+        std::atomic<std::uint64_t> blockedNs{0};
+        std::atomic<std::uint64_t> busyNs{0};
+    };
+
+    // nanoseconds since the last mark, for the busy/blocked split
+    std::uint64_t mark() noexcept;
+
+    const loop_options options_;
+    loop_counters counters_;
+    histogram cqBatch_;
+    histogram blockedTime_;
+    time_point lastMark_;
     bool remoteQueueReadSubmitted_;
     std::atomic<bool> isNotifing_;
     grpc::Alarm workAlarm_;
     std::unique_ptr<grpc::CompletionQueue> completionQueue_;
+    // no alarm may be set once the queue is shut down, `workAlarm_` is set
+    // from other threads so they check `shutdown_` under the mutex.
+    std::atomic<bool> shutdownRequested_;
+    std::mutex shutdownMutex_;
+    bool shutdown_;
+    shutdown_task shutdownTask_;
     task_queue localQueue_;
     remote_queue remoteQueue_;
+    // collected from `remoteQueue_` but not run yet
+    task_queue remoteBacklog_;
+
+    // timers are bucketed by `timerTick_` since `timerEpoch_`. Only
+    // `timerAlarm_` sits in the completion queue, set for the earliest one.
+    const time_point timerEpoch_;
+    const clock::duration timerTick_;
+    timer_wheel timers_;
+    grpc::Alarm timerAlarm_;
+    bool timerAlarmSet_;
+    std::uint64_t timerAlarmTick_;
 };
 
 template <class F>
@@ -261,6 +385,156 @@ private:
     grpc_context& context_;
 };
 
+class grpc_context::schedule_at_sender {
+    template <typename Receiver>
+    class operation : private timer_base {
+    public:
+        void start() noexcept {
+            if (context_.is_running_on_io_thread()) {
+                start_local();
+            } else {
+                this->execute_ = &on_schedule_complete;
+                context_.schedule_remote(static_cast<task_base*>(this));
+            }
+        }
+
+    private:
+        friend schedule_at_sender;
+
+        // Stop requests may come from any thread. They are forwarded to the
+        // io thread once, as `cancelTask_`.
+        struct cancel_callback {
+            operation& op_;
+            void operator()() noexcept {
+                if (!op_.cancelRequested_.exchange(true, std::memory_order_acq_rel)) {
+                    op_.context_.schedule_impl(&op_.cancelTask_);
+                }
+            }
+        };
+
+        struct cancel_task : task_base {
+            operation* op_;
+        };
+
+        using stop_token_type = unifex::stop_token_type_t<Receiver>;
+        using stop_callback_type =
+            typename stop_token_type::template callback_type<cancel_callback>;
+
+        template <typename Receiver2>
+        explicit operation(grpc_context& context, time_point deadline, Receiver2&& r)
+          : context_(context)
+          , receiver_((Receiver2 &&) r) {
+            this->deadline_ = deadline;
+            cancelTask_.op_ = this;
+            cancelTask_.execute_ = &on_cancel;
+        }
+
+        static void on_schedule_complete(task_base* p, bool) noexcept {
+            static_cast<operation*>(p)->start_local();
+        }
+
+        void start_local() noexcept {
+            if constexpr (!unifex::is_stop_never_possible_v<stop_token_type>) {
+                auto token = unifex::get_stop_token(receiver_);
+                if (token.stop_requested()) {
+                    unifex::set_done(static_cast<Receiver&&>(receiver_));
+                    return;
+                }
+                stopCallback_.emplace(std::move(token), cancel_callback{*this});
+            }
+
+            this->execute_ = &on_timer_expired;
+            context_.schedule_timer(this);
+        }
+
+        static void on_timer_expired(task_base* p, bool) noexcept {
+            auto& self = *static_cast<operation*>(p);
+            // waits for a stop callback running on another thread
+            self.stopCallback_.reset();
+            if (self.cancelRequested_.load(std::memory_order_acquire)) {
+                // `cancelTask_` is queued, it has to run before completion
+                if (self.cancelRan_) {
+                    self.complete_done();
+                } else {
+                    self.expired_ = true;
+                }
+                return;
+            }
+            if (self.stopped_) {
+                self.complete_done();
+                return;
+            }
+            self.complete_value();
+        }
+
+        static void on_cancel(task_base* p, bool) noexcept {
+            auto& self = *static_cast<cancel_task*>(p)->op_;
+            self.cancelRan_ = true;
+            if (self.linked()) {
+                self.context_.cancel_timer(&self);
+                self.stopCallback_.reset();
+                self.complete_done();
+            } else if (self.expired_) {
+                self.complete_done();
+            }
+            // otherwise expired and queued, `on_timer_expired` completes
+        }
+
+        void complete_value() noexcept {
+            if constexpr (unifex::is_nothrow_receiver_of_v<Receiver>) {
+                unifex::set_value(static_cast<Receiver&&>(receiver_));
+            } else {
+                UNIFEX_TRY {
+                    unifex::set_value(static_cast<Receiver&&>(receiver_));
+                }
+                UNIFEX_CATCH(...) {
+                    unifex::set_error(static_cast<Receiver&&>(receiver_),
+                                      std::current_exception());
+                }
+            }
+        }
+
+        void complete_done() noexcept {
+            unifex::set_done(static_cast<Receiver&&>(receiver_));
+        }
+
+        grpc_context& context_;
+        Receiver receiver_;
+        cancel_task cancelTask_;
+        std::atomic<bool> cancelRequested_{false};
+        bool cancelRan_ = false;
+        bool expired_ = false;
+        std::optional<stop_callback_type> stopCallback_;
+    };
+
+public:
+    // clang-format off
+    template <
+      template <typename...> class Variant,
+      template <typename...> class Tuple>
+    using value_types = Variant<Tuple<>>;
+
+    template <template <typename...> class Variant>
+    using error_types = Variant<std::exception_ptr>;
+
+    static constexpr bool sends_done = true;
+
+    template <typename Receiver>
+    operation<std::remove_reference_t<Receiver>> connect(Receiver&& r) && {
+        return operation<std::remove_reference_t<Receiver>>{context_, deadline_,
+             (Receiver &&) r};
+    }
+    // clang-format on
+
+private:
+    friend scheduler;
+    explicit schedule_at_sender(grpc_context& ctx, time_point deadline) noexcept
+      : context_(ctx)
+      , deadline_(deadline) {}
+    grpc_context& context_;
+    time_point deadline_;
+};
+
 class grpc_context::scheduler {
 public:
     scheduler(const scheduler&) noexcept = default;
@@ -269,6 +543,18 @@ public:
 
     schedule_sender schedule() const noexcept { return schedule_sender{*context_}; }
 
+    // unifex time scheduler
+    time_point now() const noexcept { return clock::now(); }
+
+    schedule_at_sender schedule_at(time_point tp) const noexcept {
+        return schedule_at_sender{*context_, tp};
+    }
+
+    template <class Rep, class Period>
+    schedule_at_sender schedule_after(std::chrono::duration<Rep, Period> d) const noexcept {
+        return schedule_at(now() + std::chrono::duration_cast<clock::duration>(d));
+    }
+
 private:
     friend grpc_context;
 
@@ -1,13 +1,22 @@
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
 #include <thread>
 #include <utility>
 #include <async_grpc/grpc_context.h>
+#include <async_grpc/metrics.h>
 #include <async_grpc/rate.h>
+#include <async_grpc/work_stealing_pool.h>
+#include <async_grpc/worker_pool.h>
 #include <grpcpp/completion_queue.h>
 #include <unifex/async_scope.hpp>
 #include <unifex/inplace_stop_token.hpp>
-#include <unifex/static_thread_pool.hpp>
+#include <unifex/just_from.hpp>
+#include <unifex/scheduler_concepts.hpp>
+#include <unifex/sequence.hpp>
 #include <unifex/then.hpp>
 
 namespace agrpc {
@@ -19,12 +28,38 @@ inline constexpr auto discard = unifex::then(sink);
 // clang-format on
 }  // namespace detail
 
+// calls that finished while draining, and those cancelled by the deadline.
+struct drain_stats {
+    std::uint64_t completed = 0;
+    std::uint64_t cancelled = 0;
+};
+
 class grpc_executor {
 public:
+    // blocking work on a `work_stealing_pool` of `count` threads
     explicit grpc_executor(std::unique_ptr<grpc::CompletionQueue> cq,
-                           int count = std::thread::hardware_concurrency())
-      : grpc_ctx(std::move(cq))
-      , pool_ctx(count) {}
+                           int count = std::thread::hardware_concurrency(),
+                           loop_options options = {})
+      : grpc_executor(std::move(cq),
+                      std::make_unique<work_stealing_pool>(work_stealing_pool::options{
+                          .threads = static_cast<std::size_t>(std::max(count, 1))}),
+                      options) {}
+
+    // blocking work on `pool`, e.g. a pinned `work_stealing_pool`
+    grpc_executor(std::unique_ptr<grpc::CompletionQueue> cq,
+                  std::unique_ptr<worker_pool> pool,
+                  loop_options options = {})
+      : grpc_ctx(std::move(cq), options)
+      , own_pool_ctx(std::move(pool))
+      , pool_ctx(*own_pool_ctx) {}
+
+    // share `pool` with other executors, e.g. the shards of a
+    // `grpc_sharded_executor`. `pool` must outlive the executor.
+    grpc_executor(std::unique_ptr<grpc::CompletionQueue> cq,
+                  worker_pool& pool,
+                  loop_options options = {})
+      : grpc_ctx(std::move(cq), options)
+      , pool_ctx(pool) {}
 
     ~grpc_executor() { scope.request_stop(); }
 
@@ -36,6 +71,7 @@ public:
     inline auto get_grpc_scheduler() { return grpc_ctx.get_scheduler(); }
     inline auto get_thread_scheduler() { return pool_ctx.get_scheduler(); }
     agrpc::grpc_context& get_grpc_context() { return grpc_ctx; }
+    worker_pool& get_worker_pool() { return pool_ctx; }
 
     template <class Sender>
     inline void spawn_local(Sender&& sender) {
@@ -45,8 +81,18 @@ public:
 
     template <class Sender>
     inline void spawn_blocking(Sender&& sender) {
-        scope.spawn_on(pool_ctx.get_scheduler(),
-                       detail::discard((Sender &&) sender));
+        scope.spawn(on_pool(detail::discard((Sender &&) sender)));
+    }
+
+    // `sender` on the thread pool, counted in the pool backlog until it
+    // starts there.
+    template <class Sender>
+    inline auto on_pool(Sender&& sender) {
+        return unifex::sequence(
+            unifex::just_from([this]() noexcept { poolSubmitted_.add(); }),
+            unifex::schedule(pool_ctx.get_scheduler()),
+            unifex::just_from([this]() noexcept { poolStarted_.add(); }),
+            (Sender &&) sender);
     }
 
     // notice: sender return void & noexcept
@@ -70,10 +116,72 @@ public:
         grpc_ctx.run((StopToken &&) token);
     }
 
+    // Graceful shutdown, from a thread other than the one in `run()`: stop
+    // accepting calls, give in-flight calls until `deadline` before the
+    // server cancels them, wait for their handlers, then drain the completion
+    // queue so that `run()` returns.
+    template <class Deadline>
+    drain_stats drain(grpc::Server& server, const Deadline& deadline) {
+        begin_drain();
+        server.Shutdown(deadline);
+        return end_drain();
+    }
+
+    // The two halves of `drain()`, for executors sharing a server.
+    void begin_drain() noexcept { draining_.store(true); }
+
+    drain_stats end_drain() {
+        for (auto n = inflight_.load(); n != 0; n = inflight_.load()) {
+            inflight_.wait(n);
+        }
+        grpc_ctx.shutdown();
+        return {completed_.load(), cancelled_.load()};
+    }
+
+    // Whether accept loops should stop posting new requests.
+    bool draining() const noexcept {
+        return draining_.load(std::memory_order_relaxed);
+    }
+
+    // Snapshot of the run loop and thread pool counters, from any thread.
+    executor_metrics metrics() const {
+        executor_metrics m;
+        m.loop = grpc_ctx.stats();
+        m.cq_batch = grpc_ctx.cq_batch();
+        m.blocked_ns = grpc_ctx.blocked_time();
+        // started before submitted: work is counted submitted before it starts
+        m.pool_started = poolStarted_.load();
+        m.pool_submitted = poolSubmitted_.load();
+        m.calls_inflight = inflight_.load(std::memory_order_relaxed);
+        m.pool = pool_ctx.stats();
+        return m;
+    }
+
+    // Bookkeeping of accepted server calls, for `drain()`. A call is
+    // completed if its status reached the client.
+    void call_started() noexcept { inflight_.fetch_add(1, std::memory_order_relaxed); }
+
+    void call_finished(bool completed) noexcept {
+        if (draining()) {
+            (completed ? completed_ : cancelled_).fetch_add(1, std::memory_order_relaxed);
+        }
+        // seq_cst, pairs with `begin_drain()` and the load in `end_drain()`
+        if (inflight_.fetch_sub(1) == 1 && draining_.load()) {
+            inflight_.notify_all();
+        }
+    }
+
 private:
     unifex::async_scope scope;
     agrpc::grpc_context grpc_ctx;
-    unifex::static_thread_pool pool_ctx;
+    std::unique_ptr<worker_pool> own_pool_ctx;
+    worker_pool& pool_ctx;
+    std::atomic<bool> draining_{false};
+    std::atomic<std::int64_t> inflight_{0};
+    std::atomic<std::uint64_t> completed_{0};
+    std::atomic<std::uint64_t> cancelled_{0};
+    sharded_counter poolSubmitted_;
+    sharded_counter poolStarted_;
 };
 
 }  // namespace agrpc
@@ -0,0 +1,203 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <async_grpc/grpc_executor.h>
+#include <async_grpc/work_stealing_pool.h>
+#include <async_grpc/worker_pool.h>
+#include <grpcpp/completion_queue.h>
+#include <grpcpp/server_builder.h>
+#include <unifex/inplace_stop_token.hpp>
+
+namespace agrpc {
+
+//
+// N `grpc_executor`s, each one owning a completion queue and driven by its
+// own thread, pinned to one of the cpus the process may run on. All shards
+// share one worker pool for blocking work, by default a `work_stealing_pool`
+// of `count` threads.
+//
+// Server side, start the accept loops on every shard:
+//
+//     ex.for_each_shard([&](agrpc::grpc_executor& shard) {
+//         shard.spawn_local(agrpc::async_call_data<Req, Rep>(shard, ...));
+//     });
+//
+class grpc_sharded_executor {
+public:
+    explicit grpc_sharded_executor(
+        std::vector<std::unique_ptr<grpc::CompletionQueue>> cqs,
+        int count = std::thread::hardware_concurrency(),
+        bool pin = true,
+        loop_options options = {})
+      : grpc_sharded_executor(std::move(cqs), make_pool(count), pin, options) {}
+
+    // blocking work on `pool`, e.g. a `work_stealing_pool` pinned to the
+    // NUMA node of the shards.
+    grpc_sharded_executor(std::vector<std::unique_ptr<grpc::CompletionQueue>> cqs,
+                          std::unique_ptr<worker_pool> pool,
+                          bool pin = true,
+                          loop_options options = {})
+      : pool_ctx(std::move(pool))
+      , pin_(pin) {
+        shards_.reserve(cqs.size());
+        for (auto& cq : cqs) {
+            shards_.push_back(
+                std::make_unique<grpc_executor>(std::move(cq), *pool_ctx, options));
+        }
+    }
+
+    // add `shards` completion queues to `builder`, one per shard.
+    grpc_sharded_executor(grpc::ServerBuilder& builder,
+                          std::size_t shards,
+                          int count = std::thread::hardware_concurrency(),
+                          bool pin = true,
+                          loop_options options = {})
+      : grpc_sharded_executor(builder, shards, make_pool(count), pin, options) {}
+
+    grpc_sharded_executor(grpc::ServerBuilder& builder,
+                          std::size_t shards,
+                          std::unique_ptr<worker_pool> pool,
+                          bool pin = true,
+                          loop_options options = {})
+      : pool_ctx(std::move(pool))
+      , pin_(pin) {
+        shards_.reserve(shards);
+        for (std::size_t i = 0; i < shards; ++i) {
+            shards_.push_back(std::make_unique<grpc_executor>(
+                builder.AddCompletionQueue(), *pool_ctx, options));
+        }
+    }
+
+    grpc_sharded_executor(const grpc_sharded_executor&) = delete;
+    grpc_sharded_executor& operator=(const grpc_sharded_executor&) = delete;
+    grpc_sharded_executor(grpc_sharded_executor&&) = delete;
+    grpc_sharded_executor& operator=(grpc_sharded_executor&&) = delete;
+
+    inline std::size_t size() const noexcept { return shards_.size(); }
+    inline grpc_executor& shard(std::size_t i) { return *shards_[i]; }
+    inline auto get_thread_scheduler() { return pool_ctx->get_scheduler(); }
+    worker_pool& get_worker_pool() { return *pool_ctx; }
+
+    template <class F>
+    inline void for_each_shard(F&& f) {
+        for (auto& s : shards_) {
+            f(*s);
+        }
+    }
+
+    // The shard driven by the calling thread, or nullptr.
+    grpc_executor* current_shard() noexcept {
+        for (auto& s : shards_) {
+            if (s->get_grpc_context().is_running_on_io_thread()) {
+                return s.get();
+            }
+        }
+        return nullptr;
+    }
+
+    // Stay on the calling shard when there is one, so continuations do not
+    // hop between completion queues. Otherwise round-robin.
+    grpc_executor& pick() noexcept {
+        if (auto* s = current_shard()) {
+            return *s;
+        }
+        auto i = next_.fetch_add(1, std::memory_order_relaxed);
+        return *shards_[i % shards_.size()];
+    }
+
+    template <class Sender>
+    inline void spawn_local(Sender&& sender) {
+        pick().spawn_local((Sender &&) sender);
+    }
+
+    template <class Sender>
+    inline void spawn_blocking(Sender&& sender) {
+        pick().spawn_blocking((Sender &&) sender);
+    }
+
+    template <class F>
+    inline auto async(F&& f) {
+        return pick().async(std::forward<F>(f));
+    }
+
+    // Run shard 0 on the calling thread and every other shard on a thread of
+    // its own. Returns when all shards returned.
+    //
+    // Shard i is pinned to the i-th cpu the calling thread may run on, the
+    // calling thread itself only with `pin_caller`; it gets its cpus back
+    // once `run()` returns.
+    template <class StopToken = unifex::inplace_stop_token>
+    void run(StopToken token = {}, bool pin_caller = false) {
+        auto cpus = pin_ ? detail::allowed_cpus() : std::vector<int>();
+        auto cpu_of = [&](std::size_t i) {
+            return std::vector<int>{cpus[i % cpus.size()]};
+        };
+        std::vector<std::thread> threads;
+        threads.reserve(shards_.size());
+        for (std::size_t i = 1; i < shards_.size(); ++i) {
+            auto pinned = cpus.empty() ? std::vector<int>() : cpu_of(i);
+            threads.emplace_back([this, i, token, pinned]() {
+                detail::set_current_thread_cpus(pinned);
+                shards_[i]->run(token);
+            });
+        }
+
+        pin_caller = pin_caller && !cpus.empty();
+        if (pin_caller) {
+            detail::set_current_thread_cpus(cpu_of(0));
+        }
+        shards_[0]->run(token);
+        if (pin_caller) {
+            detail::set_current_thread_cpus(cpus);
+        }
+
+        for (auto& th : threads) {
+            th.join();
+        }
+    }
+
+    // `grpc_executor::metrics` summed over the shards.
+    executor_metrics metrics() const {
+        executor_metrics m;
+        for (auto& s : shards_) {
+            m.merge(s->metrics());
+        }
+        m.pool = pool_ctx->stats();
+        return m;
+    }
+
+    // `grpc_executor::drain` over all shards of `server`.
+    template <class Deadline>
+    drain_stats drain(grpc::Server& server, const Deadline& deadline) {
+        for (auto& s : shards_) {
+            s->begin_drain();
+        }
+        server.Shutdown(deadline);
+        drain_stats stats;
+        for (auto& s : shards_) {
+            auto shard = s->end_drain();
+            stats.completed += shard.completed;
+            stats.cancelled += shard.cancelled;
+        }
+        return stats;
+    }
+
+private:
+    static std::unique_ptr<worker_pool> make_pool(int count) {
+        return std::make_unique<work_stealing_pool>(work_stealing_pool::options{
+            .threads = static_cast<std::size_t>(std::max(count, 1))});
+    }
+
+    std::unique_ptr<worker_pool> pool_ctx;
+    std::vector<std::unique_ptr<grpc_executor>> shards_;
+    std::atomic<std::size_t> next_{0};
+    bool pin_;
+};
+
+}  // namespace agrpc
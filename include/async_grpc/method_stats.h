@@ -0,0 +1,88 @@
+// per method latency histograms.
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <async_grpc/metrics.h>
+
+namespace agrpc {
+
+// Latencies of one method in nanoseconds, recorded by the library when
+// passed through `call_options::stats` or `client_options::stats`:
+//
+//   queue   - server: accepted until the handler started
+//   handler - server: the handler itself
+//   write   - server: handler done until `Finish` completed
+//   client  - client: the whole call
+//
+// Every thread records into a shard of its own, allocated on first use, so
+// memory stays fixed and recording takes no lock. Reads merge the shards.
+class method_stats {
+public:
+    using clock = std::chrono::steady_clock;
+
+    enum kind { queue, handler, write, client, kinds };
+
+    struct snapshot_type {
+        std::string name;
+        std::array<histogram_snapshot, kinds> latency;
+
+        const histogram_snapshot& operator[](kind k) const { return latency[k]; }
+    };
+
+    explicit method_stats(std::string name);
+    ~method_stats();
+
+    method_stats(const method_stats&) = delete;
+    method_stats& operator=(const method_stats&) = delete;
+
+    void record(kind k, clock::duration d) noexcept {
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(d).count();
+        local().latency[k].record(ns > 0 ? static_cast<std::uint64_t>(ns) : 0);
+    }
+
+    const std::string& name() const noexcept { return name_; }
+    snapshot_type snapshot() const;
+
+private:
+    struct shard {
+        std::array<histogram, kinds> latency;
+    };
+
+    shard& local() noexcept;
+
+    std::string name_;
+    std::array<std::atomic<shard*>, sharded_counter::kShards> shards_{};
+};
+
+std::string to_json(const method_stats::snapshot_type& s);
+
+// Owns the `method_stats` of a process, by name.
+class stats_registry {
+public:
+    // The stats of `name`, created on first use. The reference stays valid
+    // for the lifetime of the registry.
+    method_stats& get(std::string_view name);
+
+    std::vector<method_stats::snapshot_type> snapshot() const;
+
+    // Write one JSON object per method and line to `path`. Returns false if
+    // the file could not be written.
+    bool dump(const std::string& path) const;
+
+private:
+    mutable std::mutex mutex_;
+    std::map<std::string, std::unique_ptr<method_stats>, std::less<>> methods_;
+};
+
+// registry used unless one is passed explicitly
+stats_registry& default_stats_registry();
+
+}  // namespace agrpc
@@ -0,0 +1,169 @@
+// always-on runtime counters and histograms.
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace agrpc {
+
+namespace detail {
+// Slot of the calling thread in a `sharded_counter`.
+std::size_t thread_shard() noexcept;
+
+// counters with a single writer skip the locked add
+inline void bump(std::atomic<std::uint64_t>& counter, std::uint64_t n = 1) noexcept {
+    counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+}  // namespace detail
+
+// Counter bumped from many threads. Each thread adds to a cache line of its
+// own, reads sum them up.
+class sharded_counter {
+public:
+    static constexpr std::size_t kShards = 16;
+
+    void add(std::uint64_t n = 1) noexcept {
+        shards_[detail::thread_shard()].value.fetch_add(n, std::memory_order_relaxed);
+    }
+
+    std::uint64_t load() const noexcept {
+        std::uint64_t sum = 0;
+        for (auto& s : shards_) {
+            sum += s.value.load(std::memory_order_relaxed);
+        }
+        return sum;
+    }
+
+private:
+    struct alignas(64) shard {
+        std::atomic<std::uint64_t> value{0};
+    };
+    std::array<shard, kShards> shards_;
+};
+
+// Plain copy of a `histogram`, mergeable and queried for percentiles.
+struct histogram_snapshot {
+    std::vector<std::uint64_t> buckets;
+    std::uint64_t count = 0;
+    std::uint64_t sum = 0;
+    std::uint64_t max = 0;
+
+    void merge(const histogram_snapshot& other);
+
+    // Upper bound of the bucket holding quantile `q` (0..1), at most 1/16
+    // above the recorded value. 0 if empty.
+    std::uint64_t percentile(double q) const noexcept;
+
+    double mean() const noexcept {
+        return count == 0 ? 0 : static_cast<double>(sum) / static_cast<double>(count);
+    }
+};
+
+// Log-linear histogram of non-negative values in fixed memory: every power of
+// two range is split into 16 linear buckets, so any value lands in a bucket
+// within 1/16 of it. Recording is a few relaxed atomic adds.
+class histogram {
+public:
+    static constexpr int kSubBits = 4;
+    static constexpr std::size_t kSub = std::size_t(1) << kSubBits;
+    static constexpr std::size_t kBuckets = (64 - kSubBits + 1) * kSub;
+
+    void record(std::uint64_t value) noexcept;
+
+    histogram_snapshot snapshot() const;
+
+    // the bucket of `value`, and the range [lower, upper] of bucket `i`
+    static std::size_t bucket_of(std::uint64_t value) noexcept;
+    static std::uint64_t bucket_lower(std::size_t i) noexcept;
+    static std::uint64_t bucket_upper(std::size_t i) noexcept;
+
+private:
+    std::array<std::atomic<std::uint64_t>, kBuckets> buckets_{};
+    std::atomic<std::uint64_t> sum_{0};
+    std::atomic<std::uint64_t> max_{0};
+};
+
+// Run loop counters of a `grpc_context`. `*_exhausted` count the turns that
+// left work behind because the budget ran out.
+struct loop_stats {
+    std::uint64_t iterations = 0;
+    std::uint64_t cq_events = 0;
+    std::uint64_t local_events = 0;
+    std::uint64_t remote_events = 0;
+    std::uint64_t cq_exhausted = 0;
+    std::uint64_t local_exhausted = 0;
+    std::uint64_t remote_exhausted = 0;
+    // times the loop went to sleep, and spins that found work instead
+    std::uint64_t sleeps = 0;
+    std::uint64_t spin_wakeups = 0;
+    // `workAlarm_` and timer alarm completions
+    std::uint64_t alarm_wakeups = 0;
+    std::uint64_t timer_wakeups = 0;
+    std::uint64_t local_scheduled = 0;
+    std::uint64_t remote_scheduled = 0;
+    // wall time of the io thread asleep in the completion queue vs. running
+    std::uint64_t blocked_ns = 0;
+    std::uint64_t busy_ns = 0;
+
+    // items waiting, approximate while the loop runs: the counters are read
+    // one by one, the events may be ahead of the scheduled
+    std::uint64_t local_depth() const noexcept {
+        return local_scheduled > local_events ? local_scheduled - local_events : 0;
+    }
+    std::uint64_t remote_depth() const noexcept {
+        return remote_scheduled > remote_events ? remote_scheduled - remote_events : 0;
+    }
+};
+
+// Counters of a `worker_pool`. `stolen` counts the tasks a worker took off
+// the queues of another one.
+struct worker_pool_stats {
+    std::uint64_t submitted = 0;
+    std::uint64_t executed = 0;
+    std::uint64_t stolen = 0;
+    std::uint64_t steal_attempts = 0;
+    // times a worker went to sleep with nothing to do
+    std::uint64_t parks = 0;
+    // tasks queued per worker, approximate while the pool runs
+    std::vector<std::uint64_t> depth;
+
+    // the counters are read one by one, `executed` may be ahead
+    std::uint64_t queued() const noexcept {
+        return submitted > executed ? submitted - executed : 0;
+    }
+    double steal_rate() const noexcept {
+        return executed == 0 ? 0 : static_cast<double>(stolen) / static_cast<double>(executed);
+    }
+};
+
+// Snapshot of a `grpc_executor`, or the sum of the shards of a
+// `grpc_sharded_executor`.
+struct executor_metrics {
+    loop_stats loop;
+    // completion queue events per turn, and time per sleep
+    histogram_snapshot cq_batch;
+    histogram_snapshot blocked_ns;
+    // work handed to the thread pool, and how much of it started
+    std::uint64_t pool_submitted = 0;
+    std::uint64_t pool_started = 0;
+    std::int64_t calls_inflight = 0;
+    // the worker pool, shared by the shards so not summed by `merge`
+    worker_pool_stats pool;
+
+    // the counters are read one by one, `pool_started` may be ahead
+    std::uint64_t pool_backlog() const noexcept {
+        return pool_submitted > pool_started ? pool_submitted - pool_started : 0;
+    }
+
+    void merge(const executor_metrics& other);
+};
+
+std::string to_json(const histogram_snapshot& h);
+std::string to_json(const worker_pool_stats& s);
+std::string to_json(const executor_metrics& m);
+
+}  // namespace agrpc
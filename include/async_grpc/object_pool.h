@@ -0,0 +1,58 @@
+// free list of reusable objects.
+#pragma once
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace agrpc {
+
+// Recycles objects instead of deleting them. Released objects are `reset()`
+// and handed out again by `acquire()`; at most `capacity` of them are kept.
+//
+// Not thread safe: a pool is owned by one `grpc_context` and only touched
+// from its thread.
+template <typename T>
+class object_pool {
+public:
+    explicit object_pool(std::size_t capacity) : capacity_(capacity) {
+        free_.reserve(capacity_);
+    }
+
+    ~object_pool() {
+        for (auto* p : free_) {
+            delete p;
+        }
+    }
+
+    object_pool(const object_pool&) = delete;
+    object_pool& operator=(const object_pool&) = delete;
+
+    // Return a pooled object, or construct a new one from `args`.
+    template <typename... Args>
+    T* acquire(Args&&... args) {
+        if (free_.empty()) {
+            return new T(std::forward<Args>(args)...);
+        }
+        auto* p = free_.back();
+        free_.pop_back();
+        return p;
+    }
+
+    void release(T* p) noexcept {
+        if (free_.size() >= capacity_) {
+            delete p;
+            return;
+        }
+        p->reset();
+        free_.push_back(p);
+    }
+
+    std::size_t size() const noexcept { return free_.size(); }
+
+private:
+    std::size_t capacity_;
+    std::vector<T*> free_;
+};
+
+}  // namespace agrpc
@@ -0,0 +1,34 @@
+// pass-through proxy of any method to a backend.
+#pragma once
+
+#include <async_grpc/channel_pool.h>
+#include <async_grpc/grpc_executor.h>
+#include <async_grpc/rpcs.h>
+#include <grpcpp/generic/async_generic_service.h>
+#include <grpcpp/generic/generic_stub.h>
+#include <unifex/task.hpp>
+
+namespace agrpc {
+
+// Forward every call on `svc`, registered with
+// `ServerBuilder::RegisterAsyncGenericService`, to the same method of
+// `backend`. Unary and streaming calls alike: messages go both ways as they
+// come, as ByteBuffers whose slices are handed on without a copy or a parse.
+//
+// The client's metadata and deadline go to the backend, and cancellation with
+// them. The backend's initial and trailing metadata and its status come
+// back. `options.concurrency`, `stats`, `accept_limiter` and `call_limiter`
+// apply as for `async_call_data`, the handler time being the time until the
+// backend finished.
+unifex::task<void> async_proxy(grpc_executor& ex,
+                               grpc::AsyncGenericService* svc,
+                               grpc::GenericStub& backend,
+                               call_options options = {});
+
+// Every call on the channel of `backends` with the fewest calls in flight.
+unifex::task<void> async_proxy(grpc_executor& ex,
+                               grpc::AsyncGenericService* svc,
+                               stub_pool<grpc::GenericStub>& backends,
+                               call_options options = {});
+
+}  // namespace agrpc
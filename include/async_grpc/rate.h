@@ -1,9 +1,22 @@
 #pragma once
 
+#include <atomic>
 #include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <async_grpc/grpc_context.h>
+#include <unifex/task.hpp>
 
 namespace agrpc {
 
+// Blocks the calling thread, never use it on the io thread; see
+// `rate_limiter` instead.
 class Rate {
 public:
     Rate();
@@ -16,4 +29,102 @@ private:
     mutable std::chrono::steady_clock::time_point start_;
 };
 
-} // namespace cc
+// `rate` tokens per second, holding up to `burst` of them. Lock-free, may
+// be shared by any number of threads.
+//
+// Tokens are handed out as reservations: `reserve` always takes a token and
+// tells when it is due, so waiters are served in order without a queue. The
+// bucket keeps time in nanoseconds, the long term rate stays exact even when
+// a waiter wakes up late.
+class token_bucket {
+public:
+    using clock = std::chrono::steady_clock;
+
+    token_bucket(double rate, double burst);
+
+    // Take a token, returns when it may be used; now or earlier if one was
+    // available.
+    clock::time_point reserve(clock::time_point now = clock::now()) noexcept;
+
+    // Take a token only if one is available now.
+    bool try_acquire(clock::time_point now = clock::now()) noexcept;
+
+    // Whether the bucket is full, i.e. indistinguishable from a new one.
+    bool idle(clock::time_point now = clock::now()) const noexcept;
+
+private:
+    std::int64_t ticks(clock::time_point tp) const noexcept;
+
+    // nanoseconds per token, and of a full bucket
+    const std::int64_t interval_;
+    const std::int64_t capacity_;
+    // when the bucket would be full again (GCRA theoretical arrival time)
+    std::atomic<std::int64_t> full_at_;
+};
+
+// Async token bucket on the timers of a grpc_context. `acquire` completes
+// once a token is available, suspended on a timer instead of blocking the
+// thread. Timers tick in milliseconds: above 1000/s tokens come in small
+// bursts per tick, at the configured rate overall.
+//
+// Pace a client fan-out with `client_options::limiter`, cap the accept rate
+// of a method with `call_options::accept_limiter`.
+class rate_limiter {
+public:
+    rate_limiter(grpc_context& ctx, double rate, double burst = 1);
+
+    // May be awaited from any thread, completes on the io thread if it had
+    // to wait.
+    unifex::task<void> acquire();
+
+    bool try_acquire() noexcept { return bucket_.try_acquire(); }
+
+private:
+    grpc_context& ctx_;
+    token_bucket bucket_;
+};
+
+// One bucket per key, e.g. per peer or per tenant, all with the same rate and
+// burst. Buckets are created on first use, at most `max_keys` of them: a new
+// key takes the place of the least recently used one. That loses nothing if
+// it was idle, since a full bucket is as good as a new one; otherwise its key
+// starts over with a full burst.
+class keyed_rate_limiter {
+public:
+    keyed_rate_limiter(grpc_context& ctx,
+                       double rate,
+                       double burst = 1,
+                       std::size_t max_keys = 4096);
+
+    // `key` is copied, the task runs lazily
+    unifex::task<void> acquire(std::string key);
+
+    bool try_acquire(std::string_view key);
+
+    std::size_t size() const;
+
+private:
+    struct entry {
+        entry(std::string key, double rate, double burst)
+          : key(std::move(key))
+          , bucket(rate, burst) {}
+
+        std::string key;
+        token_bucket bucket;
+    };
+
+    // the bucket of `key`, with `mutex_` held; it becomes the most recently
+    // used
+    token_bucket& bucket(std::string_view key);
+
+    grpc_context& ctx_;
+    const double rate_;
+    const double burst_;
+    const std::size_t maxKeys_;
+    mutable std::mutex mutex_;
+    // most recently used first
+    std::list<entry> lru_;
+    std::unordered_map<std::string_view, std::list<entry>::iterator> index_;
+};
+
+}  // namespace agrpc
@@ -0,0 +1,79 @@
+// server side cache of unary replies.
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <async_grpc/metrics.h>
+#include <async_grpc/sharded_lru.h>
+#include <google/protobuf/message.h>
+#include <grpcpp/server_context.h>
+
+namespace agrpc {
+
+// Replies of one unary method by serialized request, plus the values of
+// `metadata` the reply depends on, see `call_options::cache`. A hit is
+// answered with the cached reply without running the handler. Only replies
+// of handlers that succeeded are cached, for `ttl`, in a
+// `detail::sharded_lru` of `max_bytes`.
+class response_cache {
+public:
+    using clock = std::chrono::steady_clock;
+    using reply_ptr = std::shared_ptr<const google::protobuf::Message>;
+
+    struct options {
+        std::chrono::nanoseconds ttl = std::chrono::seconds(1);
+        std::size_t max_bytes = 64 << 20;
+        std::size_t shards = 16;
+        // client metadata that is part of the key
+        std::vector<std::string> metadata = {};
+    };
+
+    struct stats_type : lru_stats {
+        std::uint64_t hits = 0;
+        std::uint64_t misses = 0;
+        std::uint64_t invalidations = 0;
+    };
+
+    explicit response_cache(options options);
+
+    response_cache(const response_cache&) = delete;
+    response_cache& operator=(const response_cache&) = delete;
+
+    // The key of a call. `metadata_values` in the order of
+    // `options::metadata`, for `invalidate` outside of a call.
+    std::string key_of(const google::protobuf::Message& request,
+                       const grpc::ServerContext& context) const;
+    std::string key_of(const google::protobuf::Message& request,
+                       const std::vector<std::string_view>& metadata_values = {}) const;
+
+    reply_ptr lookup(const std::string& key);
+    void insert(const std::string& key, reply_ptr reply);
+
+    // Drop the reply of `key`, e.g. once the data behind it changed.
+    void invalidate(const std::string& key);
+    void clear();
+
+    stats_type stats() const;
+
+private:
+    struct entry {
+        reply_ptr reply;
+        clock::time_point expires;
+    };
+
+    const options options_;
+    detail::sharded_lru<entry> entries_;
+
+    sharded_counter hits_;
+    sharded_counter misses_;
+    sharded_counter invalidations_;
+};
+
+std::string to_json(const response_cache::stats_type& s);
+
+}  // namespace agrpc
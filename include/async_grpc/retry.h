@@ -0,0 +1,99 @@
+// retries, hedging and the budget capping them.
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <vector>
+#include <async_grpc/method_stats.h>
+#include <grpcpp/support/status.h>
+
+namespace agrpc {
+
+// Caps extra attempts, retries and hedges, to a share of the calls made, so a
+// brownout can't turn into a retry storm. Every call deposits `ratio` of a
+// token, every extra attempt takes a whole one, up to `max_tokens` saved.
+// Starts full, so that light traffic can retry too. Lock-free.
+class retry_budget {
+public:
+    explicit retry_budget(double ratio = 0.1, double max_tokens = 10);
+
+    void deposit() noexcept;
+    bool try_withdraw() noexcept;
+
+    double tokens() const noexcept;
+    // extra attempts made, and those the budget turned down
+    std::uint64_t granted() const noexcept { return granted_.load(std::memory_order_relaxed); }
+    std::uint64_t denied() const noexcept { return denied_.load(std::memory_order_relaxed); }
+
+private:
+    // in thousandths of a token
+    const std::int64_t deposit_;
+    const std::int64_t max_;
+    std::atomic<std::int64_t> tokens_;
+    std::atomic<std::uint64_t> granted_{0};
+    std::atomic<std::uint64_t> denied_{0};
+};
+
+// Quantile `q` of the client latency in `stats`, recomputed at most every
+// `refresh` since merging the shards of the histogram is too slow to do per
+// call. Empty until there are `min_samples`.
+class latency_percentile {
+public:
+    latency_percentile(method_stats& stats,
+                       double q,
+                       std::uint64_t min_samples = 100,
+                       std::chrono::milliseconds refresh = std::chrono::seconds(1));
+
+    std::optional<std::chrono::nanoseconds> get();
+
+private:
+    method_stats& stats_;
+    const double q_;
+    const std::uint64_t minSamples_;
+    const std::chrono::nanoseconds refresh_;
+    // nanoseconds, 0 while unknown
+    std::atomic<std::int64_t> value_{0};
+    std::atomic<std::int64_t> refreshedAt_;
+};
+
+// Extra attempts of a unary client call, see `client_options::retry`.
+//
+// Without a hedge delay, attempts run one after another: a failure with a
+// `retryable` code is retried after a random wait up to the backoff, which
+// grows from `initial_backoff` by `multiplier` up to `max_backoff`.
+//
+// With a hedge delay, another attempt starts whenever the ones in flight got
+// no answer for that long, or right away when one failed with a retryable
+// code. The first success wins and the others get cancelled.
+//
+// Any other failure is final. Attempts beyond the first need a token of
+// `budget`, if there is one.
+struct retry_policy {
+    // attempts in total, the first one included
+    int max_attempts = 3;
+    std::vector<grpc::StatusCode> retryable = {grpc::StatusCode::UNAVAILABLE};
+
+    std::chrono::nanoseconds initial_backoff = std::chrono::milliseconds(50);
+    std::chrono::nanoseconds max_backoff = std::chrono::seconds(1);
+    double multiplier = 2;
+
+    // 0 for sequential retries
+    std::chrono::nanoseconds hedge_delay{0};
+    // hedge after this percentile of the observed latency instead, after
+    // `hedge_delay` until it is known, if set
+    latency_percentile* hedge_percentile = nullptr;
+
+    retry_budget* budget = nullptr;
+
+    bool hedging() const noexcept { return hedge_delay.count() > 0 || hedge_percentile; }
+    bool is_retryable(grpc::StatusCode code) const noexcept;
+
+    // Time until the next hedge, empty while there is no delay to go by.
+    std::optional<std::chrono::nanoseconds> hedge_after() const;
+    // the randomized wait before retry number `retry`, 1 for the first
+    std::chrono::nanoseconds backoff(int retry) const;
+};
+
+}  // namespace agrpc
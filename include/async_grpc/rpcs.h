@@ -1,27 +1,54 @@
 #pragma once
 
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
 #include <functional>
 #include <memory>
 #include <optional>
+#include <string>
+#include <string_view>
 #include <type_traits>
+#include <vector>
 #include <absl/functional/function_ref.h>
+#include <async_grpc/channel_pool.h>
+#include <async_grpc/circular_q.h>
+#include <async_grpc/client_cache.h>
 #include <async_grpc/common.h>
+#include <async_grpc/concurrency_limiter.h>
 #include <async_grpc/grpc_context.h>
 #include <async_grpc/grpc_executor.h>
+#include <async_grpc/method_stats.h>
+#include <async_grpc/object_pool.h>
+#include <async_grpc/rate.h>
+#include <async_grpc/response_cache.h>
+#include <async_grpc/retry.h>
 #include <async_grpc/try.h>
+#include <google/protobuf/arena.h>
 #include <google/protobuf/message.h>
+#include <grpc/support/time.h>
+#include <grpcpp/alarm.h>
 #include <grpcpp/client_context.h>
 #include <grpcpp/server_context.h>
+#include <grpcpp/support/async_stream.h>
 #include <grpcpp/support/async_unary_call.h>
 #include <grpcpp/support/status.h>
+#include <unifex/async_manual_reset_event.hpp>
+#include <unifex/done_as_optional.hpp>
 #include <unifex/just.hpp>
 #include <unifex/just_done.hpp>
 #include <unifex/just_from.hpp>
+#include <unifex/let_done.hpp>
+#include <unifex/let_error.hpp>
 #include <unifex/let_value.hpp>
+#include <unifex/manual_lifetime.hpp>
 #include <unifex/on.hpp>
 #include <unifex/ready_done_sender.hpp>
+#include <unifex/scheduler_concepts.hpp>
+#include <unifex/scope_guard.hpp>
 #include <unifex/stop_if_requested.hpp>
 #include <unifex/stream_concepts.hpp>
+#include <unifex/sync_wait.hpp>
 #include <unifex/tag_invoke.hpp>
 #include <unifex/task.hpp>
 
@@ -33,6 +60,232 @@ inline constexpr auto discard_handle_context = [](auto&&...) {};
 // clang-format on
 }  // namespace detail
 
+struct client_options {
+    // latency histogram of the method, not recorded if null. With `retry`,
+    // of every attempt rather than of the whole call.
+    method_stats* stats = nullptr;
+
+    // calls wait for a token before they start, e.g. to pace a fan-out.
+    rate_limiter* limiter = nullptr;
+
+    // retries and hedged attempts of `async_client_call`, a single attempt if
+    // null. `handle` sets up the context of every attempt.
+    const retry_policy* retry = nullptr;
+
+    // Identical calls of `async_client_call` through the same stub share one
+    // RPC, and their replies get cached. Background refreshes of stale
+    // replies use `stub` after the call returned, it has to outlive the cache.
+    client_cache* cache = nullptr;
+};
+
+namespace detail {
+// One call of `async_client_call` with a `retry_policy`, driven from the io
+// thread. Every attempt runs as a task of its own with its own ClientContext.
+// The caller sleeps on `alarm_` until the next hedge or retry is due, an
+// attempt that completes cancels the alarm to wake it up early.
+//
+// `attempt(context, rep)` makes one attempt, a `unifex::task<grpc::Status>`
+// that fills `rep` on success and completes once `context` is done with.
+// `stats` gets the latency of every attempt that completed before the call
+// was decided; hedge delays go by it, not by whole calls with their backoffs.
+//
+// Attempts refer to the call, so `run` never returns before all of them
+// finished: a stop request of the caller cancels them and waits, it is
+// noticed when the caller wakes up next.
+template <class Rep>
+class retried_call {
+public:
+    using clock = std::chrono::steady_clock;
+
+    template <class Attempt>
+    static unifex::task<Try<Rep>> run(grpc_executor& ex,
+                                      const retry_policy& policy,
+                                      Attempt attempt,
+                                      method_stats* stats = nullptr) {
+        co_await unifex::schedule(ex.get_grpc_scheduler());
+        retried_call call(policy, stats);
+        if (policy.budget) {
+            policy.budget->deposit();
+        }
+
+        std::optional<clock::time_point> due;
+        auto start_attempt = [&] {
+            ++call.inflight_;
+            ex.spawn_local(run_attempt(call, call.started_++, attempt));
+            due.reset();
+            if (auto delay = policy.hedge_after()) {
+                due = clock::now() + *delay;
+            }
+        };
+
+        start_attempt();
+        bool budget_left = true;
+        while (!call.decided_) {
+            if (std::exchange(call.retryPending_, false)) {
+                due = clock::now();
+                if (!policy.hedging()) {
+                    *due += policy.backoff(call.started_);
+                }
+            }
+            bool can_start = budget_left && call.started_ < call.maxAttempts_;
+            if (!can_start && call.inflight_ == 0) {
+                // out of attempts, with the last failure
+                break;
+            }
+            if (can_start && due && *due <= clock::now()) {
+                if (!policy.budget || policy.budget->try_withdraw()) {
+                    start_attempt();
+                } else {
+                    budget_left = false;
+                }
+                continue;
+            }
+            call.alarmSet_ = true;
+            auto woken = co_await unifex::done_as_optional(
+                call.sleep(ex, can_start ? due : std::nullopt));
+            call.alarmSet_ = false;
+            if (!woken) {
+                // the caller stopped
+                call.decided_ = true;
+                call.result_.emplace(make_agrpc_ex_ptr(grpc::StatusCode::CANCELLED, "cancelled"));
+            }
+        }
+
+        // the losers, or those still in flight after a final failure
+        for (auto* context : call.contexts_) {
+            if (context) {
+                context->TryCancel();
+            }
+        }
+        call.drained_.reset();
+        if (call.inflight_ > 0) {
+            co_await unifex::done_as_optional(call.drained_.async_wait());
+        }
+        co_return std::move(*call.result_);
+    }
+
+private:
+    retried_call(const retry_policy& policy, method_stats* stats)
+      : policy_(policy)
+      , stats_(stats)
+      , maxAttempts_(std::max(policy.max_attempts, 1))
+      , contexts_(maxAttempts_, nullptr) {}
+
+    template <class Attempt>
+    static unifex::task<void> run_attempt(retried_call& call, int index, Attempt& attempt) {
+        // on every path, `run` waits for it
+        unifex::scope_guard finish = [&]() noexcept {
+            call.contexts_[index] = nullptr;
+            call.finish_attempt();
+        };
+        if (call.decided_) {
+            // decided before this one got to start
+            co_return;
+        }
+        grpc::ClientContext context;
+        Rep rep;
+        call.contexts_[index] = &context;
+        auto start = call.stats_ ? method_stats::clock::now() : method_stats::clock::time_point();
+        auto status = co_await unifex::done_as_optional(attempt(context, rep));
+        call.contexts_[index] = nullptr;
+        if (!status) {
+            status.emplace(grpc::StatusCode::CANCELLED, "cancelled");
+        }
+
+        if (!call.decided_) {
+            // not a loser cut short by the winner
+            if (call.stats_) {
+                call.stats_->record(method_stats::client, method_stats::clock::now() - start);
+            }
+            if (status->ok()) {
+                call.result_.emplace(std::move(rep));
+                call.decided_ = true;
+            } else {
+                call.result_.emplace(make_agrpc_ex_ptr(*status));
+                if (call.policy_.is_retryable(status->error_code())) {
+                    call.retryPending_ = true;
+                } else {
+                    call.decided_ = true;
+                }
+            }
+        }
+    }
+
+    void finish_attempt() noexcept {
+        --inflight_;
+        if (alarmSet_) {
+            alarm_.Cancel();
+        }
+        if (inflight_ == 0) {
+            drained_.set();
+        }
+    }
+
+    // Until `due`, or until an attempt completes.
+    auto sleep(grpc_executor& ex, std::optional<clock::time_point> due) {
+        return ex.async([this, due](grpc::CompletionQueue* cq, void* tag) {
+            auto deadline = gpr_inf_future(GPR_CLOCK_MONOTONIC);
+            if (due) {
+                auto left =
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(*due - clock::now());
+                deadline = gpr_time_add(
+                    gpr_now(GPR_CLOCK_MONOTONIC),
+                    gpr_time_from_nanos(std::max<std::int64_t>(left.count(), 0), GPR_TIMESPAN));
+            }
+            alarm_.Set(cq, deadline, tag);
+        });
+    }
+
+    const retry_policy& policy_;
+    method_stats* const stats_;
+    const int maxAttempts_;
+    // of the attempts in flight
+    std::vector<grpc::ClientContext*> contexts_;
+    int started_ = 0;
+    int inflight_ = 0;
+    // a success or a final failure is in `result_`
+    bool decided_ = false;
+    // a retryable failure waits for the next attempt
+    bool retryPending_ = false;
+    // the success, or the latest failure
+    std::optional<Try<Rep>> result_;
+    grpc::Alarm alarm_;
+    bool alarmSet_ = false;
+    unifex::async_manual_reset_event drained_;
+};
+
+// One attempt of a unary call, for `retried_call`.
+template <class Rep, class Rpc, class Stub, class Req>
+unifex::task<grpc::Status> unary_attempt(grpc_executor& ex,
+                                         Rpc rpc,
+                                         Stub stub,
+                                         const Req& req,
+                                         grpc::ClientContext& context,
+                                         Rep& rep) {
+    std::unique_ptr<grpc::ClientAsyncResponseReader<Rep>> responder;
+    grpc::Status status;
+    bool ok = co_await ex.async([&](grpc::CompletionQueue* cq, void* tag) {
+        responder = (stub->*rpc)(&context, req, cq);
+        responder->Finish(&rep, &status, tag);
+    });
+    if (!ok) {
+        co_return grpc::Status(grpc::StatusCode::UNKNOWN, "unknown");
+    }
+    co_return status;
+}
+}  // namespace detail
+
+namespace detail {
+template <class Rep, class Rpc, class Stub, class Req>
+unifex::task<Try<Rep>>
+cached_client_call(grpc_executor& ex,
+                   Rpc rpc,
+                   Stub stub,
+                   const Req& req,
+                   client_options options,
+                   absl::FunctionRef<void(grpc::ClientContext&)> handle);
+}  // namespace detail
+
 // client 1:1
 template <class Rep, class Rpc, class Stub, class Req>
 unifex::task<Try<Rep>>
@@ -40,6 +293,7 @@ async_client_call(grpc_executor& ex,
                   Rpc rpc,
                   Stub stub,
                   Req req,
+                  client_options options,
                   absl::FunctionRef<void(grpc::ClientContext&)> handle =
                       detail::discard_handle_context) {
     static_assert(std::is_base_of_v<google::protobuf::Message, Req>,
@@ -47,15 +301,38 @@ async_client_call(grpc_executor& ex,
     static_assert(std::is_base_of_v<google::protobuf::Message, Rep>,
                   "Req expect to be `google::protobuf::Message`");
 
+    if (options.cache) {
+        co_return co_await detail::cached_client_call<Rep>(ex, rpc, stub, req, options, handle);
+    }
+
+    if (options.limiter) {
+        co_await options.limiter->acquire();
+    }
+
+    if (options.retry) {
+        co_return co_await detail::retried_call<Rep>::run(
+            ex,
+            *options.retry,
+            [&](grpc::ClientContext& context, Rep& rep) {
+                handle(context);
+                return detail::unary_attempt(ex, rpc, stub, req, context, rep);
+            },
+            options.stats);
+    }
+
     grpc::ClientContext context;
     handle(context);
     std::unique_ptr<grpc::ClientAsyncResponseReader<Rep>> responder;
     Rep rep;
     grpc::Status status;
+    auto start = options.stats ? method_stats::clock::now() : method_stats::clock::time_point();
     bool ok = co_await ex.async([&](grpc::CompletionQueue* cq, void* tag) {
         responder = (stub->*rpc)(&context, req, cq);
         responder->Finish(&rep, &status, tag);
     });
+    if (options.stats) {
+        options.stats->record(method_stats::client, method_stats::clock::now() - start);
+    }
 
     if (!ok) {
         co_return Try<Rep>(make_agrpc_ex_ptr(grpc::StatusCode::UNKNOWN, "unknown"));
@@ -64,7 +341,204 @@ async_client_call(grpc_executor& ex,
     if (!status.ok()) {
         co_return Try<Rep>(make_agrpc_ex_ptr(status));
     }
-    co_return Try<Rep>(rep);
+    co_return Try<Rep>(std::move(rep));
+}
+
+template <class Rep, class Rpc, class Stub, class Req>
+unifex::task<Try<Rep>>
+async_client_call(grpc_executor& ex,
+                  Rpc rpc,
+                  Stub stub,
+                  Req req,
+                  absl::FunctionRef<void(grpc::ClientContext&)> handle =
+                      detail::discard_handle_context) {
+    return async_client_call<Rep>(ex, rpc, stub, std::move(req), client_options{}, handle);
+}
+
+namespace detail {
+// Renews a stale reply of `cache`, with a context `handle` set up while the
+// call that found it stale was still there.
+template <class Rep, class Rpc, class Stub, class Req>
+unifex::task<void> refresh_cached(grpc_executor& ex,
+                                  client_cache& cache,
+                                  std::string key,
+                                  Rpc rpc,
+                                  Stub stub,
+                                  Req req,
+                                  std::unique_ptr<grpc::ClientContext> context) {
+    auto joined = cache.join(key);
+    if (!joined.leader) {
+        // renewed by a call in flight already
+        co_return;
+    }
+    std::unique_ptr<grpc::ClientAsyncResponseReader<Rep>> responder;
+    Rep rep;
+    grpc::Status status;
+    bool ok = co_await ex.async([&](grpc::CompletionQueue* cq, void* tag) {
+        responder = (stub->*rpc)(context.get(), req, cq);
+        responder->Finish(&rep, &status, tag);
+    });
+    if (!ok) {
+        status = grpc::Status(grpc::StatusCode::UNKNOWN, "unknown");
+    }
+    if (status.ok()) {
+        cache.land(key, joined.call, nullptr, rep.SerializeAsString());
+    } else {
+        cache.land(key, joined.call, make_agrpc_ex_ptr(status), {});
+    }
+}
+
+template <class Rep>
+Try<Rep> parse_cached(const std::string& reply) {
+    Rep rep;
+    if (!rep.ParseFromString(reply)) {
+        return Try<Rep>(make_agrpc_ex_ptr(grpc::StatusCode::INTERNAL, "bad cached reply"));
+    }
+    return Try<Rep>(std::move(rep));
+}
+
+// The method is told apart by the bytes of its member pointer, the same for
+// all calls of it in the process, and by the address of the stub: stubs of
+// other channels, e.g. to other targets, don't share replies. Stubs outlive
+// the cache, so none takes the address of another while it is in use.
+template <class Rep, class Rpc, class Stub, class Req>
+unifex::task<Try<Rep>>
+cached_client_call(grpc_executor& ex,
+                   Rpc rpc,
+                   Stub stub,
+                   const Req& req,
+                   client_options options,
+                   absl::FunctionRef<void(grpc::ClientContext&)> handle) {
+    auto& cache = *std::exchange(options.cache, nullptr);
+    const void* target = std::addressof(*stub);
+    std::string method(reinterpret_cast<const char*>(&rpc), sizeof(rpc));
+    method.append(reinterpret_cast<const char*>(&target), sizeof(target));
+    auto key = client_cache::key_of(method, req.SerializeAsString());
+
+    auto hit = cache.lookup(key);
+    if (hit.state != client_cache::lookup_result::miss) {
+        if (hit.refresh) {
+            auto context = std::make_unique<grpc::ClientContext>();
+            handle(*context);
+            ex.spawn_local(refresh_cached<Rep>(
+                ex, cache, key, rpc, stub, req, std::move(context)));
+        }
+        co_return parse_cached<Rep>(hit.reply);
+    }
+
+    auto joined = cache.join(key);
+    if (!joined.leader) {
+        co_await joined.call->done.async_wait();
+        if (joined.call->error) {
+            co_return Try<Rep>(std::exception_ptr(joined.call->error));
+        }
+        co_return parse_cached<Rep>(joined.call->reply);
+    }
+
+    bool landed = false;
+    // those who joined must not wait forever if this call goes away
+    unifex::scope_guard guard{[&]() noexcept {
+        if (!landed) {
+            cache.land(key,
+                       joined.call,
+                       make_agrpc_ex_ptr(grpc::StatusCode::CANCELLED, "cancelled"),
+                       {});
+        }
+    }};
+    auto result = co_await async_client_call<Rep>(ex, rpc, stub, req, options, handle);
+    landed = true;
+    if (result.has_value()) {
+        cache.land(key, joined.call, nullptr, result.value().SerializeAsString());
+    } else {
+        cache.land(key, joined.call, result.exception(), {});
+    }
+    co_return std::move(result);
+}
+}  // namespace detail
+
+// client 1:1, the reply is parsed straight into the caller's `rep`. Calls
+// that reuse the same `rep` reuse its capacity.
+template <class Rep, class Rpc, class Stub, class Req>
+unifex::task<Try<void>>
+async_client_call_into(grpc_executor& ex,
+                       Rpc rpc,
+                       Stub stub,
+                       const Req& req,
+                       Rep& rep,
+                       client_options options,
+                       absl::FunctionRef<void(grpc::ClientContext&)> handle =
+                           detail::discard_handle_context) {
+    static_assert(std::is_base_of_v<google::protobuf::Message, Req>,
+                  "Req expect to be `google::protobuf::Message`");
+    static_assert(std::is_base_of_v<google::protobuf::Message, Rep>,
+                  "Rep expect to be `google::protobuf::Message`");
+
+    if (options.limiter) {
+        co_await options.limiter->acquire();
+    }
+
+    grpc::ClientContext context;
+    handle(context);
+    std::unique_ptr<grpc::ClientAsyncResponseReader<Rep>> responder;
+    grpc::Status status;
+    auto start = options.stats ? method_stats::clock::now() : method_stats::clock::time_point();
+    bool ok = co_await ex.async([&](grpc::CompletionQueue* cq, void* tag) {
+        responder = (stub->*rpc)(&context, req, cq);
+        responder->Finish(&rep, &status, tag);
+    });
+    if (options.stats) {
+        options.stats->record(method_stats::client, method_stats::clock::now() - start);
+    }
+
+    if (!ok) {
+        co_return Try<void>(make_agrpc_ex_ptr(grpc::StatusCode::UNKNOWN, "unknown"));
+    }
+
+    if (!status.ok()) {
+        co_return Try<void>(make_agrpc_ex_ptr(status));
+    }
+    co_return Try<void>();
+}
+
+template <class Rep, class Rpc, class Stub, class Req>
+unifex::task<Try<void>>
+async_client_call_into(grpc_executor& ex,
+                       Rpc rpc,
+                       Stub stub,
+                       const Req& req,
+                       Rep& rep,
+                       absl::FunctionRef<void(grpc::ClientContext&)> handle =
+                           detail::discard_handle_context) {
+    return async_client_call_into(ex, rpc, stub, req, rep, client_options{}, handle);
+}
+
+// client 1:1 on the channel of `stubs` with the fewest calls in flight
+template <class Rep, class Rpc, class Stub, class Req>
+unifex::task<Try<Rep>>
+async_client_call(grpc_executor& ex,
+                  Rpc rpc,
+                  stub_pool<Stub>& stubs,
+                  Req req,
+                  client_options options,
+                  absl::FunctionRef<void(grpc::ClientContext&)> handle =
+                      detail::discard_handle_context) {
+    auto lease = stubs.channels().pick();
+    auto start = channel_pool::clock::now();
+    auto result = co_await async_client_call<Rep>(
+        ex, rpc, stubs.stub(lease.index()), std::move(req), options, handle);
+    lease.done(channel_pool::clock::now() - start, result.has_value());
+    co_return std::move(result);
+}
+
+template <class Rep, class Rpc, class Stub, class Req>
+unifex::task<Try<Rep>>
+async_client_call(grpc_executor& ex,
+                  Rpc rpc,
+                  stub_pool<Stub>& stubs,
+                  Req req,
+                  absl::FunctionRef<void(grpc::ClientContext&)> handle =
+                      detail::discard_handle_context) {
+    return async_client_call<Rep>(ex, rpc, stubs, std::move(req), client_options{}, handle);
 }
 
 // client 1:M
@@ -100,6 +574,27 @@ struct grpc_client_stream {
     Rep rep_;
     std::unique_ptr<grpc::ClientContext> context_;
     std::unique_ptr<grpc::ClientAsyncReader<Rep>> reader_ = nullptr;
+    // the channel of a `stub_pool`, busy as long as the stream lives
+    channel_pool::lease lease_;
+
+    // Read the next reply into `rep` rather than handing out a new message;
+    // reading into the same `rep` again reuses its capacity. Completes with
+    // false at the end of the stream.
+    unifex::task<bool> read(Rep& rep) {
+        if (reader_ == nullptr) {
+            auto ok = co_await ex_.async([this](grpc::CompletionQueue* cq, void* tag) {
+                reader_ = (stub_->*rpc_)(context_.get(), req_, cq, tag);
+            });
+            if (!ok) {
+                co_await finish(*this, false);
+                co_return false;
+            }
+        }
+
+        co_return co_await ex_.async([&](grpc::CompletionQueue*, void* tag) {
+            reader_->Read(&rep, tag);
+        });
+    }
 
     static unifex::task<std::optional<Rep>> start_next(grpc_client_stream& s) {
         auto ok = co_await s.ex_.async([&s](grpc::CompletionQueue* cq, void* tag) {
@@ -123,7 +618,7 @@ struct grpc_client_stream {
         });
 
         if (ok) {
-            co_return std::make_optional(s.rep_);
+            co_return std::optional<Rep>(std::move(s.rep_));
         } else {
             co_await unifex::stop();
             co_return std::optional<Rep>(std::nullopt);
@@ -169,52 +664,525 @@ grpc_client_stream_create(grpc_executor& ctx,
     return {ctx, rpc, stub, (Req2 &&) req, std::forward<F>(f)};
 }
 
-// server 1:1
-template <class Req, class Rep, class Rpc, class Svc>
-unifex::task<void> async_call_data(
-    grpc_executor& ex,
-    Rpc rpc,
-    Svc svc,
-    std::function<unifex::task<bool>(const grpc::ServerContext&, const Req&, Rep&)>
-        handle) {
+// on the channel of `stubs` with the fewest calls in flight
+template <class Rep2, class Rpc2, class Stub2, class Req2, class F>
+inline grpc_client_stream<Rep2, Rpc2, Stub2*, Req2>
+grpc_client_stream_create(grpc_executor& ctx,
+                          Rpc2 rpc,
+                          stub_pool<Stub2>& stubs,
+                          Req2&& req,
+                          F&& f = detail::discard_handle_context) {
+    auto lease = stubs.channels().pick();
+    grpc_client_stream<Rep2, Rpc2, Stub2*, Req2> s{
+        ctx, rpc, stubs.stub(lease.index()), (Req2 &&) req, std::forward<F>(f)};
+    s.lease_ = std::move(lease);
+    return s;
+}
+
+// client M:1
+template <class Req, class Rep>
+class grpc_client_writer {
     static_assert(std::is_base_of_v<google::protobuf::Message, Req>,
                   "Req expect to be `goolge::protobuf::Message`");
     static_assert(std::is_base_of_v<google::protobuf::Message, Rep>,
                   "Rep expect to be `goolge::protobuf::Message`");
 
-    struct State {
-        grpc::ServerContext context;
-        Req request;
-        Rep reply;
+public:
+    explicit grpc_client_writer(grpc_executor& ex,
+                                absl::FunctionRef<void(grpc::ClientContext&)> handle =
+                                    detail::discard_handle_context)
+      : ex_(ex) {
+        handle(context_);
+    }
+
+    grpc_client_writer(const grpc_client_writer&) = delete;
+    grpc_client_writer& operator=(const grpc_client_writer&) = delete;
+
+    // Start the call, completes with false if it could not be started.
+    template <class Rpc, class Stub>
+    auto start(Rpc rpc, Stub stub) {
+        return ex_.async([this, rpc, stub](grpc::CompletionQueue* cq, void* tag) {
+            stream_ = (stub->*rpc)(&context_, &rep_, cq, tag);
+        });
+    }
+
+    // Completes with false if the call is broken.
+    auto write(const Req& req) {
+        return ex_.async([this, &req](grpc::CompletionQueue*, void* tag) {
+            stream_->Write(req, tag);
+        });
+    }
+
+    auto writes_done() {
+        return ex_.async([this](grpc::CompletionQueue*, void* tag) {
+            stream_->WritesDone(tag);
+        });
+    }
+
+    unifex::task<Try<Rep>> finish() {
         grpc::Status status;
-        grpc::ServerAsyncResponseWriter<Rep> writer{&context};
-    };
+        bool ok = co_await ex_.async([&](grpc::CompletionQueue*, void* tag) {
+            stream_->Finish(&status, tag);
+        });
 
-    auto make_task = [&](std::unique_ptr<State> shared) -> unifex::task<void> {
-        if (co_await handle(shared->context, shared->request, shared->reply)) {
-            shared->status = grpc::Status::OK;
-        } else {
-            shared->status = grpc::Status(grpc::StatusCode::UNKNOWN, "unknown");
+        if (!ok) {
+            co_return Try<Rep>(make_agrpc_ex_ptr(grpc::StatusCode::UNKNOWN, "unknown"));
         }
+        if (!status.ok()) {
+            co_return Try<Rep>(make_agrpc_ex_ptr(status));
+        }
+        co_return Try<Rep>(std::move(rep_));
+    }
+
+    grpc::ClientContext& context() noexcept { return context_; }
+
+private:
+    grpc_executor& ex_;
+    grpc::ClientContext context_;
+    Rep rep_;
+    std::unique_ptr<grpc::ClientAsyncWriter<Req>> stream_;
+};
+
+// client M:N
+//
+// `read` and `write` are independent, one of each may be outstanding at the
+// same time.
+template <class Req, class Rep>
+class grpc_client_reader_writer {
+    static_assert(std::is_base_of_v<google::protobuf::Message, Req>,
+                  "Req expect to be `goolge::protobuf::Message`");
+    static_assert(std::is_base_of_v<google::protobuf::Message, Rep>,
+                  "Rep expect to be `goolge::protobuf::Message`");
+
+public:
+    explicit grpc_client_reader_writer(
+        grpc_executor& ex,
+        absl::FunctionRef<void(grpc::ClientContext&)> handle =
+            detail::discard_handle_context)
+      : ex_(ex) {
+        handle(context_);
+    }
+
+    grpc_client_reader_writer(const grpc_client_reader_writer&) = delete;
+    grpc_client_reader_writer& operator=(const grpc_client_reader_writer&) = delete;
 
-        co_await ex.async([&](grpc::CompletionQueue*, void* tag) {
-            shared->writer.Finish(shared->reply, shared->status, tag);
+    // Start the call, completes with false if it could not be started.
+    template <class Rpc, class Stub>
+    auto start(Rpc rpc, Stub stub) {
+        return ex_.async([this, rpc, stub](grpc::CompletionQueue* cq, void* tag) {
+            stream_ = (stub->*rpc)(&context_, cq, tag);
         });
-    };
+    }
+
+    // Completes with false once the server is done writing.
+    auto read(Rep& rep) {
+        return ex_.async([this, &rep](grpc::CompletionQueue*, void* tag) {
+            stream_->Read(&rep, tag);
+        });
+    }
 
-    for (;;) {
-        auto shared = std::make_unique<State>();
+    // Completes with false if the call is broken.
+    auto write(const Req& req) {
+        return ex_.async([this, &req](grpc::CompletionQueue*, void* tag) {
+            stream_->Write(req, tag);
+        });
+    }
+
+    auto writes_done() {
+        return ex_.async([this](grpc::CompletionQueue*, void* tag) {
+            stream_->WritesDone(tag);
+        });
+    }
+
+    unifex::task<grpc::Status> finish() {
+        grpc::Status status;
+        bool ok = co_await ex_.async([&](grpc::CompletionQueue*, void* tag) {
+            stream_->Finish(&status, tag);
+        });
+
+        if (!ok) {
+            co_return grpc::Status(grpc::StatusCode::UNKNOWN, "unknown");
+        }
+        co_return status;
+    }
+
+    grpc::ClientContext& context() noexcept { return context_; }
+
+private:
+    grpc_executor& ex_;
+    grpc::ClientContext context_;
+    std::unique_ptr<grpc::ClientAsyncReaderWriter<Req, Rep>> stream_;
+};
+
+// server 1:1
+struct call_options {
+    // number of accepts kept posted on the completion queue for the method.
+    // A slot is re-posted as soon as its call got accepted.
+    int concurrency = 1;
+
+    // call states kept for reuse once their call finished.
+    std::size_t pool_size = 1024;
+
+    // size of the block each call state preallocates for the request and
+    // reply arena. Messages that fit never touch the heap.
+    std::size_t arena_block_size = 4096;
+
+    // ready replies buffered per server stream on top of the one being
+    // written.
+    std::size_t stream_buffer = 16;
+
+    // latency histograms of the method, not recorded if null. Must outlive
+    // the method.
+    method_stats* stats = nullptr;
+
+    // caps the rate calls of the method are accepted at: an accept slot
+    // waits for a token before it posts the next request. Must outlive the
+    // method.
+    rate_limiter* accept_limiter = nullptr;
+
+    // caps the calls of a method in their handler, rejecting the excess with
+    // RESOURCE_EXHAUSTED. A streaming call holds its slot until it finished.
+    // Must outlive the method.
+    concurrency_limiter* call_limiter = nullptr;
+
+    // replies of a unary method by request, served without running the
+    // handler. One cache per method, it must outlive the method.
+    response_cache* cache = nullptr;
+};
+
+namespace detail {
+// One accept slot of a method, until the server drains. `Data` holds the
+// `ex` and `options` of the method, and
+//
+//   - `new_call()` a call to accept into,
+//   - `request(call, cq, tag)` posts the request of the method for it,
+//   - `accepted(self, call, time)` serves it once a client made it,
+//   - `discard(call)`, if there is one, gets rid of it when the server shuts
+//     down instead.
+template <class Data>
+unifex::task<void> accept_loop(std::shared_ptr<Data> self) {
+    auto& ex = self->ex;
+    while (!ex.draining()) {
+        if (auto* limiter = self->options.accept_limiter) {
+            co_await limiter->acquire();
+        }
+        auto call = self->new_call();
 
         bool ok = co_await ex.async([&](grpc::CompletionQueue* cq, void* tag) {
-            auto _cq = (grpc::ServerCompletionQueue*)cq;
-            (svc->*rpc)(
-                &shared->context, &shared->request, &shared->writer, _cq, _cq, tag);
+            self->request(*call, (grpc::ServerCompletionQueue*)cq, tag);
         });
 
-        if (ok) {
-            ex.spawn_on(ex.get_grpc_scheduler(), make_task(std::move(shared)));
+        if (!ok) {
+            // the server is shutting down
+            if constexpr (requires { self->discard(std::move(call)); }) {
+                self->discard(std::move(call));
+            }
+            break;
+        }
+        ex.call_started();
+        Data::accepted(self, std::move(call), method_stats::clock::now());
+    }
+}
+
+// `options.concurrency` accept slots of a method.
+template <class Data>
+unifex::task<void> accept_loops(std::shared_ptr<Data> data) {
+    auto& ex = data->ex;
+    for (int i = 1; i < data->options.concurrency; ++i) {
+        ex.spawn_local(accept_loop(data));
+    }
+    co_await accept_loop(std::move(data));
+}
+
+// The result of a handler, false if it fails with an error or completes
+// done, so that the call still gets a status.
+template <class Sender>
+auto handler_result(Sender&& handler) {
+    return unifex::let_done(
+        unifex::let_error(static_cast<Sender&&>(handler),
+                          [](auto&&) noexcept { return unifex::just(false); }),
+        []() noexcept { return unifex::just(false); });
+}
+
+template <class Req, class Rep, class Rpc, class Svc>
+struct unary_call_data {
+    using handler_type = std::function<unifex::task<bool>(
+        const grpc::ServerContext&, const Req&, Rep&)>;
+
+    struct State;
+
+    struct finish_fn {
+        State* state;
+
+        void operator()(grpc::CompletionQueue*, void* tag) const {
+            state->finishing = true;
+            if (state->cached) {
+                state->writer->Finish(
+                    static_cast<const Rep&>(*state->cached), state->status, tag);
+            } else {
+                state->writer->Finish(*state->reply, state->status, tag);
+            }
+        }
+    };
+
+    // the handler, once on the grpc_context
+    struct run_handler {
+        State* state;
+
+        unifex::task<bool> operator()() const { return state->run(); }
+    };
+
+    // set the status and `Finish` once the handler completed, its reply gets
+    // cached if it succeeded.
+    struct finish_call {
+        State* state;
+
+        grpc_context::grpc_sender<finish_fn> operator()(bool ok) const {
+            auto& options = state->self->options;
+            if (options.stats) {
+                state->handled = method_stats::clock::now();
+            }
+            if (ok && options.cache && !state->cached) {
+                // the reply lives on the arena, the cache keeps a copy
+                options.cache->insert(state->key,
+                                      std::make_shared<const Rep>(*state->reply));
+            }
+            if (ok) {
+                state->status = grpc::Status::OK;
+            } else if (state->rejected) {
+                state->status = grpc::Status(grpc::StatusCode::RESOURCE_EXHAUSTED,
+                                             "concurrency limit reached");
+            } else {
+                state->status = grpc::Status(grpc::StatusCode::UNKNOWN, "unknown");
+            }
+            return state->self->ex.async(finish_fn{state});
+        }
+    };
+
+    struct call_receiver {
+        State* state;
+
+        void set_value(bool ok) && noexcept { state->complete(ok); }
+        void set_error(std::exception_ptr) && noexcept { state->abandon(); }
+        void set_done() && noexcept { state->abandon(); }
+    };
+
+    using handler_sender = decltype(unifex::on(
+        std::declval<grpc_executor&>().get_grpc_scheduler(),
+        unifex::let_value(
+            handler_result(unifex::let_value(unifex::just(), std::declval<run_handler>())),
+            std::declval<finish_call>())));
+    using handler_op = unifex::connect_result_t<handler_sender, call_receiver>;
+
+    // Per call state, recycled through `pool`. The request and reply live on
+    // an arena whose first block is owned by the state, so `reset()` only
+    // rewinds it. `ServerContext` and the writer are single use and get
+    // re-created in place.
+    struct State {
+        explicit State(std::size_t block_size)
+          : block(new char[block_size])
+          , arena(arena_options(block.get(), block_size)) {
+            init();
+        }
+
+        void reset() noexcept {
+            writer.reset();
+            context.reset();
+            cached.reset();
+            arena.Reset();
+            init();
+        }
+
+        void start(std::shared_ptr<unary_call_data> data,
+                   method_stats::clock::time_point accepted_at) {
+            self = std::move(data);
+            if (self->options.stats) {
+                accepted = accepted_at;
+            }
+            if (auto* cache = self->options.cache) {
+                key = cache->key_of(*request, *context);
+                cached = cache->lookup(key);
+            }
+            // adaptors only, no frame besides the handler's own: what the
+            // handler throws or a done completion fail the call, so that
+            // `finish_call` still sends a status
+            op.construct_with([&] {
+                return unifex::connect(
+                    unifex::on(self->ex.get_grpc_scheduler(),
+                               unifex::let_value(handler_result(unifex::let_value(
+                                                     unifex::just(), run_handler{this})),
+                                                 finish_call{this})),
+                    call_receiver{this});
+            });
+            unifex::start(op.get());
+        }
+
+        // `ok` tells whether the status was sent.
+        void complete(bool ok) noexcept {
+            op.destruct();
+            if (auto* stats = self->options.stats) {
+                // only the phases the call got to
+                auto now = method_stats::clock::now();
+                if (started != time_point{}) {
+                    stats->record(method_stats::queue, started - accepted);
+                }
+                if (started != time_point{} && handled != time_point{}) {
+                    stats->record(method_stats::handler, handled - started);
+                }
+                if (handled != time_point{}) {
+                    stats->record(method_stats::write, now - handled);
+                }
+            }
+            // may drop the last reference of the method, and the pool with it
+            auto data = std::move(self);
+            auto& ex = data->ex;
+            bool completed = ok && !context->IsCancelled();
+            data->pool.release(this);
+            ex.call_finished(completed);
+        }
+
+        // The call ended before `Finish` was posted, the executor is
+        // stopping. Cancel it so the client isn't left waiting for a status.
+        void abandon() noexcept {
+            if (!finishing) {
+                context->TryCancel();
+            }
+            complete(false);
+        }
+
+        std::unique_ptr<char[]> block;
+        google::protobuf::Arena arena;
+        Req* request;
+        Rep* reply;
+        grpc::Status status;
+        std::optional<grpc::ServerContext> context;
+        std::optional<grpc::ServerAsyncResponseWriter<Rep>> writer;
+        std::shared_ptr<unary_call_data> self;
+        unifex::manual_lifetime<handler_op> op;
+        // turned away by `options.call_limiter`
+        bool rejected;
+        // `Finish` was posted
+        bool finishing;
+        // the reply found in `options.cache`, sent instead of `reply`
+        response_cache::reply_ptr cached;
+        // of the request in `options.cache`
+        std::string key;
+        // with `options.stats` only, unset until the call gets there
+        using time_point = method_stats::clock::time_point;
+        time_point accepted;
+        time_point started;
+        time_point handled;
+
+    private:
+        friend run_handler;
+
+        // The handler of the call, or the cached reply. Only a limited call
+        // takes a frame of its own, for the wait on the limiter.
+        unifex::task<bool> run() {
+            if (auto* limiter = self->options.call_limiter; limiter && !cached) {
+                return limited(this, *limiter);
+            }
+            if (self->options.stats) {
+                started = method_stats::clock::now();
+            }
+            return cached ? served_cached() : self->handle(*context, *request, *reply);
         }
+
+        // the handler once `limiter` admitted the call, the limiter learns
+        // its latency.
+        static unifex::task<bool> limited(State* state, concurrency_limiter& limiter) {
+            bool admitted = co_await limiter.acquire(&*state->context);
+            state->started = method_stats::clock::now();
+            if (!admitted) {
+                state->rejected = true;
+                co_return false;
+            }
+            auto start = std::chrono::steady_clock::now();
+            bool ok = false;
+            unifex::scope_guard release = [&]() noexcept {
+                limiter.release(std::chrono::steady_clock::now() - start, ok);
+            };
+            ok = co_await state->self->handle(
+                *state->context, *state->request, *state->reply);
+            co_return ok;
+        }
+
+        static unifex::task<bool> served_cached() { co_return true; }
+
+        void init() {
+            request = google::protobuf::Arena::CreateMessage<Req>(&arena);
+            reply = google::protobuf::Arena::CreateMessage<Rep>(&arena);
+            status = grpc::Status::OK;
+            rejected = false;
+            finishing = false;
+            accepted = started = handled = time_point{};
+            key.clear();
+            context.emplace();
+            writer.emplace(&*context);
+        }
+
+        static google::protobuf::ArenaOptions arena_options(char* block,
+                                                            std::size_t size) {
+            google::protobuf::ArenaOptions options;
+            options.initial_block = block;
+            options.initial_block_size = size;
+            return options;
+        }
+    };
+
+    unary_call_data(grpc_executor& ex,
+                    Rpc rpc,
+                    Svc svc,
+                    handler_type handle,
+                    call_options options)
+      : ex(ex)
+      , rpc(rpc)
+      , svc(svc)
+      , handle(std::move(handle))
+      , options(options)
+      , pool(options.pool_size) {}
+
+    grpc_executor& ex;
+    Rpc rpc;
+    Svc svc;
+    handler_type handle;
+    call_options options;
+    object_pool<State> pool;
+
+    // for `accept_loop`
+    State* new_call() { return pool.acquire(options.arena_block_size); }
+
+    void request(State& call, grpc::ServerCompletionQueue* cq, void* tag) {
+        (svc->*rpc)(&*call.context, call.request, &*call.writer, cq, cq, tag);
+    }
+
+    void discard(State* call) noexcept { pool.release(call); }
+
+    // the handler starts from the local queue, after this slot got re-posted.
+    static void accepted(const std::shared_ptr<unary_call_data>& self,
+                         State* call,
+                         method_stats::clock::time_point time) {
+        call->start(self, time);
     }
+};
+}  // namespace detail
+
+template <class Req, class Rep, class Rpc, class Svc>
+unifex::task<void> async_call_data(
+    grpc_executor& ex,
+    Rpc rpc,
+    Svc svc,
+    std::function<unifex::task<bool>(const grpc::ServerContext&, const Req&, Rep&)>
+        handle,
+    call_options options = {}) {
+    static_assert(std::is_base_of_v<google::protobuf::Message, Req>,
+                  "Req expect to be `goolge::protobuf::Message`");
+    static_assert(std::is_base_of_v<google::protobuf::Message, Rep>,
+                  "Rep expect to be `goolge::protobuf::Message`");
+
+    using call_data = detail::unary_call_data<Req, Rep, Rpc, Svc>;
+    co_await detail::accept_loops(
+        std::make_shared<call_data>(ex, rpc, svc, std::move(handle), options));
 }
 
 template <class Req, class Rep, class Rpc, class Svc>
@@ -223,7 +1191,8 @@ unifex::task<void> async_call_data(
     Rpc rpc,
     Svc svc,
     std::function<bool(const grpc::ServerContext&, const Req&, Rep&)> handle,
-    bool blocking) {
+    bool blocking,
+    call_options options = {}) {
     return async_call_data<Req, Rep, Rpc, Svc>(
         ex,
         rpc,
@@ -234,17 +1203,437 @@ unifex::task<void> async_call_data(
             Rep& rep) -> unifex::task<bool> {
             auto snd = unifex::just_from([&]() { return handle(ctx, req, rep); });
             if (blocking) {
-                co_return co_await unifex::on(ex.get_thread_scheduler(),
-                                              std::move(snd));
+                co_return co_await ex.on_pool(std::move(snd));
             } else {
                 co_return co_await snd;
             }
-        });
+        },
+        options);
 }
 
 // server 1:M
-// template <class Req, class Rep, class Rpc, class Svc>
-// unifex::task<void> async_call_data_1m(grpc_executor& ex, Rpc rpc, Svc svc,
-//                                       bool blocking = false) {
-//                                       }
+//
+// Reply side of a server stream. At most one `Write` is in flight and at most
+// `capacity` ready replies are buffered behind it; `write` suspends while the
+// buffer is full, so a slow reader holds back the producer instead of
+// growing memory.
+template <class Rep>
+class server_writer : private task_base {
+public:
+    server_writer(grpc_executor& ex,
+                  grpc::ServerAsyncWriter<Rep>& stream,
+                  std::size_t capacity)
+      : ex_(ex)
+      , stream_(stream)
+      , buffer_(std::max<std::size_t>(capacity, 1)) {
+        this->execute_ = &on_write_done;
+    }
+
+    server_writer(const server_writer&) = delete;
+    server_writer& operator=(const server_writer&) = delete;
+
+    // Completes once `rep` got buffered, or with false if the call is broken
+    // (e.g. the client went away). May be called from any thread.
+    unifex::task<bool> write(Rep rep) {
+        co_await resume_on_io();
+        while (buffer_.full() && !broken_) {
+            space_.reset();
+            co_await space_.async_wait();
+        }
+        if (broken_) {
+            co_return false;
+        }
+
+        buffer_.push_back(std::move(rep));
+        if (!writing_) {
+            write_next();
+        }
+        co_return true;
+    }
+
+    // `write` for handlers running on the thread pool, blocks the calling
+    // thread while the buffer is full.
+    bool write_blocking(Rep rep) {
+        UNIFEX_ASSERT(!ex_.get_grpc_context().is_running_on_io_thread());
+        return unifex::sync_wait(write(std::move(rep))).value_or(false);
+    }
+
+    // Completes once every buffered reply was written; false if the call
+    // broke on the way.
+    unifex::task<bool> flush() {
+        co_await resume_on_io();
+        while (writing_) {
+            drained_.reset();
+            co_await drained_.async_wait();
+        }
+        co_return !broken_;
+    }
+
+private:
+    unifex::task<void> resume_on_io() {
+        if (!ex_.get_grpc_context().is_running_on_io_thread()) {
+            co_await unifex::schedule(ex_.get_grpc_scheduler());
+        }
+    }
+
+    void write_next() {
+        writing_ = true;
+        stream_.Write(buffer_.front(), static_cast<task_base*>(this));
+        // `Write` serialized the reply, the slot is free again.
+        buffer_.pop_front();
+        space_.set();
+    }
+
+    static void on_write_done(task_base* p, bool ok) noexcept {
+        auto& self = *static_cast<server_writer*>(p);
+        if (ok && !self.buffer_.empty()) {
+            self.write_next();
+            return;
+        }
+
+        self.writing_ = false;
+        self.broken_ = self.broken_ || !ok;
+        self.space_.set();
+        self.drained_.set();
+    }
+
+    grpc_executor& ex_;
+    grpc::ServerAsyncWriter<Rep>& stream_;
+    circular_q<Rep> buffer_;
+    bool writing_ = false;
+    bool broken_ = false;
+    unifex::async_manual_reset_event space_;
+    unifex::async_manual_reset_event drained_;
+};
+
+namespace detail {
+// Accept loop shared by the streaming methods. `State` is the per call state:
+// it requests the call and runs the handler on it, `run` returns whether the
+// status was sent and sets `handled` once the handler returned. `finish`
+// sends a status without running the handler, `status` is the one sent.
+template <class State, class Rpc, class Svc>
+struct stream_call_data {
+    using handler_type = typename State::handler_type;
+
+    stream_call_data(grpc_executor& ex,
+                     Rpc rpc,
+                     Svc svc,
+                     handler_type handle,
+                     call_options options)
+      : ex(ex)
+      , rpc(rpc)
+      , svc(svc)
+      , handle(std::move(handle))
+      , options(options) {}
+
+    grpc_executor& ex;
+    Rpc rpc;
+    Svc svc;
+    handler_type handle;
+    call_options options;
+
+    static unifex::task<void> make_task(std::shared_ptr<stream_call_data> self,
+                                        std::unique_ptr<State> shared,
+                                        method_stats::clock::time_point accepted) {
+        auto started = method_stats::clock::now();
+        bool ok = false;
+        // also if the call throws or completes done, `end_drain()` waits for it
+        unifex::scope_guard finished = [&]() noexcept {
+            self->ex.call_finished(ok && !shared->context.IsCancelled());
+        };
+        auto* limiter = self->options.call_limiter;
+        std::optional<bool> admitted = true;
+        if (limiter) {
+            admitted =
+                co_await unifex::done_as_optional(limiter->acquire(&shared->context));
+        }
+        if (admitted && *admitted) {
+            auto start = std::chrono::steady_clock::now();
+            unifex::scope_guard release = [&]() noexcept {
+                if (limiter) {
+                    limiter->release(std::chrono::steady_clock::now() - start,
+                                     ok && shared->status.ok());
+                }
+            };
+            ok = co_await shared->run(self->ex, self->handle);
+        } else {
+            shared->handled = method_stats::clock::now();
+            ok = co_await shared->finish(
+                self->ex,
+                admitted ? grpc::Status(grpc::StatusCode::RESOURCE_EXHAUSTED,
+                                        "concurrency limit reached")
+                         : grpc::Status(grpc::StatusCode::UNKNOWN, "unknown"));
+        }
+        if (auto* stats = self->options.stats) {
+            auto now = method_stats::clock::now();
+            stats->record(method_stats::queue, started - accepted);
+            stats->record(method_stats::handler, shared->handled - started);
+            stats->record(method_stats::write, now - shared->handled);
+        }
+    }
+
+    // for `accept_loop`
+    std::unique_ptr<State> new_call() { return std::make_unique<State>(ex, options); }
+
+    void request(State& call, grpc::ServerCompletionQueue* cq, void* tag) {
+        call.request(svc, rpc, cq, tag);
+    }
+
+    static void accepted(const std::shared_ptr<stream_call_data>& self,
+                         std::unique_ptr<State> call,
+                         method_stats::clock::time_point time) {
+        self->ex.spawn_on(self->ex.get_grpc_scheduler(),
+                          make_task(self, std::move(call), time));
+    }
+};
+
+template <class State, class Rpc, class Svc>
+unifex::task<void> serve_stream(grpc_executor& ex,
+                                Rpc rpc,
+                                Svc svc,
+                                typename State::handler_type handle,
+                                call_options options) {
+    using call_data = stream_call_data<State, Rpc, Svc>;
+    co_await accept_loops(
+        std::make_shared<call_data>(ex, rpc, svc, std::move(handle), options));
+}
+
+template <class Req, class Rep>
+struct server_stream_state {
+    using handler_type = std::function<unifex::task<bool>(
+        const grpc::ServerContext&, const Req&, server_writer<Rep>&)>;
+
+    server_stream_state(grpc_executor& ex, const call_options& options)
+      : writer(ex, stream, options.stream_buffer) {}
+
+    template <class Svc, class Rpc>
+    void request(Svc svc, Rpc rpc, grpc::ServerCompletionQueue* cq, void* tag) {
+        (svc->*rpc)(&context, &request_, &stream, cq, cq, tag);
+    }
+
+    unifex::task<bool> run(grpc_executor& ex, const handler_type& handle) {
+        bool ok = co_await handler_result(handle(context, request_, writer));
+        handled = method_stats::clock::now();
+        // everything written goes out before the status
+        ok = co_await writer.flush() && ok;
+        co_return co_await finish(
+            ex, ok ? grpc::Status::OK : grpc::Status(grpc::StatusCode::UNKNOWN, "unknown"));
+    }
+
+    auto finish(grpc_executor& ex, grpc::Status s) {
+        status = std::move(s);
+        return ex.async(
+            [this](grpc::CompletionQueue*, void* tag) { stream.Finish(status, tag); });
+    }
+
+    grpc::ServerContext context;
+    method_stats::clock::time_point handled;
+    Req request_;
+    grpc::Status status;
+    grpc::ServerAsyncWriter<Rep> stream{&context};
+    server_writer<Rep> writer;
+};
+}  // namespace detail
+
+// The handler writes replies through `server_writer::write` and runs inline
+// on the grpc_context.
+template <class Req, class Rep, class Rpc, class Svc>
+unifex::task<void> async_call_data_1m(
+    grpc_executor& ex,
+    Rpc rpc,
+    Svc svc,
+    std::function<unifex::task<bool>(
+        const grpc::ServerContext&, const Req&, server_writer<Rep>&)> handle,
+    call_options options = {}) {
+    static_assert(std::is_base_of_v<google::protobuf::Message, Req>,
+                  "Req expect to be `goolge::protobuf::Message`");
+    static_assert(std::is_base_of_v<google::protobuf::Message, Rep>,
+                  "Rep expect to be `goolge::protobuf::Message`");
+
+    return detail::serve_stream<detail::server_stream_state<Req, Rep>>(
+        ex, rpc, svc, std::move(handle), options);
+}
+
+// The handler is offloaded to the thread pool and writes replies through
+// `server_writer::write_blocking`.
+template <class Req, class Rep, class Rpc, class Svc>
+unifex::task<void> async_call_data_1m(
+    grpc_executor& ex,
+    Rpc rpc,
+    Svc svc,
+    std::function<bool(const grpc::ServerContext&, const Req&, server_writer<Rep>&)>
+        handle,
+    call_options options = {}) {
+    return async_call_data_1m<Req, Rep, Rpc, Svc>(
+        ex,
+        rpc,
+        svc,
+        [&ex, handle = std::move(handle)](const grpc::ServerContext& ctx,
+                                          const Req& req,
+                                          server_writer<Rep>& writer)
+            -> unifex::task<bool> {
+            co_return co_await ex.on_pool(
+                unifex::just_from([&]() { return handle(ctx, req, writer); }));
+        },
+        options);
+}
+
+// server M:1
+template <class Req, class Rep>
+class server_reader {
+public:
+    server_reader(grpc_executor& ex, grpc::ServerAsyncReader<Rep, Req>& stream)
+      : ex_(ex)
+      , stream_(stream) {}
+
+    // Completes with false once the client is done writing.
+    auto read(Req& req) {
+        return ex_.async([this, &req](grpc::CompletionQueue*, void* tag) {
+            stream_.Read(&req, tag);
+        });
+    }
+
+private:
+    grpc_executor& ex_;
+    grpc::ServerAsyncReader<Rep, Req>& stream_;
+};
+
+namespace detail {
+template <class Req, class Rep>
+struct client_stream_state {
+    using handler_type = std::function<unifex::task<bool>(
+        const grpc::ServerContext&, server_reader<Req, Rep>&, Rep&)>;
+
+    client_stream_state(grpc_executor& ex, const call_options&) : reader(ex, stream) {}
+
+    template <class Svc, class Rpc>
+    void request(Svc svc, Rpc rpc, grpc::ServerCompletionQueue* cq, void* tag) {
+        (svc->*rpc)(&context, &stream, cq, cq, tag);
+    }
+
+    unifex::task<bool> run(grpc_executor& ex, const handler_type& handle) {
+        bool ok = co_await handler_result(handle(context, reader, reply));
+        handled = method_stats::clock::now();
+        co_return co_await finish(
+            ex, ok ? grpc::Status::OK : grpc::Status(grpc::StatusCode::UNKNOWN, "unknown"));
+    }
+
+    auto finish(grpc_executor& ex, grpc::Status s) {
+        status = std::move(s);
+        return ex.async([this](grpc::CompletionQueue*, void* tag) {
+            if (status.ok()) {
+                stream.Finish(reply, status, tag);
+            } else {
+                stream.FinishWithError(status, tag);
+            }
+        });
+    }
+
+    grpc::ServerContext context;
+    method_stats::clock::time_point handled;
+    Rep reply;
+    grpc::Status status;
+    grpc::ServerAsyncReader<Rep, Req> stream{&context};
+    server_reader<Req, Rep> reader;
+};
+}  // namespace detail
+
+template <class Req, class Rep, class Rpc, class Svc>
+unifex::task<void> async_call_data_m1(
+    grpc_executor& ex,
+    Rpc rpc,
+    Svc svc,
+    std::function<unifex::task<bool>(
+        const grpc::ServerContext&, server_reader<Req, Rep>&, Rep&)> handle,
+    call_options options = {}) {
+    static_assert(std::is_base_of_v<google::protobuf::Message, Req>,
+                  "Req expect to be `goolge::protobuf::Message`");
+    static_assert(std::is_base_of_v<google::protobuf::Message, Rep>,
+                  "Rep expect to be `goolge::protobuf::Message`");
+
+    return detail::serve_stream<detail::client_stream_state<Req, Rep>>(
+        ex, rpc, svc, std::move(handle), options);
+}
+
+// server M:N
+//
+// `read` and `write` are independent, one of each may be outstanding at the
+// same time.
+template <class Req, class Rep>
+class server_reader_writer {
+public:
+    server_reader_writer(grpc_executor& ex,
+                         grpc::ServerAsyncReaderWriter<Rep, Req>& stream)
+      : ex_(ex)
+      , stream_(stream) {}
+
+    // Completes with false once the client is done writing.
+    auto read(Req& req) {
+        return ex_.async([this, &req](grpc::CompletionQueue*, void* tag) {
+            stream_.Read(&req, tag);
+        });
+    }
+
+    // Completes with false if the call is broken.
+    auto write(const Rep& rep) {
+        return ex_.async([this, &rep](grpc::CompletionQueue*, void* tag) {
+            stream_.Write(rep, tag);
+        });
+    }
+
+private:
+    grpc_executor& ex_;
+    grpc::ServerAsyncReaderWriter<Rep, Req>& stream_;
+};
+
+namespace detail {
+template <class Req, class Rep>
+struct bidi_stream_state {
+    using handler_type = std::function<unifex::task<bool>(
+        const grpc::ServerContext&, server_reader_writer<Req, Rep>&)>;
+
+    bidi_stream_state(grpc_executor& ex, const call_options&) : rw(ex, stream) {}
+
+    template <class Svc, class Rpc>
+    void request(Svc svc, Rpc rpc, grpc::ServerCompletionQueue* cq, void* tag) {
+        (svc->*rpc)(&context, &stream, cq, cq, tag);
+    }
+
+    unifex::task<bool> run(grpc_executor& ex, const handler_type& handle) {
+        bool ok = co_await handler_result(handle(context, rw));
+        handled = method_stats::clock::now();
+        co_return co_await finish(
+            ex, ok ? grpc::Status::OK : grpc::Status(grpc::StatusCode::UNKNOWN, "unknown"));
+    }
+
+    auto finish(grpc_executor& ex, grpc::Status s) {
+        status = std::move(s);
+        return ex.async(
+            [this](grpc::CompletionQueue*, void* tag) { stream.Finish(status, tag); });
+    }
+
+    grpc::ServerContext context;
+    method_stats::clock::time_point handled;
+    grpc::Status status;
+    grpc::ServerAsyncReaderWriter<Rep, Req> stream{&context};
+    server_reader_writer<Req, Rep> rw;
+};
+}  // namespace detail
+
+template <class Req, class Rep, class Rpc, class Svc>
+unifex::task<void> async_call_data_mn(
+    grpc_executor& ex,
+    Rpc rpc,
+    Svc svc,
+    std::function<unifex::task<bool>(const grpc::ServerContext&,
+                                     server_reader_writer<Req, Rep>&)> handle,
+    call_options options = {}) {
+    static_assert(std::is_base_of_v<google::protobuf::Message, Req>,
+                  "Req expect to be `goolge::protobuf::Message`");
+    static_assert(std::is_base_of_v<google::protobuf::Message, Rep>,
+                  "Rep expect to be `goolge::protobuf::Message`");
+
+    return detail::serve_stream<detail::bidi_stream_state<Req, Rep>>(
+        ex, rpc, svc, std::move(handle), options);
+}
 }  // namespace agrpc
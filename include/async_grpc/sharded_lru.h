@@ -0,0 +1,179 @@
+// sharded LRU map under a memory cap, behind the reply caches.
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <variant>
+#include <async_grpc/metrics.h>
+
+namespace agrpc {
+
+// What a cache holds, and what its memory cap evicted.
+struct lru_stats {
+    std::uint64_t evictions = 0;
+    std::size_t entries = 0;
+    std::size_t bytes = 0;
+};
+
+namespace detail {
+
+// `value` prefixed by its size, so that it doesn't run into what follows.
+void append_sized(std::string& key, std::string_view value);
+
+// The members of `s` for the JSON object of a cache's stats.
+std::string json_members(const lru_stats& s);
+
+// Values by key, in shards of their own lock and LRU order each. Keys and
+// values take at most `max_bytes` in total, the least recently used go first.
+// `Extra` is more per shard state, guarded by the same lock.
+template <class V, class Extra = std::monostate>
+class sharded_lru {
+    struct entry {
+        std::string key;
+        V value;
+        std::size_t bytes;
+    };
+    using iterator = typename std::list<entry>::iterator;
+
+    struct alignas(64) shard {
+        std::mutex mutex;
+        // most recently used first
+        std::list<entry> lru;
+        std::unordered_map<std::string_view, iterator> index;
+        std::size_t bytes = 0;
+        Extra extra;
+    };
+
+public:
+    // The shard of a key, locked while this lives.
+    class locked {
+    public:
+        locked(const locked&) = delete;
+        locked& operator=(const locked&) = delete;
+
+        // null if absent
+        V* find(std::string_view key) {
+            auto it = s_.index.find(key);
+            return it == s_.index.end() ? nullptr : &it->second->value;
+        }
+
+        // `find`, and the value becomes the most recently used
+        V* get(std::string_view key) {
+            auto it = s_.index.find(key);
+            if (it == s_.index.end()) {
+                return nullptr;
+            }
+            s_.lru.splice(s_.lru.begin(), s_.lru, it->second);
+            return &it->second->value;
+        }
+
+        // false if absent
+        bool erase(std::string_view key) {
+            auto it = s_.index.find(key);
+            if (it == s_.index.end()) {
+                return false;
+            }
+            remove(it->second);
+            return true;
+        }
+
+        // Store `value`, of `bytes`, under `key` in place of the previous
+        // one, then evict the least recently used over the cap. Not stored,
+        // and the previous one kept, if it is larger than the cap by itself.
+        void put(std::string key, V value, std::size_t bytes) {
+            bytes += key.size();
+            if (bytes > lru_.shardBytes_) {
+                return;
+            }
+            erase(key);
+            s_.lru.push_front(entry{std::move(key), std::move(value), bytes});
+            s_.index.emplace(s_.lru.front().key, s_.lru.begin());
+            s_.bytes += bytes;
+            std::uint64_t evicted = 0;
+            while (s_.bytes > lru_.shardBytes_) {
+                remove(std::prev(s_.lru.end()));
+                ++evicted;
+            }
+            if (evicted > 0) {
+                lru_.evictions_.add(evicted);
+            }
+        }
+
+        Extra& extra() noexcept { return s_.extra; }
+
+    private:
+        friend sharded_lru;
+
+        locked(sharded_lru& lru, shard& s)
+          : lru_(lru)
+          , s_(s)
+          , lock_(s.mutex) {}
+
+        void remove(iterator it) {
+            s_.bytes -= it->bytes;
+            s_.index.erase(it->key);
+            s_.lru.erase(it);
+        }
+
+        sharded_lru& lru_;
+        shard& s_;
+        std::lock_guard<std::mutex> lock_;
+    };
+
+    sharded_lru(std::size_t max_bytes, std::size_t shards)
+      : shardCount_(std::max<std::size_t>(shards, 1))
+      , shardBytes_(max_bytes / shardCount_)
+      , shards_(std::make_unique<shard[]>(shardCount_)) {}
+
+    sharded_lru(const sharded_lru&) = delete;
+    sharded_lru& operator=(const sharded_lru&) = delete;
+
+    locked lock(std::string_view key) {
+        return locked(*this, shards_[std::hash<std::string_view>{}(key) % shardCount_]);
+    }
+
+    // Drop every value, `Extra` stays. Returns how many there were.
+    std::size_t clear() {
+        std::size_t count = 0;
+        for (std::size_t i = 0; i < shardCount_; i++) {
+            auto& s = shards_[i];
+            std::lock_guard lock(s.mutex);
+            count += s.lru.size();
+            s.index.clear();
+            s.lru.clear();
+            s.bytes = 0;
+        }
+        return count;
+    }
+
+    lru_stats stats() const {
+        lru_stats result;
+        result.evictions = evictions_.load();
+        for (std::size_t i = 0; i < shardCount_; i++) {
+            auto& s = shards_[i];
+            std::lock_guard lock(s.mutex);
+            result.entries += s.lru.size();
+            result.bytes += s.bytes;
+        }
+        return result;
+    }
+
+private:
+    const std::size_t shardCount_;
+    const std::size_t shardBytes_;
+    std::unique_ptr<shard[]> shards_;
+    sharded_counter evictions_;
+};
+
+}  // namespace detail
+}  // namespace agrpc
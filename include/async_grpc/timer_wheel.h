@@ -0,0 +1,131 @@
+// hierarchical timer wheel.
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+namespace agrpc {
+
+// Timers are bucketed by their deadline tick on 4 levels of 64 slots. A
+// timer sits on the lowest level whose slots still tell it apart from the
+// current tick and moves down a level whenever its slot comes up, so insert,
+// remove and expiry are all O(1). Deadlines beyond the last level wait in an
+// overflow list.
+//
+// Not thread safe, owned by one `grpc_context`.
+class timer_wheel {
+public:
+    static constexpr std::uint64_t never = std::numeric_limits<std::uint64_t>::max();
+
+    struct node {
+        node* prev = nullptr;
+        node* next = nullptr;
+        std::uint64_t tick = 0;
+        std::uint8_t level = 0;
+        std::uint8_t slot = 0;
+
+        bool linked() const noexcept { return prev != nullptr; }
+    };
+
+    explicit timer_wheel(std::uint64_t now = 0) noexcept;
+
+    timer_wheel(const timer_wheel&) = delete;
+    timer_wheel& operator=(const timer_wheel&) = delete;
+
+    // Add `n`, due at `n->tick`. Returns false without adding it if it is
+    // already due.
+    bool insert(node* n) noexcept;
+
+    // Remove a linked `n`.
+    void remove(node* n) noexcept;
+
+    // The next tick at which `advance` has work to do, `never` if empty.
+    std::uint64_t next_tick() const noexcept;
+
+    // Move the wheel to tick `to`, calling `f(node*)` for every timer that
+    // became due. `f` may insert timers but must not remove other timers.
+    template <typename F>
+    void advance(std::uint64_t to, F&& f) {
+        while (size_ > 0) {
+            int level = 0;
+            auto t = next_event(level);
+            if (t > to) {
+                break;
+            }
+
+            now_ = t;
+            node* head = level < kLevels ? &slots_[level][digit(t, level)] : &overflow_;
+            node pending;
+            take(head, &pending);
+            if (level < kLevels) {
+                occupied_[level] &= ~(std::uint64_t(1) << digit(t, level));
+            }
+
+            while (pending.next != &pending) {
+                node* n = pending.next;
+                unlink(n);
+                --size_;
+                if (!insert(n)) {
+                    f(n);
+                }
+            }
+        }
+
+        if (to > now_) {
+            now_ = to;
+        }
+    }
+
+    // Remove every timer, calling `f(node*)` for each. `f` must not insert.
+    template <typename F>
+    void clear(F&& f) {
+        auto drain = [&](node* head) {
+            while (head->next != head) {
+                node* n = head->next;
+                unlink(n);
+                --size_;
+                f(n);
+            }
+        };
+        for (int level = 0; level < kLevels; ++level) {
+            for (auto& head : slots_[level]) {
+                drain(&head);
+            }
+            occupied_[level] = 0;
+        }
+        drain(&overflow_);
+    }
+
+    std::uint64_t now() const noexcept { return now_; }
+    std::size_t size() const noexcept { return size_; }
+    bool empty() const noexcept { return size_ == 0; }
+
+private:
+    static constexpr int kLevelBits = 6;
+    static constexpr int kLevels = 4;
+    static constexpr std::uint64_t kSlots = std::uint64_t(1) << kLevelBits;
+    static constexpr std::uint64_t kMask = kSlots - 1;
+
+    static std::uint64_t digit(std::uint64_t tick, int level) noexcept {
+        return (tick >> (kLevelBits * level)) & kMask;
+    }
+
+    // the next tick at which a slot of `level` comes up (kLevels for the
+    // overflow list), `never` if empty.
+    std::uint64_t next_event(int& level) const noexcept;
+
+    static void link(node* head, node* n) noexcept;
+    static void unlink(node* n) noexcept;
+    // move all nodes of the list `from` to the empty list `to`.
+    static void take(node* from, node* to) noexcept;
+
+    std::uint64_t now_;
+    std::size_t size_ = 0;
+    std::array<std::uint64_t, kLevels> occupied_{};
+    std::array<std::array<node, kSlots>, kLevels> slots_;
+    node overflow_;
+};
+
+}  // namespace agrpc
@@ -0,0 +1,154 @@
+// worker pool with a work-stealing deque per worker.
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include <async_grpc/grpc_context.h>
+#include <async_grpc/metrics.h>
+#include <async_grpc/worker_pool.h>
+
+namespace agrpc {
+
+namespace detail {
+
+// Chase-Lev deque of tasks: the owner pushes and pops at the bottom, any
+// thread steals from the top. Grows as needed, the arrays it outgrew are
+// kept until destruction since thieves may still read them.
+class task_deque {
+public:
+    explicit task_deque(std::size_t capacity = 64);
+    task_deque(const task_deque&) = delete;
+    task_deque& operator=(const task_deque&) = delete;
+
+    // owner only
+    void push(task_base* task);
+    task_base* pop() noexcept;
+
+    // any thread. Null if empty, or if another thread took the top first.
+    task_base* steal() noexcept;
+
+    // approximate while other threads use the deque
+    std::size_t size() const noexcept {
+        auto b = bottom_.load(std::memory_order_relaxed);
+        auto t = top_.load(std::memory_order_relaxed);
+        return b > t ? static_cast<std::size_t>(b - t) : 0;
+    }
+
+private:
+    struct array {
+        explicit array(std::size_t capacity)
+          : mask(capacity - 1)
+          , slots(std::make_unique<std::atomic<task_base*>[]>(capacity)) {}
+
+        std::size_t capacity() const noexcept { return mask + 1; }
+        task_base* get(std::int64_t i) const noexcept {
+            return slots[static_cast<std::size_t>(i) & mask].load(std::memory_order_relaxed);
+        }
+        void put(std::int64_t i, task_base* task) noexcept {
+            slots[static_cast<std::size_t>(i) & mask].store(task, std::memory_order_relaxed);
+        }
+
+        const std::size_t mask;
+        std::unique_ptr<std::atomic<task_base*>[]> slots;
+    };
+
+    array* grow(array* a, std::int64_t bottom, std::int64_t top);
+
+    alignas(64) std::atomic<std::int64_t> top_{0};
+    alignas(64) std::atomic<std::int64_t> bottom_{0};
+    std::atomic<array*> array_;
+    // owner only
+    std::vector<std::unique_ptr<array>> arrays_;
+};
+
+// The cpus in a Linux cpu list, e.g. "0-3,8,10-11".
+std::vector<int> parse_cpu_list(std::string_view list);
+
+// NUMA node of every cpu, indexed by cpu, from /sys. Empty without NUMA
+// information.
+std::vector<int> numa_nodes();
+
+// The cpus the calling thread may run on, empty on platforms without thread
+// affinity support.
+std::vector<int> allowed_cpus();
+
+// Let the calling thread run on `cpus` only. Does nothing if `cpus` is empty
+// or on platforms without thread affinity support.
+void set_current_thread_cpus(const std::vector<int>& cpus) noexcept;
+
+}  // namespace detail
+
+// Each worker owns a `task_deque`. Tasks submitted from a worker go to its
+// own deque, those from other threads (the io thread) to the inbox of a
+// worker, round robin over the workers on the submitting thread's NUMA node.
+// A worker runs its own tasks newest first, then its inbox, then steals: the
+// oldest task of another worker, or its whole inbox, workers on its own node
+// first. So a slow task holds up nothing but its own worker. Idle workers
+// sleep until the next submission.
+//
+// With `pin`, worker i runs on the i-th cpu the process may use, ordered by
+// NUMA node, or of node `node` only. Without it workers are not tied to a
+// node and any worker takes any submission.
+class work_stealing_pool final : public worker_pool {
+public:
+    struct options {
+        // 0 is one per cpu
+        std::size_t threads = 0;
+        bool pin = false;
+        // NUMA node to pin to, -1 is all of them
+        int node = -1;
+    };
+
+    explicit work_stealing_pool(options options);
+    ~work_stealing_pool() override;
+
+    void submit(task_base* task) noexcept override;
+    std::size_t size() const noexcept override { return workers_.size(); }
+    worker_pool_stats stats() const override;
+
+private:
+    struct alignas(64) worker {
+        detail::task_deque deque;
+        // tasks from other threads, a stack linked by `task_base::next_`
+        std::atomic<task_base*> inbox{nullptr};
+        int node = 0;
+        // workers to steal from, own node first
+        std::vector<std::size_t> victims;
+        std::thread thread;
+        // written by the worker only
+        std::atomic<std::uint64_t> executed{0};
+        std::atomic<std::uint64_t> stolen{0};
+        std::atomic<std::uint64_t> stealAttempts{0};
+        std::atomic<std::uint64_t> parks{0};
+        // tasks pushed to and taken from the inbox, by any thread
+        std::atomic<std::uint64_t> inboxed{0};
+        std::atomic<std::uint64_t> inboxTaken{0};
+    };
+
+    void run(std::size_t index, int cpu) noexcept;
+    task_base* find(std::size_t index) noexcept;
+    // move the inbox of `from` into the deque of `to`, returns the oldest
+    task_base* take_inbox(worker& from, worker& to) noexcept;
+    // wake a sleeping worker, if any
+    void notify() noexcept;
+    // the worker to queue a submission from a foreign thread on
+    worker& pick() noexcept;
+
+    std::vector<std::unique_ptr<worker>> workers_;
+    // workers by NUMA node, for `pick()`
+    std::vector<std::vector<std::size_t>> byNode_;
+    std::vector<int> cpuNode_;
+    bool pinned_ = false;
+    sharded_counter submitted_;
+    // sleeping workers wait for `epoch_` to change
+    alignas(64) std::atomic<std::uint32_t> epoch_{0};
+    std::atomic<std::int32_t> sleepers_{0};
+    std::atomic<bool> stop_{false};
+};
+
+}  // namespace agrpc
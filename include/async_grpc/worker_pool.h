@@ -0,0 +1,133 @@
+// threads running the blocking work of an executor.
+#pragma once
+
+#include <cstddef>
+#include <exception>
+#include <type_traits>
+#include <async_grpc/grpc_context.h>
+#include <async_grpc/metrics.h>
+#include <unifex/config.hpp>
+#include <unifex/get_stop_token.hpp>
+#include <unifex/receiver_concepts.hpp>
+#include <unifex/stop_token_concepts.hpp>
+
+namespace agrpc {
+
+// What `grpc_executor::spawn_blocking` and the blocking handlers of
+// `async_call_data` run on. Implementations run every submitted task exactly
+// once, on one of their threads, as `task->execute(true)`.
+//
+// `work_stealing_pool` is the default one.
+class worker_pool {
+public:
+    class schedule_sender;
+    class scheduler;
+
+    worker_pool() = default;
+    virtual ~worker_pool() = default;
+    worker_pool(const worker_pool&) = delete;
+    worker_pool& operator=(const worker_pool&) = delete;
+
+    // From any thread, `task` must not be submitted again before it ran.
+    virtual void submit(task_base* task) noexcept = 0;
+
+    virtual std::size_t size() const noexcept = 0;
+
+    // Snapshot of the counters, from any thread.
+    virtual worker_pool_stats stats() const = 0;
+
+    scheduler get_scheduler() noexcept;
+};
+
+class worker_pool::schedule_sender {
+    template <typename Receiver>
+    class operation : private task_base {
+    public:
+        void start() noexcept {
+            this->execute_ = &execute_impl;
+            pool_.submit(this);
+        }
+
+    private:
+        friend schedule_sender;
+
+        template <typename Receiver2>
+        explicit operation(worker_pool& pool, Receiver2&& r)
+          : pool_(pool)
+          , receiver_((Receiver2 &&) r) {}
+
+        static void execute_impl(task_base* p, bool) noexcept {
+            using namespace unifex;
+            operation& op = *static_cast<operation*>(p);
+            if constexpr (!is_stop_never_possible_v<stop_token_type_t<Receiver>>) {
+                if (get_stop_token(op.receiver_).stop_requested()) {
+                    unifex::set_done(static_cast<Receiver&&>(op.receiver_));
+                    return;
+                }
+            }
+            if constexpr (is_nothrow_receiver_of_v<Receiver>) {
+                unifex::set_value(static_cast<Receiver&&>(op.receiver_));
+            } else {
+                UNIFEX_TRY {
+                    unifex::set_value(static_cast<Receiver&&>(op.receiver_));
+                }
+                UNIFEX_CATCH(...) {
+                    unifex::set_error(static_cast<Receiver&&>(op.receiver_),
+                                      std::current_exception());
+                }
+            }
+        }
+
+        worker_pool& pool_;
+        Receiver receiver_;
+    };
+
+public:
+    // clang-format off
+    template <
+      template <typename...> class Variant,
+      template <typename...> class Tuple>
+    using value_types = Variant<Tuple<>>;
+
+    template <template <typename...> class Variant>
+    using error_types = Variant<std::exception_ptr>;
+
+    static constexpr bool sends_done = true;
+
+    template <typename Receiver>
+    operation<std::remove_reference_t<Receiver>> connect(Receiver&& r) && {
+        return operation<std::remove_reference_t<Receiver>>{pool_,
+             (Receiver &&) r};
+    }
+    // clang-format on
+
+private:
+    friend scheduler;
+    explicit schedule_sender(worker_pool& pool) noexcept : pool_(pool) {}
+    worker_pool& pool_;
+};
+
+class worker_pool::scheduler {
+public:
+    scheduler(const scheduler&) noexcept = default;
+    scheduler& operator=(const scheduler&) = default;
+    ~scheduler() = default;
+
+    schedule_sender schedule() const noexcept { return schedule_sender{*pool_}; }
+
+private:
+    friend worker_pool;
+
+    friend bool operator==(scheduler a, scheduler b) noexcept { return a.pool_ == b.pool_; }
+    friend bool operator!=(scheduler a, scheduler b) noexcept { return a.pool_ != b.pool_; }
+
+    explicit scheduler(worker_pool& pool) noexcept : pool_(&pool) {}
+
+    worker_pool* pool_;
+};
+
+inline worker_pool::scheduler worker_pool::get_scheduler() noexcept {
+    return scheduler{*this};
+}
+
+}  // namespace agrpc
@@ -0,0 +1,46 @@
+#include "async_grpc/admin_service.h"
+#include <functional>
+#include <utility>
+#include <async_grpc/rpcs.h>
+#include <google/protobuf/empty.pb.h>
+#include <google/protobuf/wrappers.pb.h>
+#include <grpcpp/impl/codegen/rpc_method.h>
+#include <grpcpp/impl/codegen/rpc_service_method.h>
+
+namespace agrpc {
+
+admin_service::admin_service() {
+    // no handler, served through the completion queue
+    AddMethod(new grpc::internal::RpcServiceMethod(
+        kMetricsMethod, grpc::internal::RpcMethod::NORMAL_RPC, nullptr));
+    MarkMethodAsync(0);
+}
+
+void admin_service::RequestMetrics(
+    grpc::ServerContext* context,
+    google::protobuf::Empty* request,
+    grpc::ServerAsyncResponseWriter<google::protobuf::StringValue>* writer,
+    grpc::CompletionQueue* new_call_cq,
+    grpc::ServerCompletionQueue* notification_cq,
+    void* tag) {
+    RequestAsyncUnary(0, context, request, writer, new_call_cq, notification_cq, tag);
+}
+
+unifex::task<void> serve_admin(grpc_executor& ex,
+                               admin_service& svc,
+                               std::function<executor_metrics()> source) {
+    co_await async_call_data<google::protobuf::Empty, google::protobuf::StringValue>(
+        ex,
+        &admin_service::RequestMetrics,
+        &svc,
+        [source = std::move(source)](const grpc::ServerContext&,
+                                     const google::protobuf::Empty&,
+                                     google::protobuf::StringValue& rep) -> bool {
+            rep.set_value(to_json(source()));
+            return true;
+        },
+        false,
+        {.pool_size = 4});
+}
+
+}  // namespace agrpc
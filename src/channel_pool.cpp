@@ -0,0 +1,211 @@
+#include "async_grpc/channel_pool.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <utility>
+#include <fmt/core.h>
+#include <fmt/format.h>
+#include <grpc/grpc.h>
+#include <grpcpp/create_channel.h>
+
+namespace agrpc {
+
+channel_pool::lease::lease(lease&& other) noexcept
+  : pool_(std::exchange(other.pool_, nullptr))
+  , index_(other.index_) {}
+
+channel_pool::lease& channel_pool::lease::operator=(lease&& other) noexcept {
+    if (this != &other) {
+        if (pool_) {
+            pool_->release(index_);
+        }
+        pool_ = std::exchange(other.pool_, nullptr);
+        index_ = other.index_;
+    }
+    return *this;
+}
+
+channel_pool::lease::~lease() {
+    if (pool_) {
+        pool_->release(index_);
+    }
+}
+
+void channel_pool::lease::done(std::chrono::nanoseconds latency, bool ok) noexcept {
+    if (auto* pool = std::exchange(pool_, nullptr)) {
+        pool->release(index_);
+        pool->record(index_, ok, ok ? std::optional(latency) : std::nullopt);
+    }
+}
+
+void channel_pool::lease::done(bool ok) noexcept {
+    if (auto* pool = std::exchange(pool_, nullptr)) {
+        pool->release(index_);
+        pool->record(index_, ok, std::nullopt);
+    }
+}
+
+channel_pool::channel_pool(const std::string& target,
+                           const std::shared_ptr<grpc::ChannelCredentials>& credentials,
+                           options options)
+  : options_(std::move(options))
+  , slots_(std::make_unique<slot[]>(std::max<std::size_t>(options_.size, 1)))
+  , checkedAt_(ticks()) {
+    auto size = std::max<std::size_t>(options_.size, 1);
+    channels_.reserve(size);
+    for (std::size_t i = 0; i < size; ++i) {
+        auto args = options_.args;
+        // channels with distinct args don't share subchannels, hence
+        // connections
+        args.SetInt(GRPC_ARG_USE_LOCAL_SUBCHANNEL_POOL, 1);
+        args.SetInt("agrpc.channel_pool.index", static_cast<int>(i));
+        channels_.push_back(grpc::CreateCustomChannel(target, credentials, args));
+    }
+}
+
+std::int64_t channel_pool::ticks() noexcept {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               clock::now().time_since_epoch())
+        .count();
+}
+
+bool channel_pool::ejected(const slot& s, std::int64_t now) const noexcept {
+    return s.ejectedUntil.load(std::memory_order_relaxed) > now;
+}
+
+channel_pool::lease channel_pool::pick() noexcept {
+    auto n = size();
+    auto now = ticks();
+    auto first = next_.fetch_add(1, std::memory_order_relaxed) % n;
+    std::size_t best = n;
+    std::size_t fewest = std::numeric_limits<std::size_t>::max();
+    // any channel if all are ejected
+    std::size_t fallback = first;
+    std::size_t fallbackInflight = std::numeric_limits<std::size_t>::max();
+    for (std::size_t k = 0; k < n; ++k) {
+        auto i = (first + k) % n;
+        auto inflight = slots_[i].inflight.load(std::memory_order_relaxed);
+        if (inflight < fallbackInflight) {
+            fallback = i;
+            fallbackInflight = inflight;
+        }
+        if (inflight < fewest && !ejected(slots_[i], now)) {
+            best = i;
+            fewest = inflight;
+        }
+    }
+    if (best == n) {
+        best = fallback;
+    }
+    slots_[best].inflight.fetch_add(1, std::memory_order_relaxed);
+    return lease(this, best);
+}
+
+void channel_pool::release(std::size_t index) noexcept {
+    slots_[index].inflight.fetch_sub(1, std::memory_order_relaxed);
+}
+
+void channel_pool::record(std::size_t index,
+                          bool ok,
+                          std::optional<std::chrono::nanoseconds> latency) noexcept {
+    auto& s = slots_[index];
+    s.calls.fetch_add(1, std::memory_order_relaxed);
+    average_in(s.errorRate, ok ? 0 : 1e6);
+    if (latency) {
+        // the first call sets the average, which stays above 0
+        auto sample = std::max<double>(static_cast<double>(latency->count()), 1);
+        if (std::int64_t unset = 0; !s.latency.compare_exchange_strong(
+                unset, std::llround(sample), std::memory_order_relaxed)) {
+            average_in(s.latency, sample);
+        }
+    }
+    check(ticks());
+}
+
+void channel_pool::average_in(std::atomic<std::int64_t>& average,
+                              double sample) const noexcept {
+    auto current = average.load(std::memory_order_relaxed);
+    std::int64_t next;
+    do {
+        auto value = static_cast<double>(current);
+        next = std::llround(value + options_.latency_weight * (sample - value));
+    } while (!average.compare_exchange_weak(current, next, std::memory_order_relaxed));
+}
+
+void channel_pool::check(std::int64_t now) noexcept {
+    auto at = checkedAt_.load(std::memory_order_relaxed);
+    if (now < at + options_.check_interval.count() ||
+        !checkedAt_.compare_exchange_strong(at, now, std::memory_order_relaxed)) {
+        return;
+    }
+    auto n = size();
+    std::vector<std::int64_t> latencies;
+    latencies.reserve(n);
+    std::size_t ejectedCount = 0;
+    for (std::size_t i = 0; i < n; ++i) {
+        if (ejected(slots_[i], now)) {
+            ++ejectedCount;
+        } else if (auto l = slots_[i].latency.load(std::memory_order_relaxed); l > 0) {
+            latencies.push_back(l);
+        }
+    }
+    // no latency outliers without a median to compare to
+    auto limit = std::numeric_limits<double>::infinity();
+    if (latencies.size() >= 2) {
+        auto mid = latencies.begin() + latencies.size() / 2;
+        std::nth_element(latencies.begin(), mid, latencies.end());
+        limit = std::max<double>(static_cast<double>(*mid) * options_.outlier_factor,
+                                 static_cast<double>(options_.min_outlier_latency.count()));
+    }
+    auto maxErrors = options_.max_error_rate * 1e6;
+    auto maxEjected = static_cast<std::size_t>(options_.max_ejected * static_cast<double>(n));
+    for (std::size_t i = 0; i < n && ejectedCount < maxEjected; ++i) {
+        auto& s = slots_[i];
+        if (ejected(s, now) ||
+            (static_cast<double>(s.latency.load(std::memory_order_relaxed)) <= limit &&
+             static_cast<double>(s.errorRate.load(std::memory_order_relaxed)) <= maxErrors)) {
+            continue;
+        }
+        s.ejectedUntil.store(now + options_.ejection_time.count(), std::memory_order_relaxed);
+        // back with a clean slate
+        s.latency.store(0, std::memory_order_relaxed);
+        s.errorRate.store(0, std::memory_order_relaxed);
+        ++ejectedCount;
+        ejections_.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+channel_pool::stats_type channel_pool::stats() const {
+    stats_type result;
+    auto now = ticks();
+    for (std::size_t i = 0; i < size(); ++i) {
+        auto& s = slots_[i];
+        result.channels.push_back(
+            channel_stats{s.inflight.load(std::memory_order_relaxed),
+                          s.calls.load(std::memory_order_relaxed),
+                          std::chrono::nanoseconds(s.latency.load(std::memory_order_relaxed)),
+                          static_cast<double>(s.errorRate.load(std::memory_order_relaxed)) / 1e6,
+                          ejected(s, now)});
+    }
+    result.ejections = ejections_.load(std::memory_order_relaxed);
+    return result;
+}
+
+std::string to_json(const channel_pool::stats_type& s) {
+    std::string out = R"({"channels":[)";
+    for (std::size_t i = 0; i < s.channels.size(); ++i) {
+        auto& c = s.channels[i];
+        out += fmt::format(
+            R"({}{{"inflight":{},"calls":{},"latency_ns":{},"error_rate":{},"ejected":{}}})",
+            i == 0 ? "" : ",",
+            c.inflight,
+            c.calls,
+            c.latency.count(),
+            c.error_rate,
+            c.ejected);
+    }
+    out += fmt::format(R"(],"ejections":{}}})", s.ejections);
+    return out;
+}
+
+}  // namespace agrpc
@@ -0,0 +1,119 @@
+#include "async_grpc/client_cache.h"
+#include <cstdint>
+#include <utility>
+#include <fmt/core.h>
+#include <fmt/format.h>
+
+namespace agrpc {
+
+client_cache::client_cache(options options)
+  : options_(options)
+  , entries_(options.max_bytes, options.shards) {}
+
+std::string client_cache::key_of(std::string_view method, std::string_view request) {
+    std::string key;
+    key.reserve(sizeof(std::uint32_t) + method.size() + request.size());
+    // sized, so that no method and request run into each other
+    detail::append_sized(key, method);
+    key.append(request);
+    return key;
+}
+
+client_cache::lookup_result client_cache::lookup(const std::string& key) {
+    lookup_result result;
+    auto now = clock::now();
+    {
+        auto shard = entries_.lock(key);
+        if (auto* e = shard.get(key)) {
+            if (now < e->freshUntil) {
+                result.state = lookup_result::fresh;
+            } else if (now < e->staleUntil) {
+                result.state = lookup_result::stale;
+                result.refresh = !std::exchange(e->refreshing, true);
+            } else {
+                shard.erase(key);
+            }
+            if (result.state != lookup_result::miss) {
+                result.reply = e->reply;
+            }
+        }
+    }
+    switch (result.state) {
+        case lookup_result::fresh:
+            hits_.add();
+            break;
+        case lookup_result::stale:
+            staleHits_.add();
+            break;
+        case lookup_result::miss:
+            misses_.add();
+            break;
+    }
+    return result;
+}
+
+client_cache::join_result client_cache::join(const std::string& key) {
+    join_result result;
+    {
+        auto shard = entries_.lock(key);
+        auto [it, inserted] = shard.extra().try_emplace(key);
+        if (inserted) {
+            it->second = std::make_shared<flight>();
+        }
+        result.call = it->second;
+        result.leader = inserted;
+    }
+    if (!result.leader) {
+        coalesced_.add();
+    }
+    return result;
+}
+
+void client_cache::land(const std::string& key,
+                        const std::shared_ptr<flight>& f,
+                        std::exception_ptr error,
+                        std::string reply) {
+    auto now = clock::now();
+    {
+        auto shard = entries_.lock(key);
+        shard.extra().erase(key);
+        if (error) {
+            // the stale entry stays until it expires, the next hit refreshes
+            if (auto* e = shard.find(key)) {
+                e->refreshing = false;
+            }
+        } else {
+            shard.put(key,
+                      entry{reply, now + options_.ttl, now + options_.ttl + options_.stale},
+                      reply.size());
+        }
+    }
+    f->error = std::move(error);
+    f->reply = std::move(reply);
+    f->done.set();
+}
+
+void client_cache::clear() {
+    entries_.clear();
+}
+
+client_cache::stats_type client_cache::stats() const {
+    stats_type result;
+    static_cast<lru_stats&>(result) = entries_.stats();
+    result.hits = hits_.load();
+    result.stale_hits = staleHits_.load();
+    result.misses = misses_.load();
+    result.coalesced = coalesced_.load();
+    return result;
+}
+
+std::string to_json(const client_cache::stats_type& s) {
+    return fmt::format(R"({{"hits":{},"stale_hits":{},"misses":{},"coalesced":{},{}}})",
+                       s.hits,
+                       s.stale_hits,
+                       s.misses,
+                       s.coalesced,
+                       detail::json_members(s));
+}
+
+}  // namespace agrpc
@@ -0,0 +1,142 @@
+#include "async_grpc/concurrency_limiter.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <fmt/core.h>
+#include <fmt/format.h>
+
+namespace agrpc {
+
+concurrency_limiter::concurrency_limiter(options options)
+  : options_(options)
+  , limit_(static_cast<double>(
+        std::clamp(options.limit, options.min_limit, options.max_limit))) {}
+
+unifex::task<bool> concurrency_limiter::acquire(const grpc::ServerContext* context) {
+    waiter w;
+    {
+        std::lock_guard lock(mutex_);
+        if (inflight_ < current_limit()) {
+            ++inflight_;
+            ++admitted_;
+            co_return true;
+        }
+        if (waiters_.size() >= options_.queue) {
+            ++rejected_;
+            co_return false;
+        }
+        waiters_.push_back(&w);
+    }
+    // `release` counted the call in when it handed the slot over
+    co_await w.admitted.async_wait();
+    if (context && context->IsCancelled()) {
+        // the client is gone, the slot goes to the next one without a
+        // latency sample
+        {
+            std::lock_guard lock(mutex_);
+            --inflight_;
+        }
+        hand_over();
+        co_return false;
+    }
+    co_return true;
+}
+
+void concurrency_limiter::release(std::chrono::nanoseconds latency, bool ok) {
+    {
+        std::lock_guard lock(mutex_);
+        adapt(latency, ok);
+        --inflight_;
+    }
+    hand_over();
+}
+
+void concurrency_limiter::hand_over() {
+    // one at a time, waiters resume outside the lock
+    for (;;) {
+        waiter* w = nullptr;
+        {
+            std::lock_guard lock(mutex_);
+            if (waiters_.empty() || inflight_ >= current_limit()) {
+                return;
+            }
+            w = waiters_.front();
+            waiters_.pop_front();
+            ++inflight_;
+            ++admitted_;
+        }
+        w->admitted.set();
+    }
+}
+
+void concurrency_limiter::adapt(std::chrono::nanoseconds latency, bool ok) {
+    const auto min = static_cast<double>(options_.min_limit);
+    const auto max = static_cast<double>(options_.max_limit);
+    // only grow while the limit is actually in use
+    bool busy = static_cast<double>(inflight_) * 2 >= limit_;
+
+    switch (options_.mode) {
+    case limit_mode::fixed:
+        return;
+
+    case limit_mode::aimd:
+        if (!ok || latency > options_.latency_target) {
+            limit_ = std::max(min, limit_ * options_.backoff);
+        } else if (busy) {
+            limit_ = std::min(max, limit_ + 1 / limit_);
+        }
+        return;
+
+    case limit_mode::gradient: {
+        if (!ok) {
+            limit_ = std::max(min, limit_ * options_.backoff);
+            return;
+        }
+        auto ns = static_cast<double>(latency.count());
+        if (longLatency_ == 0) {
+            longLatency_ = shortLatency_ = std::max(ns, 1.0);
+        }
+        shortLatency_ += options_.smoothing * (ns - shortLatency_);
+        longLatency_ += (ns - longLatency_) / 500;
+        // after an overload the long term average lags far behind, pull it
+        // down so that the limit recovers
+        if (longLatency_ > 2 * shortLatency_) {
+            longLatency_ *= 0.95;
+        }
+        auto gradient = std::clamp(longLatency_ / std::max(shortLatency_, 1.0), 0.5, 1.0);
+        auto next = limit_ * gradient + (busy ? std::sqrt(limit_) : 0);
+        limit_ = std::clamp(limit_ * 0.8 + next * 0.2, min, max);
+        return;
+    }
+    }
+}
+
+std::size_t concurrency_limiter::current_limit() const noexcept {
+    return std::max(options_.min_limit, static_cast<std::size_t>(limit_));
+}
+
+concurrency_limiter::stats_type concurrency_limiter::stats() const {
+    std::lock_guard lock(mutex_);
+    stats_type s;
+    s.limit = current_limit();
+    s.inflight = inflight_;
+    s.queued = waiters_.size();
+    s.admitted = admitted_;
+    s.rejected = rejected_;
+    return s;
+}
+
+std::string to_json(const concurrency_limiter::stats_type& s) {
+    return fmt::format(
+        R"({{"limit":{},"inflight":{},"queued":{},"admitted":{},"rejected":{}}})",
+        s.limit,
+        s.inflight,
+        s.queued,
+        s.admitted,
+        s.rejected);
+}
+
+}  // namespace agrpc
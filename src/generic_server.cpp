@@ -0,0 +1,163 @@
+#include "async_grpc/generic_server.h"
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <utility>
+#include <grpcpp/completion_queue.h>
+#include <unifex/done_as_optional.hpp>
+#include <unifex/scope_guard.hpp>
+
+namespace agrpc {
+
+void generic_router::add(std::string method, generic_handler handler) {
+    methods_[std::move(method)] = std::move(handler);
+}
+
+void generic_router::add_prefix(std::string prefix, generic_handler handler) {
+    auto it = std::find_if(prefixes_.begin(), prefixes_.end(), [&](auto& p) {
+        return p.first.size() < prefix.size();
+    });
+    prefixes_.emplace(it, std::move(prefix), std::move(handler));
+}
+
+void generic_router::set_fallback(generic_handler handler) {
+    fallback_ = std::move(handler);
+}
+
+const generic_handler* generic_router::route(std::string_view method) const {
+    if (auto it = methods_.find(method); it != methods_.end()) {
+        return &it->second;
+    }
+    for (auto& [prefix, handler] : prefixes_) {
+        if (method.substr(0, prefix.size()) == prefix) {
+            return &handler;
+        }
+    }
+    return fallback_ ? &fallback_ : nullptr;
+}
+
+namespace {
+
+struct generic_call {
+    generic_call() : stream(&context) {}
+
+    grpc::GenericServerContext context;
+    grpc::GenericServerAsyncReaderWriter stream;
+    grpc::ByteBuffer request;
+    grpc::ByteBuffer reply;
+};
+
+struct generic_call_data {
+    grpc_executor& ex;
+    grpc::AsyncGenericService* svc;
+    std::shared_ptr<const generic_router> router;
+    call_options options;
+
+    // for `detail::accept_loop`
+    std::unique_ptr<generic_call> new_call() { return std::make_unique<generic_call>(); }
+
+    void request(generic_call& call, grpc::ServerCompletionQueue* cq, void* tag) {
+        svc->RequestCall(&call.context, &call.stream, cq, cq, tag);
+    }
+
+    static void accepted(const std::shared_ptr<generic_call_data>& self,
+                         std::unique_ptr<generic_call> call,
+                         method_stats::clock::time_point time);
+};
+
+// The status of the call, UNKNOWN if the handler throws or it, or the
+// limiter, completes done, so that `make_task` still finishes the call.
+unifex::task<grpc::Status> handle(const generic_handler& handler,
+                                  generic_call& call,
+                                  concurrency_limiter* limiter) {
+    bool ok = false;
+    std::chrono::steady_clock::time_point start;
+    if (limiter) {
+        auto admitted = co_await unifex::done_as_optional(limiter->acquire(&call.context));
+        if (!admitted) {
+            co_return grpc::Status(grpc::StatusCode::UNKNOWN, "unknown");
+        }
+        if (!*admitted) {
+            co_return grpc::Status(grpc::StatusCode::RESOURCE_EXHAUSTED,
+                                   "concurrency limit reached");
+        }
+        start = std::chrono::steady_clock::now();
+    }
+    unifex::scope_guard release = [&]() noexcept {
+        if (limiter) {
+            limiter->release(std::chrono::steady_clock::now() - start, ok);
+        }
+    };
+    grpc::Status status(grpc::StatusCode::UNKNOWN, "unknown");
+    try {
+        auto result = co_await unifex::done_as_optional(
+            handler(call.context, call.request, call.reply));
+        if (result) {
+            status = std::move(*result);
+        }
+    } catch (const std::exception& e) {
+        status = grpc::Status(grpc::StatusCode::UNKNOWN, e.what());
+    } catch (...) {
+        status = grpc::Status(grpc::StatusCode::UNKNOWN, "unknown");
+    }
+    ok = status.ok();
+    co_return status;
+}
+
+unifex::task<void> make_task(std::shared_ptr<generic_call_data> self,
+                             std::unique_ptr<generic_call> call,
+                             method_stats::clock::time_point accepted) {
+    auto& ex = self->ex;
+    auto started = method_stats::clock::now();
+    bool ok = false;
+    // also if the call throws or completes done, `end_drain()` waits for it
+    unifex::scope_guard finished = [&]() noexcept {
+        ex.call_finished(ok && !call->context.IsCancelled());
+    };
+    bool read = co_await ex.async([&](grpc::CompletionQueue*, void* tag) {
+        call->stream.Read(&call->request, tag);
+    });
+
+    grpc::Status status;
+    if (!read) {
+        status = grpc::Status(grpc::StatusCode::INTERNAL, "no request");
+    } else if (auto* handler = self->router->route(call->context.method())) {
+        status = co_await handle(*handler, *call, self->options.call_limiter);
+    } else {
+        status = grpc::Status(grpc::StatusCode::UNIMPLEMENTED,
+                              "unknown method " + call->context.method());
+    }
+
+    auto handled = method_stats::clock::now();
+    ok = co_await ex.async([&](grpc::CompletionQueue*, void* tag) {
+        if (status.ok()) {
+            call->stream.WriteAndFinish(call->reply, grpc::WriteOptions(), status, tag);
+        } else {
+            call->stream.Finish(status, tag);
+        }
+    });
+    if (auto* stats = self->options.stats) {
+        auto now = method_stats::clock::now();
+        stats->record(method_stats::queue, started - accepted);
+        stats->record(method_stats::handler, handled - started);
+        stats->record(method_stats::write, now - handled);
+    }
+}
+
+void generic_call_data::accepted(const std::shared_ptr<generic_call_data>& self,
+                                 std::unique_ptr<generic_call> call,
+                                 method_stats::clock::time_point time) {
+    self->ex.spawn_on(self->ex.get_grpc_scheduler(), make_task(self, std::move(call), time));
+}
+
+}  // namespace
+
+unifex::task<void> async_generic_call_data(grpc_executor& ex,
+                                           grpc::AsyncGenericService* svc,
+                                           std::shared_ptr<const generic_router> router,
+                                           call_options options) {
+    co_await detail::accept_loops(std::make_shared<generic_call_data>(
+        generic_call_data{ex, svc, std::move(router), options}));
+}
+
+}  // namespace agrpc
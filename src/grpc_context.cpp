@@ -1,9 +1,12 @@
 #include "async_grpc/grpc_context.h"
 #include "grpc/impl/codegen/gpr_types.h"
 #include "grpc/support/time.h"
+#include <chrono>
 #include <cstddef>
+#include <cstdint>
 #include <cstdio>
 #include <cstdlib>
+#include <mutex>
 #include <utility>
 #include <absl/debugging/failure_signal_handler.h>
 #include <absl/debugging/symbolize.h>
@@ -28,10 +31,46 @@ namespace agrpc {
 
 static thread_local grpc_context* kCurrentThreadContext = nullptr;
 
-grpc_context::grpc_context(std::unique_ptr<grpc::CompletionQueue> cq)
-  : remoteQueueReadSubmitted_(false)
+namespace {
+// Counts the events of one turn against its `loop_budget`.
+class budget_meter {
+public:
+    explicit budget_meter(const loop_budget& budget) noexcept
+      : budget_(budget)
+      , start_(budget.time.count() > 0 ? std::chrono::steady_clock::now()
+                                       : std::chrono::steady_clock::time_point()) {}
+
+    bool exhausted(std::size_t events) const noexcept {
+        if (budget_.events > 0 && events >= budget_.events) {
+            return true;
+        }
+        return budget_.time.count() > 0
+               && std::chrono::steady_clock::now() - start_ >= budget_.time;
+    }
+
+private:
+    const loop_budget& budget_;
+    std::chrono::steady_clock::time_point start_;
+};
+}  // namespace
+
+grpc_context::grpc_context(std::unique_ptr<grpc::CompletionQueue> cq,
+                           loop_options options)
+  : options_(options)
+  , remoteQueueReadSubmitted_(false)
   , isNotifing_(false)
-  , completionQueue_(std::move(cq)) {}
+  , completionQueue_(std::move(cq))
+  , shutdownRequested_(false)
+  , shutdown_(false)
+  , timerEpoch_(clock::now())
+  , timerTick_(std::chrono::milliseconds(1))
+  , timerAlarmSet_(false)
+  , timerAlarmTick_(timer_wheel::never) {
+    shutdownTask_.ctx = this;
+    shutdownTask_.execute_ = [](task_base* t, bool) noexcept {
+        static_cast<shutdown_task*>(t)->ctx->shutdown_local();
+    };
+}
 
 grpc_context::~grpc_context() { completionQueue_->Shutdown(); }
 
@@ -51,7 +90,12 @@ void grpc_context::run_impl(const bool& shouldStop) {
     absl::FailureSignalHandlerOptions option;
     absl::InstallFailureSignalHandler(option);
 
+    bool drained = false;
+    lastMark_ = clock::now();
     while (true) {
+        detail::bump(counters_.iterations);
+        detail::bump(counters_.busyNs, mark());
+
         // Dequeue and process local queue items (ready to run)
         execute_pending_local();
 
@@ -59,20 +103,99 @@ void grpc_context::run_impl(const bool& shouldStop) {
             break;
         }
 
-        // Check for remotely-queued items.
-        // Only do this if we haven't submitted a poll operation for the
-        // completion queue - in which case we'll just wait until we receive the
-        // completion-queue item).
-        if (!remoteQueueReadSubmitted_) {
-            remoteQueueReadSubmitted_ = try_schedule_local_remote_queue_contents();
-            LOG("try_schedule_local_remote_queue_contents({})",
-                remoteQueueReadSubmitted_);
+        // Items handed over by other threads.
+        execute_pending_remote();
+
+        bool more = localQueue_.empty() && remoteBacklog_.empty()
+                        ? wait_for_work()
+                        : acquire_completion_queue_items(gpr_inf_past(GPR_CLOCK_MONOTONIC));
+        if (!more) {
+            drained = true;
+            break;
         }
+    }
 
+    if (drained) {
+        // the completion queue is drained, finish what was scheduled
+        // meanwhile. Nothing signals the remote queue anymore, poll it.
         if (remoteQueueReadSubmitted_) {
-            acquire_completion_queue_items();
+            (void)remoteQueue_.try_mark_active();
+            remoteQueueReadSubmitted_ = false;
+        }
+        do {
+            execute_pending_local();
+            execute_pending_remote();
+        } while (!localQueue_.empty() || !remoteBacklog_.empty());
+        LOG("completion queue drained");
+    }
+}
+
+bool grpc_context::wait_for_work() {
+    if (!remoteQueueReadSubmitted_) {
+        if (options_.idle_spin.count() > 0) {
+            // The remote queue stays active meanwhile, so enqueues from other
+            // threads need no signal at all.
+            auto until = clock::now() + options_.idle_spin;
+            do {
+                auto events = counters_.cqEvents.load(std::memory_order_relaxed);
+                if (!acquire_completion_queue_items(gpr_inf_past(GPR_CLOCK_MONOTONIC))) {
+                    return false;
+                }
+                remoteBacklog_ = remoteQueue_.dequeue_all();
+                if (!localQueue_.empty() || !remoteBacklog_.empty()
+                    || counters_.cqEvents.load(std::memory_order_relaxed) != events) {
+                    detail::bump(counters_.spinWakeups);
+                    return true;
+                }
+            } while (clock::now() < until);
+        }
+
+        // from now on the first enqueue from another thread signals
+        // `workAlarm_`
+        remoteBacklog_ = remoteQueue_.try_mark_inactive_or_dequeue_all();
+        if (!remoteBacklog_.empty()) {
+            return true;
+        }
+        remoteQueueReadSubmitted_ = true;
+    }
+
+    detail::bump(counters_.sleeps);
+    return acquire_completion_queue_items(gpr_inf_future(GPR_CLOCK_MONOTONIC));
+}
+
+std::uint64_t grpc_context::mark() noexcept {
+    auto now = clock::now();
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(now - lastMark_).count();
+    lastMark_ = now;
+    return static_cast<std::uint64_t>(ns);
+}
+
+void grpc_context::shutdown() {
+    if (!shutdownRequested_.exchange(true)) {
+        schedule_impl(&shutdownTask_);
+    }
+}
+
+void grpc_context::shutdown_local() noexcept {
+    {
+        std::lock_guard lock(shutdownMutex_);
+        if (shutdown_) {
+            return;
         }
+        shutdown_ = true;
+    }
+    LOG("shutdown completion queue");
+    if (timerAlarmSet_) {
+        // the queue only finishes shutting down once every alarm came back
+        timerAlarm_.Cancel();
     }
+    // no alarm fires pending timers anymore, they complete done
+    timers_.clear([this](timer_wheel::node* n) {
+        auto* op = static_cast<timer_base*>(n);
+        op->stopped_ = true;
+        schedule_local(op);
+    });
+    completionQueue_->Shutdown();
 }
 
 void grpc_context::schedule_impl(task_base* op) {
@@ -92,10 +215,7 @@ void grpc_context::schedule_local(task_base* op) noexcept {
     UNIFEX_ASSERT(op->enqueued_.load() == 0);
     ++op->enqueued_;
     localQueue_.push_back(op);
-}
-
-void grpc_context::schedule_local(task_queue ops) noexcept {
-    localQueue_.append(std::move(ops));
+    detail::bump(counters_.localScheduled);
 }
 
 void grpc_context::schedule_remote(task_base* op) noexcept {
@@ -103,6 +223,7 @@ void grpc_context::schedule_remote(task_base* op) noexcept {
     UNIFEX_ASSERT(op->execute_);
     UNIFEX_ASSERT(op->enqueued_.load() == 0);
     ++op->enqueued_;
+    counters_.remoteScheduled.add();
     bool io_thread_was_inactive = remoteQueue_.enqueue(op);
     LOG("io thread inactive: {}", io_thread_was_inactive);
     if (io_thread_was_inactive) {
@@ -118,8 +239,16 @@ void grpc_context::execute_pending_local() noexcept {
 
     LOG("processing local queue items");
     size_t count = 0;
+    budget_meter meter(options_.local);
     auto pending = std::move(localQueue_);
     while (!pending.empty()) {
+        if (meter.exhausted(count)) {
+            // ahead of whatever got scheduled meanwhile
+            detail::bump(counters_.localExhausted);
+            localQueue_.prepend(std::move(pending));
+            break;
+        }
+
         auto* item = pending.pop_front();
 
         UNIFEX_ASSERT(item->enqueued_.load() == 1);
@@ -130,58 +259,205 @@ void grpc_context::execute_pending_local() noexcept {
         ++count;
     }
 
+    detail::bump(counters_.localEvents, count);
     LOG("processed {} local queue items", count);
 }
 
-void grpc_context::acquire_completion_queue_items() {
+void grpc_context::execute_pending_remote() noexcept {
+    if (remoteBacklog_.empty()) {
+        if (remoteQueueReadSubmitted_) {
+            // inactive, `workAlarm_` tells when there is something
+            return;
+        }
+        remoteBacklog_ = remoteQueue_.dequeue_all();
+        if (remoteBacklog_.empty()) {
+            LOG("remote queue is empty");
+            return;
+        }
+    }
+
+    LOG("processing remote queue items");
+    size_t count = 0;
+    budget_meter meter(options_.remote);
+    while (!remoteBacklog_.empty()) {
+        if (meter.exhausted(count)) {
+            detail::bump(counters_.remoteExhausted);
+            break;
+        }
+
+        auto* item = remoteBacklog_.pop_front();
+
+        UNIFEX_ASSERT(item->enqueued_.load() == 1);
+        --item->enqueued_;
+        std::exchange(item->next_, nullptr);
+
+        item->execute(true);
+        ++count;
+    }
+
+    detail::bump(counters_.remoteEvents, count);
+    LOG("processed {} remote queue items", count);
+}
+
+bool grpc_context::acquire_completion_queue_items(gpr_timespec deadline) {
     LOG("get from completion queue");
 
     void* tag = nullptr;
     bool ok;
+    size_t count = 0;
 
-    if (!completionQueue_->Next(&tag, &ok)) {
-        LOG("completion queue is shutting down.");
-        exit(-1);
+    bool sleep = gpr_time_cmp(deadline, gpr_inf_future(GPR_CLOCK_MONOTONIC)) == 0;
+    if (sleep) {
+        detail::bump(counters_.busyNs, mark());
+    }
+    auto status = completionQueue_->AsyncNext(&tag, &ok, deadline);
+    if (sleep) {
+        auto blocked = mark();
+        detail::bump(counters_.blockedNs, blocked);
+        blockedTime_.record(blocked);
+    }
+    if (status == grpc::CompletionQueue::NextStatus::SHUTDOWN) {
+        LOG("completion queue is shut down.");
+        return false;
+    } else if (status == grpc::CompletionQueue::NextStatus::TIMEOUT) {
+        return true;
     }
 
+    // the wait for the first event is not part of the turn
+    budget_meter meter(options_.completion_queue);
     do {
         if (tag == (void*)&workAlarm_) {
             LOG("to read from remote queue");
             isNotifing_ = false;
             remoteQueueReadSubmitted_ = false;
-            break;
+            detail::bump(counters_.alarmWakeups);
+        } else if (tag == (void*)&timerAlarm_) {
+            detail::bump(counters_.timerWakeups);
+            on_timer_alarm();
+        } else {
+            auto* task = static_cast<task_base*>(tag);
+            task->execute(ok);
         }
+        ++count;
 
-        auto* task = static_cast<task_base*>(tag);
-        task->execute(ok);
+        if (meter.exhausted(count)) {
+            detail::bump(counters_.cqExhausted);
+            break;
+        }
 
         auto status =
-            completionQueue_->AsyncNext(&tag, &ok, gpr_now(GPR_CLOCK_MONOTONIC));
+            completionQueue_->AsyncNext(&tag, &ok, gpr_inf_past(GPR_CLOCK_MONOTONIC));
         if (status == grpc::CompletionQueue::NextStatus::SHUTDOWN) {
-            LOG("completion queue is shutting down.");
-            exit(-1);
+            LOG("completion queue is shut down.");
+            detail::bump(counters_.cqEvents, count);
+            cqBatch_.record(count);
+            return false;
         } else if (status == grpc::CompletionQueue::NextStatus::TIMEOUT) {
             break;
         }
     } while (true);
+
+    detail::bump(counters_.cqEvents, count);
+    cqBatch_.record(count);
+    return true;
 }
 
-bool grpc_context::try_schedule_local_remote_queue_contents() noexcept {
-    auto ops = remoteQueue_.try_mark_inactive_or_dequeue_all();
-    LOG("{}",
-        ops.empty() ? "remote queue is empty"
-                    : "registered items from remote queue");
-    if (!ops.empty()) {
-        schedule_local(std::move(ops));
-        return false;
+loop_stats grpc_context::stats() const noexcept {
+    constexpr auto relaxed = std::memory_order_relaxed;
+    loop_stats s;
+    s.iterations = counters_.iterations.load(relaxed);
+    s.cq_events = counters_.cqEvents.load(relaxed);
+    s.local_events = counters_.localEvents.load(relaxed);
+    s.remote_events = counters_.remoteEvents.load(relaxed);
+    s.cq_exhausted = counters_.cqExhausted.load(relaxed);
+    s.local_exhausted = counters_.localExhausted.load(relaxed);
+    s.remote_exhausted = counters_.remoteExhausted.load(relaxed);
+    s.sleeps = counters_.sleeps.load(relaxed);
+    s.spin_wakeups = counters_.spinWakeups.load(relaxed);
+    s.alarm_wakeups = counters_.alarmWakeups.load(relaxed);
+    s.timer_wakeups = counters_.timerWakeups.load(relaxed);
+    s.local_scheduled = counters_.localScheduled.load(relaxed);
+    s.remote_scheduled = counters_.remoteScheduled.load();
+    s.blocked_ns = counters_.blockedNs.load(relaxed);
+    s.busy_ns = counters_.busyNs.load(relaxed);
+    return s;
+}
+
+void grpc_context::schedule_timer(timer_base* op) noexcept {
+    UNIFEX_ASSERT(is_running_on_io_thread());
+    op->tick = to_tick(op->deadline_);
+    if (shutdown_) {
+        LOG("timer after shutdown");
+        op->stopped_ = true;
+        schedule_local(op);
+        return;
     }
-    return true;
+    if (!timers_.insert(op)) {
+        LOG("timer already due");
+        schedule_local(op);
+        return;
+    }
+    update_timer_alarm();
+}
+
+void grpc_context::cancel_timer(timer_base* op) noexcept {
+    UNIFEX_ASSERT(is_running_on_io_thread());
+    timers_.remove(op);
+    // `timerAlarm_` stays armed, a spurious wakeup is cheaper than a re-arm.
+}
+
+void grpc_context::update_timer_alarm() noexcept {
+    auto next = timers_.next_tick();
+    if (shutdown_ || next == timer_wheel::never || next >= timerAlarmTick_) {
+        return;
+    }
+
+    timerAlarmTick_ = next;
+    if (timerAlarmSet_) {
+        // re-armed from `on_timer_alarm` once the cancellation arrived
+        LOG("cancel timer alarm");
+        timerAlarm_.Cancel();
+        return;
+    }
+
+    LOG("set timer alarm at tick {}", next);
+    auto delta = (timerEpoch_ + next * timerTick_) - clock::now();
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(delta).count();
+    auto tp = gpr_time_add(gpr_now(GPR_CLOCK_MONOTONIC),
+                           gpr_time_from_nanos(ns > 0 ? ns : 0, GPR_TIMESPAN));
+    timerAlarmSet_ = true;
+    timerAlarm_.Set(completionQueue_.get(), tp, &timerAlarm_);
+}
+
+void grpc_context::on_timer_alarm() noexcept {
+    timerAlarmSet_ = false;
+    timerAlarmTick_ = timer_wheel::never;
+
+    // ticks that started are due
+    auto now = static_cast<std::uint64_t>((clock::now() - timerEpoch_) / timerTick_);
+    timers_.advance(now, [this](timer_wheel::node* n) {
+        schedule_local(static_cast<timer_base*>(n));
+    });
+    update_timer_alarm();
+}
+
+std::uint64_t grpc_context::to_tick(time_point tp) const noexcept {
+    if (tp <= timerEpoch_) {
+        return 0;
+    }
+    // round up, timers never fire early
+    return static_cast<std::uint64_t>((tp - timerEpoch_ + timerTick_ - clock::duration(1))
+                                      / timerTick_);
 }
 
 void grpc_context::signal_remote_queue() {
-    if (!isNotifing_.load()) {
+    std::lock_guard lock(shutdownMutex_);
+    if (shutdown_) {
+        // picked up by the last pass of `run_impl`
+        return;
+    }
+    if (!isNotifing_.exchange(true)) {
         LOG("signal_remote_queue");
-        isNotifing_ = true;
         auto tp = gpr_now(GPR_CLOCK_MONOTONIC);
         workAlarm_.Set(completionQueue_.get(), tp, &workAlarm_);
     }
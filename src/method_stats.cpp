@@ -0,0 +1,96 @@
+#include "async_grpc/method_stats.h"
+#include <atomic>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+#include <fmt/core.h>
+#include <fmt/format.h>
+
+namespace agrpc {
+
+method_stats::method_stats(std::string name) : name_(std::move(name)) {}
+
+method_stats::~method_stats() {
+    for (auto& s : shards_) {
+        delete s.load(std::memory_order_relaxed);
+    }
+}
+
+method_stats::shard& method_stats::local() noexcept {
+    auto& slot = shards_[detail::thread_shard()];
+    auto* s = slot.load(std::memory_order_acquire);
+    if (s == nullptr) {
+        auto* fresh = new shard;
+        if (slot.compare_exchange_strong(s, fresh, std::memory_order_acq_rel)) {
+            s = fresh;
+        } else {
+            // another thread of the same slot won
+            delete fresh;
+        }
+    }
+    return *s;
+}
+
+method_stats::snapshot_type method_stats::snapshot() const {
+    snapshot_type result;
+    result.name = name_;
+    for (auto& slot : shards_) {
+        auto* s = slot.load(std::memory_order_acquire);
+        if (s == nullptr) {
+            continue;
+        }
+        for (int k = 0; k < kinds; ++k) {
+            result.latency[k].merge(s->latency[k].snapshot());
+        }
+    }
+    return result;
+}
+
+std::string to_json(const method_stats::snapshot_type& s) {
+    return fmt::format(R"({{"method":"{}","queue":{},"handler":{},"write":{},"client":{}}})",
+                       s.name,
+                       to_json(s[method_stats::queue]),
+                       to_json(s[method_stats::handler]),
+                       to_json(s[method_stats::write]),
+                       to_json(s[method_stats::client]));
+}
+
+method_stats& stats_registry::get(std::string_view name) {
+    std::lock_guard lock(mutex_);
+    auto it = methods_.find(name);
+    if (it == methods_.end()) {
+        it = methods_
+                 .emplace(std::string(name), std::make_unique<method_stats>(std::string(name)))
+                 .first;
+    }
+    return *it->second;
+}
+
+std::vector<method_stats::snapshot_type> stats_registry::snapshot() const {
+    std::vector<method_stats::snapshot_type> result;
+    std::lock_guard lock(mutex_);
+    result.reserve(methods_.size());
+    for (auto& [name, stats] : methods_) {
+        result.push_back(stats->snapshot());
+    }
+    return result;
+}
+
+bool stats_registry::dump(const std::string& path) const {
+    std::ofstream out(path, std::ios::trunc);
+    for (auto& s : snapshot()) {
+        out << to_json(s) << '\n';
+    }
+    out.flush();
+    return static_cast<bool>(out);
+}
+
+stats_registry& default_stats_registry() {
+    static stats_registry registry;
+    return registry;
+}
+
+}  // namespace agrpc
@@ -0,0 +1,185 @@
+#include "async_grpc/metrics.h"
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <fmt/core.h>
+#include <fmt/format.h>
+
+namespace agrpc {
+
+namespace detail {
+std::size_t thread_shard() noexcept {
+    static std::atomic<std::size_t> next{0};
+    thread_local std::size_t shard =
+        next.fetch_add(1, std::memory_order_relaxed) % sharded_counter::kShards;
+    return shard;
+}
+}  // namespace detail
+
+std::size_t histogram::bucket_of(std::uint64_t value) noexcept {
+    if (value < kSub) {
+        return static_cast<std::size_t>(value);
+    }
+    auto k = 63 - std::countl_zero(value);
+    auto sub = (value >> (k - kSubBits)) & (kSub - 1);
+    return static_cast<std::size_t>(k - kSubBits + 1) * kSub + static_cast<std::size_t>(sub);
+}
+
+std::uint64_t histogram::bucket_lower(std::size_t i) noexcept {
+    if (i < kSub) {
+        return i;
+    }
+    auto group = i / kSub;
+    auto sub = i % kSub;
+    return static_cast<std::uint64_t>(kSub + sub) << (group - 1);
+}
+
+std::uint64_t histogram::bucket_upper(std::size_t i) noexcept {
+    if (i < kSub) {
+        return i;
+    }
+    auto group = i / kSub;
+    return bucket_lower(i) + ((std::uint64_t(1) << (group - 1)) - 1);
+}
+
+void histogram::record(std::uint64_t value) noexcept {
+    buckets_[bucket_of(value)].fetch_add(1, std::memory_order_relaxed);
+    sum_.fetch_add(value, std::memory_order_relaxed);
+    auto max = max_.load(std::memory_order_relaxed);
+    while (value > max
+           && !max_.compare_exchange_weak(max, value, std::memory_order_relaxed)) {
+    }
+}
+
+histogram_snapshot histogram::snapshot() const {
+    histogram_snapshot s;
+    s.buckets.resize(kBuckets);
+    for (std::size_t i = 0; i < kBuckets; ++i) {
+        s.buckets[i] = buckets_[i].load(std::memory_order_relaxed);
+        s.count += s.buckets[i];
+    }
+    s.sum = sum_.load(std::memory_order_relaxed);
+    s.max = max_.load(std::memory_order_relaxed);
+    return s;
+}
+
+void histogram_snapshot::merge(const histogram_snapshot& other) {
+    if (buckets.size() < other.buckets.size()) {
+        buckets.resize(other.buckets.size());
+    }
+    for (std::size_t i = 0; i < other.buckets.size(); ++i) {
+        buckets[i] += other.buckets[i];
+    }
+    count += other.count;
+    sum += other.sum;
+    max = std::max(max, other.max);
+}
+
+std::uint64_t histogram_snapshot::percentile(double q) const noexcept {
+    if (count == 0) {
+        return 0;
+    }
+    auto rank = static_cast<std::uint64_t>(std::ceil(std::clamp(q, 0.0, 1.0) * count));
+    rank = std::max<std::uint64_t>(rank, 1);
+    std::uint64_t seen = 0;
+    for (std::size_t i = 0; i < buckets.size(); ++i) {
+        seen += buckets[i];
+        if (seen >= rank) {
+            return std::min(histogram::bucket_upper(i), max);
+        }
+    }
+    return max;
+}
+
+void executor_metrics::merge(const executor_metrics& other) {
+    auto& a = loop;
+    auto& b = other.loop;
+    a.iterations += b.iterations;
+    a.cq_events += b.cq_events;
+    a.local_events += b.local_events;
+    a.remote_events += b.remote_events;
+    a.cq_exhausted += b.cq_exhausted;
+    a.local_exhausted += b.local_exhausted;
+    a.remote_exhausted += b.remote_exhausted;
+    a.sleeps += b.sleeps;
+    a.spin_wakeups += b.spin_wakeups;
+    a.alarm_wakeups += b.alarm_wakeups;
+    a.timer_wakeups += b.timer_wakeups;
+    a.local_scheduled += b.local_scheduled;
+    a.remote_scheduled += b.remote_scheduled;
+    a.blocked_ns += b.blocked_ns;
+    a.busy_ns += b.busy_ns;
+
+    cq_batch.merge(other.cq_batch);
+    blocked_ns.merge(other.blocked_ns);
+    pool_submitted += other.pool_submitted;
+    pool_started += other.pool_started;
+    calls_inflight += other.calls_inflight;
+}
+
+std::string to_json(const histogram_snapshot& h) {
+    return fmt::format(
+        R"({{"count":{},"mean":{:.1f},"p50":{},"p90":{},"p99":{},"p999":{},"max":{}}})",
+        h.count,
+        h.mean(),
+        h.percentile(0.5),
+        h.percentile(0.9),
+        h.percentile(0.99),
+        h.percentile(0.999),
+        h.max);
+}
+
+std::string to_json(const worker_pool_stats& s) {
+    std::string depth;
+    for (std::size_t i = 0; i < s.depth.size(); ++i) {
+        depth += fmt::format("{}{}", i == 0 ? "" : ",", s.depth[i]);
+    }
+    return fmt::format(
+        R"({{"submitted":{},"executed":{},"queued":{},"stolen":{},"steal_attempts":{},)"
+        R"("steal_rate":{:.3f},"parks":{},"depth":[{}]}})",
+        s.submitted,
+        s.executed,
+        s.queued(),
+        s.stolen,
+        s.steal_attempts,
+        s.steal_rate(),
+        s.parks,
+        depth);
+}
+
+std::string to_json(const executor_metrics& m) {
+    auto& l = m.loop;
+    return fmt::format(
+        R"({{"loop":{{"iterations":{},"cq_events":{},"local_events":{},"remote_events":{},)"
+        R"("cq_exhausted":{},"local_exhausted":{},"remote_exhausted":{},"sleeps":{},)"
+        R"("spin_wakeups":{},"alarm_wakeups":{},"timer_wakeups":{},"local_depth":{},)"
+        R"("remote_depth":{},"blocked_ns":{},"busy_ns":{}}},"cq_batch":{},"blocked_ns":{},)"
+        R"("pool":{{"submitted":{},"backlog":{},"workers":{}}},"calls_inflight":{}}})",
+        l.iterations,
+        l.cq_events,
+        l.local_events,
+        l.remote_events,
+        l.cq_exhausted,
+        l.local_exhausted,
+        l.remote_exhausted,
+        l.sleeps,
+        l.spin_wakeups,
+        l.alarm_wakeups,
+        l.timer_wakeups,
+        l.local_depth(),
+        l.remote_depth(),
+        l.blocked_ns,
+        l.busy_ns,
+        to_json(m.cq_batch),
+        to_json(m.blocked_ns),
+        m.pool_submitted,
+        m.pool_backlog(),
+        to_json(m.pool),
+        m.calls_inflight);
+}
+
+}  // namespace agrpc
@@ -0,0 +1,247 @@
+#include "async_grpc/proxy.h"
+#include <chrono>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <grpcpp/client_context.h>
+#include <grpcpp/completion_queue.h>
+#include <grpcpp/support/byte_buffer.h>
+#include <unifex/async_manual_reset_event.hpp>
+#include <unifex/done_as_optional.hpp>
+#include <unifex/scope_guard.hpp>
+
+namespace agrpc {
+
+namespace {
+
+struct proxy_call {
+    proxy_call() : server(&server_context) {}
+
+    grpc::GenericServerContext server_context;
+    grpc::GenericServerAsyncReaderWriter server;
+    std::unique_ptr<grpc::ClientContext> client_context;
+    std::unique_ptr<grpc::GenericClientAsyncReaderWriter> client;
+    channel_pool::lease lease;
+    // the backend is done, `pump_upstream` starts no more client ops
+    bool backend_done = false;
+    // set while `pump_upstream` has no client op in flight
+    unifex::async_manual_reset_event client_idle{true};
+    // messages each way, a call of at most one each is taken for unary
+    std::size_t requests = 0;
+    std::size_t replies = 0;
+    unifex::async_manual_reset_event upstream_done;
+};
+
+struct proxy_data {
+    grpc_executor& ex;
+    grpc::AsyncGenericService* svc;
+    // one of them
+    grpc::GenericStub* backend;
+    stub_pool<grpc::GenericStub>* backends;
+    call_options options;
+
+    // for `detail::accept_loop`
+    std::unique_ptr<proxy_call> new_call() { return std::make_unique<proxy_call>(); }
+
+    void request(proxy_call& call, grpc::ServerCompletionQueue* cq, void* tag) {
+        svc->RequestCall(&call.server_context, &call.server, cq, cq, tag);
+    }
+
+    static void accepted(const std::shared_ptr<proxy_data>& self,
+                         std::unique_ptr<proxy_call> call,
+                         method_stats::clock::time_point time);
+};
+
+// set by each hop's call itself, not forwarded either way
+bool reserved(grpc::string_ref key) {
+    std::string_view k(key.data(), key.size());
+    return k.starts_with(':') || k.starts_with("grpc-") || k == "user-agent";
+}
+
+// client to backend, until the client is done sending or the backend call is
+// over. Both run on the grpc_context, `backend_done` needs no lock.
+unifex::task<void> pump_upstream(grpc_executor& ex, proxy_call& call) {
+    grpc::ByteBuffer buffer;
+    for (;;) {
+        bool ok = co_await ex.async([&](grpc::CompletionQueue*, void* tag) {
+            call.server.Read(&buffer, tag);
+        });
+        if (call.backend_done) {
+            // the backend call is finishing, it takes no more ops
+            break;
+        }
+        call.client_idle.reset();
+        if (!ok) {
+            co_await ex.async([&](grpc::CompletionQueue*, void* tag) {
+                call.client->WritesDone(tag);
+            });
+            call.client_idle.set();
+            break;
+        }
+        ++call.requests;
+        ok = co_await ex.async([&](grpc::CompletionQueue*, void* tag) {
+            call.client->Write(buffer, tag);
+        });
+        call.client_idle.set();
+        if (!ok) {
+            // the backend call is over, its status tells why
+            break;
+        }
+    }
+    call.upstream_done.set();
+}
+
+unifex::task<void> make_task(std::shared_ptr<proxy_data> self,
+                             std::unique_ptr<proxy_call> call,
+                             method_stats::clock::time_point accepted) {
+    auto& ex = self->ex;
+    auto started = method_stats::clock::now();
+    auto& server_context = call->server_context;
+    bool sent = false;
+    // also if the call throws or completes done, `end_drain()` waits for it
+    unifex::scope_guard finished = [&]() noexcept {
+        ex.call_finished(sent && !server_context.IsCancelled());
+    };
+
+    auto* limiter = self->options.call_limiter;
+    if (limiter) {
+        auto admitted =
+            co_await unifex::done_as_optional(limiter->acquire(&server_context));
+        if (!admitted || !*admitted) {
+            auto status = admitted ? grpc::Status(grpc::StatusCode::RESOURCE_EXHAUSTED,
+                                                  "concurrency limit reached")
+                                   : grpc::Status(grpc::StatusCode::UNKNOWN, "unknown");
+            sent = co_await ex.async([&](grpc::CompletionQueue*, void* tag) {
+                call->server.Finish(status, tag);
+            });
+            co_return;
+        }
+    }
+    grpc::Status status;
+    auto start = std::chrono::steady_clock::now();
+    unifex::scope_guard release = [&]() noexcept {
+        if (limiter) {
+            limiter->release(std::chrono::steady_clock::now() - start, status.ok());
+        }
+    };
+
+    // deadline and cancellation
+    call->client_context = grpc::ClientContext::FromServerContext(server_context);
+    for (auto& [key, value] : server_context.client_metadata()) {
+        if (!reserved(key)) {
+            call->client_context->AddMetadata(std::string(key.data(), key.size()),
+                                              std::string(value.data(), value.size()));
+        }
+    }
+    auto* backend = self->backend;
+    if (self->backends) {
+        call->lease = self->backends->channels().pick();
+        backend = self->backends->stub(call->lease.index());
+    }
+
+    bool ok = co_await ex.async([&](grpc::CompletionQueue* cq, void* tag) {
+        call->client =
+            backend->PrepareCall(call->client_context.get(), server_context.method(), cq);
+        call->client->StartCall(tag);
+    });
+    if (ok) {
+        ex.spawn_local(pump_upstream(ex, *call));
+    } else {
+        call->upstream_done.set();
+    }
+
+    // backend to client, until the backend is done
+    if (ok) {
+        ok = co_await ex.async([&](grpc::CompletionQueue*, void* tag) {
+            call->client->ReadInitialMetadata(tag);
+        });
+    }
+    if (ok) {
+        for (auto& [key, value] : call->client_context->GetServerInitialMetadata()) {
+            if (!reserved(key)) {
+                server_context.AddInitialMetadata(std::string(key.data(), key.size()),
+                                                  std::string(value.data(), value.size()));
+            }
+        }
+        bool forwarding = co_await ex.async([&](grpc::CompletionQueue*, void* tag) {
+            call->server.SendInitialMetadata(tag);
+        });
+        if (!forwarding) {
+            call->client_context->TryCancel();
+        }
+        grpc::ByteBuffer buffer;
+        while (co_await ex.async([&](grpc::CompletionQueue*, void* tag) {
+            call->client->Read(&buffer, tag);
+        })) {
+            ++call->replies;
+            if (forwarding && !co_await ex.async([&](grpc::CompletionQueue*, void* tag) {
+                    call->server.Write(buffer, tag);
+                })) {
+                // the client is gone, drain what the backend still sends
+                call->client_context->TryCancel();
+                forwarding = false;
+            }
+        }
+    }
+
+    // no `Write` or `WritesDone` of the pump may be in flight once the
+    // backend call finished, nor be started after
+    call->backend_done = true;
+    co_await call->client_idle.async_wait();
+    co_await ex.async([&](grpc::CompletionQueue*, void* tag) {
+        call->client->Finish(&status, tag);
+    });
+    for (auto& [key, value] : call->client_context->GetServerTrailingMetadata()) {
+        if (!reserved(key)) {
+            server_context.AddTrailingMetadata(std::string(key.data(), key.size()),
+                                               std::string(value.data(), value.size()));
+        }
+    }
+    // a stream's lifetime says nothing of the channel, only its status does
+    if (call->requests <= 1 && call->replies <= 1) {
+        call->lease.done(method_stats::clock::now() - started, status.ok());
+    } else {
+        call->lease.done(status.ok());
+    }
+
+    auto handled = method_stats::clock::now();
+    sent = co_await ex.async([&](grpc::CompletionQueue*, void* tag) {
+        call->server.Finish(status, tag);
+    });
+    // a read still pending on the server stream fails once it finished
+    co_await call->upstream_done.async_wait();
+
+    if (auto* stats = self->options.stats) {
+        auto now = method_stats::clock::now();
+        stats->record(method_stats::queue, started - accepted);
+        stats->record(method_stats::handler, handled - started);
+        stats->record(method_stats::write, now - handled);
+    }
+}
+
+void proxy_data::accepted(const std::shared_ptr<proxy_data>& self,
+                          std::unique_ptr<proxy_call> call,
+                          method_stats::clock::time_point time) {
+    self->ex.spawn_on(self->ex.get_grpc_scheduler(), make_task(self, std::move(call), time));
+}
+
+}  // namespace
+
+unifex::task<void> async_proxy(grpc_executor& ex,
+                               grpc::AsyncGenericService* svc,
+                               grpc::GenericStub& backend,
+                               call_options options) {
+    return detail::accept_loops(std::make_shared<proxy_data>(
+        proxy_data{ex, svc, &backend, nullptr, options}));
+}
+
+unifex::task<void> async_proxy(grpc_executor& ex,
+                               grpc::AsyncGenericService* svc,
+                               stub_pool<grpc::GenericStub>& backends,
+                               call_options options) {
+    return detail::accept_loops(std::make_shared<proxy_data>(
+        proxy_data{ex, svc, nullptr, &backends, options}));
+}
+
+}  // namespace agrpc
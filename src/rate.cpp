@@ -1,9 +1,12 @@
 // Use a monotonic clock for measuring intervals
 // refer: https://stackoverflow.com/a/55234186
 #include "async_grpc/rate.h"
+#include <algorithm>
 #include <chrono>
+#include <cmath>
 #include <thread>
 #include <limits.h>
+#include <unifex/scheduler_concepts.hpp>
 
 namespace {
 
@@ -36,4 +39,99 @@ void Rate::sleep() const {
     start_ = std::chrono::steady_clock::now();
 }
 
+token_bucket::token_bucket(double rate, double burst)
+  : interval_(std::max<std::int64_t>(std::llround(1e9 / rate), 1))
+  , capacity_(std::llround(std::max(burst, 1.0) * static_cast<double>(interval_)))
+  , full_at_(0) {}
+
+std::int64_t token_bucket::ticks(clock::time_point tp) const noexcept {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(tp.time_since_epoch())
+        .count();
+}
+
+token_bucket::clock::time_point token_bucket::reserve(clock::time_point now) noexcept {
+    auto t = ticks(now);
+    auto full = full_at_.load(std::memory_order_relaxed);
+    std::int64_t next;
+    do {
+        next = std::max(full, t) + interval_;
+    } while (!full_at_.compare_exchange_weak(full, next, std::memory_order_relaxed));
+    // due once the bucket has room for it again
+    return clock::time_point(
+        std::chrono::duration_cast<clock::duration>(std::chrono::nanoseconds(next - capacity_)));
+}
+
+bool token_bucket::try_acquire(clock::time_point now) noexcept {
+    auto t = ticks(now);
+    auto full = full_at_.load(std::memory_order_relaxed);
+    std::int64_t next;
+    do {
+        next = std::max(full, t) + interval_;
+        if (next - capacity_ > t) {
+            return false;
+        }
+    } while (!full_at_.compare_exchange_weak(full, next, std::memory_order_relaxed));
+    return true;
+}
+
+bool token_bucket::idle(clock::time_point now) const noexcept {
+    return full_at_.load(std::memory_order_relaxed) <= ticks(now);
+}
+
+rate_limiter::rate_limiter(grpc_context& ctx, double rate, double burst)
+  : ctx_(ctx)
+  , bucket_(rate, burst) {}
+
+unifex::task<void> rate_limiter::acquire() {
+    auto due = bucket_.reserve();
+    if (due > token_bucket::clock::now()) {
+        co_await unifex::schedule_at(ctx_.get_scheduler(), due);
+    }
+}
+
+keyed_rate_limiter::keyed_rate_limiter(grpc_context& ctx,
+                                       double rate,
+                                       double burst,
+                                       std::size_t max_keys)
+  : ctx_(ctx)
+  , rate_(rate)
+  , burst_(burst)
+  , maxKeys_(std::max<std::size_t>(max_keys, 1)) {}
+
+unifex::task<void> keyed_rate_limiter::acquire(std::string key) {
+    token_bucket::clock::time_point due;
+    {
+        std::lock_guard lock(mutex_);
+        due = bucket(key).reserve();
+    }
+    if (due > token_bucket::clock::now()) {
+        co_await unifex::schedule_at(ctx_.get_scheduler(), due);
+    }
+}
+
+bool keyed_rate_limiter::try_acquire(std::string_view key) {
+    std::lock_guard lock(mutex_);
+    return bucket(key).try_acquire();
+}
+
+std::size_t keyed_rate_limiter::size() const {
+    std::lock_guard lock(mutex_);
+    return lru_.size();
+}
+
+token_bucket& keyed_rate_limiter::bucket(std::string_view key) {
+    auto it = index_.find(key);
+    if (it != index_.end()) {
+        lru_.splice(lru_.begin(), lru_, it->second);
+        return it->second->bucket;
+    }
+    if (lru_.size() >= maxKeys_) {
+        index_.erase(lru_.back().key);
+        lru_.pop_back();
+    }
+    lru_.emplace_front(std::string(key), rate_, burst_);
+    index_.emplace(lru_.front().key, lru_.begin());
+    return lru_.front().bucket;
+}
+
 }  // namespace agrpc
@@ -0,0 +1,85 @@
+#include "async_grpc/response_cache.h"
+#include <utility>
+#include <fmt/core.h>
+#include <fmt/format.h>
+
+namespace agrpc {
+
+response_cache::response_cache(options options)
+  : options_(std::move(options))
+  , entries_(options_.max_bytes, options_.shards) {}
+
+std::string response_cache::key_of(const google::protobuf::Message& request,
+                                   const grpc::ServerContext& context) const {
+    std::vector<std::string_view> values;
+    values.reserve(options_.metadata.size());
+    auto& metadata = context.client_metadata();
+    for (auto& name : options_.metadata) {
+        auto it = metadata.find(name);
+        values.push_back(it == metadata.end()
+                             ? std::string_view()
+                             : std::string_view(it->second.data(), it->second.size()));
+    }
+    return key_of(request, values);
+}
+
+std::string response_cache::key_of(const google::protobuf::Message& request,
+                                   const std::vector<std::string_view>& metadata_values) const {
+    std::string key;
+    // sized, so that no value runs into the next one
+    for (auto value : metadata_values) {
+        detail::append_sized(key, value);
+    }
+    request.AppendToString(&key);
+    return key;
+}
+
+response_cache::reply_ptr response_cache::lookup(const std::string& key) {
+    reply_ptr reply;
+    {
+        auto shard = entries_.lock(key);
+        if (auto* e = shard.get(key)) {
+            if (clock::now() < e->expires) {
+                reply = e->reply;
+            } else {
+                shard.erase(key);
+            }
+        }
+    }
+    (reply ? hits_ : misses_).add();
+    return reply;
+}
+
+void response_cache::insert(const std::string& key, reply_ptr reply) {
+    auto bytes = reply->ByteSizeLong();
+    entries_.lock(key).put(key, entry{std::move(reply), clock::now() + options_.ttl}, bytes);
+}
+
+void response_cache::invalidate(const std::string& key) {
+    if (entries_.lock(key).erase(key)) {
+        invalidations_.add();
+    }
+}
+
+void response_cache::clear() {
+    invalidations_.add(entries_.clear());
+}
+
+response_cache::stats_type response_cache::stats() const {
+    stats_type result;
+    static_cast<lru_stats&>(result) = entries_.stats();
+    result.hits = hits_.load();
+    result.misses = misses_.load();
+    result.invalidations = invalidations_.load();
+    return result;
+}
+
+std::string to_json(const response_cache::stats_type& s) {
+    return fmt::format(R"({{"hits":{},"misses":{},"invalidations":{},{}}})",
+                       s.hits,
+                       s.misses,
+                       s.invalidations,
+                       detail::json_members(s));
+}
+
+}  // namespace agrpc
@@ -0,0 +1,104 @@
+#include "async_grpc/retry.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <random>
+
+namespace {
+
+std::int64_t steady_ns() noexcept {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+}  // namespace
+
+namespace agrpc {
+
+retry_budget::retry_budget(double ratio, double max_tokens)
+  : deposit_(std::llround(std::max(ratio, 0.0) * 1000))
+  , max_(std::llround(std::max(max_tokens, 1.0) * 1000))
+  , tokens_(max_) {}
+
+void retry_budget::deposit() noexcept {
+    auto t = tokens_.load(std::memory_order_relaxed);
+    while (t < max_ && !tokens_.compare_exchange_weak(
+                           t, std::min(t + deposit_, max_), std::memory_order_relaxed)) {
+    }
+}
+
+bool retry_budget::try_withdraw() noexcept {
+    auto t = tokens_.load(std::memory_order_relaxed);
+    do {
+        if (t < 1000) {
+            denied_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+    } while (!tokens_.compare_exchange_weak(t, t - 1000, std::memory_order_relaxed));
+    granted_.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+double retry_budget::tokens() const noexcept {
+    return static_cast<double>(tokens_.load(std::memory_order_relaxed)) / 1000;
+}
+
+latency_percentile::latency_percentile(method_stats& stats,
+                                       double q,
+                                       std::uint64_t min_samples,
+                                       std::chrono::milliseconds refresh)
+  : stats_(stats)
+  , q_(q)
+  , minSamples_(std::max<std::uint64_t>(min_samples, 1))
+  , refresh_(refresh)
+  , refreshedAt_(std::numeric_limits<std::int64_t>::min()) {}
+
+std::optional<std::chrono::nanoseconds> latency_percentile::get() {
+    auto now = steady_ns();
+    auto at = refreshedAt_.load(std::memory_order_relaxed);
+    // one caller recomputes, the others go on with the previous value
+    if (at + refresh_.count() <= now &&
+        refreshedAt_.compare_exchange_strong(at, now, std::memory_order_relaxed)) {
+        auto snapshot = stats_.snapshot();
+        auto& latency = snapshot[method_stats::client];
+        value_.store(latency.count >= minSamples_
+                         ? static_cast<std::int64_t>(latency.percentile(q_))
+                         : 0,
+                     std::memory_order_relaxed);
+    }
+    auto value = value_.load(std::memory_order_relaxed);
+    if (value == 0) {
+        return std::nullopt;
+    }
+    return std::chrono::nanoseconds(value);
+}
+
+bool retry_policy::is_retryable(grpc::StatusCode code) const noexcept {
+    return std::find(retryable.begin(), retryable.end(), code) != retryable.end();
+}
+
+std::optional<std::chrono::nanoseconds> retry_policy::hedge_after() const {
+    if (hedge_percentile) {
+        if (auto delay = hedge_percentile->get()) {
+            return delay;
+        }
+    }
+    if (hedge_delay.count() > 0) {
+        return hedge_delay;
+    }
+    return std::nullopt;
+}
+
+std::chrono::nanoseconds retry_policy::backoff(int retry) const {
+    auto limit = static_cast<double>(max_backoff.count());
+    auto wait = std::min(static_cast<double>(initial_backoff.count()) *
+                             std::pow(multiplier, std::max(retry - 1, 0)),
+                         limit);
+    // full jitter, retries of calls that failed together spread out
+    thread_local std::minstd_rand rng(std::random_device{}());
+    std::uniform_real_distribution<double> jitter(0, std::max(wait, 0.0));
+    return std::chrono::nanoseconds(std::llround(jitter(rng)));
+}
+
+}  // namespace agrpc
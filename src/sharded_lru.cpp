@@ -0,0 +1,20 @@
+#include "async_grpc/sharded_lru.h"
+#include <fmt/core.h>
+#include <fmt/format.h>
+
+namespace agrpc {
+namespace detail {
+
+void append_sized(std::string& key, std::string_view value) {
+    auto size = static_cast<std::uint32_t>(value.size());
+    key.append(reinterpret_cast<const char*>(&size), sizeof(size));
+    key.append(value);
+}
+
+std::string json_members(const lru_stats& s) {
+    return fmt::format(
+        R"("evictions":{},"entries":{},"bytes":{})", s.evictions, s.entries, s.bytes);
+}
+
+}  // namespace detail
+}  // namespace agrpc
@@ -0,0 +1,106 @@
+#include "async_grpc/timer_wheel.h"
+#include <bit>
+#include <cstdint>
+
+namespace agrpc {
+
+timer_wheel::timer_wheel(std::uint64_t now) noexcept : now_(now) {
+    for (auto& level : slots_) {
+        for (auto& head : level) {
+            head.prev = head.next = &head;
+        }
+    }
+    overflow_.prev = overflow_.next = &overflow_;
+}
+
+bool timer_wheel::insert(node* n) noexcept {
+    if (n->tick <= now_) {
+        return false;
+    }
+
+    // the lowest level on which every higher digit matches the current tick
+    auto diff = n->tick ^ now_;
+    for (int level = 0; level < kLevels; ++level) {
+        if ((diff >> (kLevelBits * (level + 1))) == 0) {
+            auto slot = digit(n->tick, level);
+            n->level = static_cast<std::uint8_t>(level);
+            n->slot = static_cast<std::uint8_t>(slot);
+            link(&slots_[level][slot], n);
+            occupied_[level] |= std::uint64_t(1) << slot;
+            ++size_;
+            return true;
+        }
+    }
+
+    n->level = kLevels;
+    n->slot = 0;
+    link(&overflow_, n);
+    ++size_;
+    return true;
+}
+
+void timer_wheel::remove(node* n) noexcept {
+    unlink(n);
+    --size_;
+    if (n->level < kLevels) {
+        auto& head = slots_[n->level][n->slot];
+        if (head.next == &head) {
+            occupied_[n->level] &= ~(std::uint64_t(1) << n->slot);
+        }
+    }
+}
+
+std::uint64_t timer_wheel::next_tick() const noexcept {
+    int level = 0;
+    return next_event(level);
+}
+
+std::uint64_t timer_wheel::next_event(int& level) const noexcept {
+    if (size_ == 0) {
+        return never;
+    }
+
+    // Everything on a level shares the higher digits with the current tick,
+    // so the lowest level with a slot ahead holds the earliest event.
+    for (level = 0; level < kLevels; ++level) {
+        auto shift = kLevelBits * level;
+        auto cur = digit(now_, level);
+        auto ahead = cur == kMask ? 0 : occupied_[level] & (~std::uint64_t(0) << (cur + 1));
+        if (ahead != 0) {
+            auto slot = static_cast<std::uint64_t>(std::countr_zero(ahead));
+            auto prefix = (now_ >> (shift + kLevelBits)) << (shift + kLevelBits);
+            return prefix | (slot << shift);
+        }
+    }
+
+    // the overflow list is revisited whenever the last level rolls over
+    auto shift = kLevelBits * kLevels;
+    return ((now_ >> shift) + 1) << shift;
+}
+
+void timer_wheel::link(node* head, node* n) noexcept {
+    n->prev = head->prev;
+    n->next = head;
+    head->prev->next = n;
+    head->prev = n;
+}
+
+void timer_wheel::unlink(node* n) noexcept {
+    n->prev->next = n->next;
+    n->next->prev = n->prev;
+    n->prev = n->next = nullptr;
+}
+
+void timer_wheel::take(node* from, node* to) noexcept {
+    if (from->next == from) {
+        to->prev = to->next = to;
+        return;
+    }
+    to->next = from->next;
+    to->prev = from->prev;
+    to->next->prev = to;
+    to->prev->next = to;
+    from->prev = from->next = from;
+}
+
+}  // namespace agrpc
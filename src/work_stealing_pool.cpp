@@ -0,0 +1,400 @@
+#include "async_grpc/work_stealing_pool.h"
+#include <algorithm>
+#include <bit>
+#include <charconv>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <system_error>
+#if defined(__linux__)
+#    include <pthread.h>
+#    include <sched.h>
+#endif
+
+namespace agrpc {
+namespace detail {
+
+task_deque::task_deque(std::size_t capacity) {
+    auto n = std::max<std::size_t>(std::bit_ceil(capacity), 2);
+    arrays_.push_back(std::make_unique<array>(n));
+    array_.store(arrays_.back().get(), std::memory_order_relaxed);
+}
+
+task_deque::array* task_deque::grow(array* a, std::int64_t bottom, std::int64_t top) {
+    auto next = std::make_unique<array>(a->capacity() * 2);
+    for (auto i = top; i != bottom; ++i) {
+        next->put(i, a->get(i));
+    }
+    arrays_.push_back(std::move(next));
+    auto* result = arrays_.back().get();
+    array_.store(result, std::memory_order_release);
+    return result;
+}
+
+// "Correct and Efficient Work-Stealing for Weak Memory Models", Lê et al.
+void task_deque::push(task_base* task) {
+    auto b = bottom_.load(std::memory_order_relaxed);
+    auto t = top_.load(std::memory_order_acquire);
+    auto* a = array_.load(std::memory_order_relaxed);
+    if (b - t > static_cast<std::int64_t>(a->capacity()) - 1) {
+        a = grow(a, b, t);
+    }
+    a->put(b, task);
+    std::atomic_thread_fence(std::memory_order_release);
+    bottom_.store(b + 1, std::memory_order_relaxed);
+}
+
+task_base* task_deque::pop() noexcept {
+    auto b = bottom_.load(std::memory_order_relaxed) - 1;
+    auto* a = array_.load(std::memory_order_relaxed);
+    bottom_.store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    auto t = top_.load(std::memory_order_relaxed);
+    if (t > b) {
+        bottom_.store(b + 1, std::memory_order_relaxed);
+        return nullptr;
+    }
+    auto* task = a->get(b);
+    if (t == b) {
+        // the last one, race the thieves for it
+        if (!top_.compare_exchange_strong(
+                t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+            task = nullptr;
+        }
+        bottom_.store(b + 1, std::memory_order_relaxed);
+    }
+    return task;
+}
+
+task_base* task_deque::steal() noexcept {
+    auto t = top_.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    auto b = bottom_.load(std::memory_order_acquire);
+    if (t >= b) {
+        return nullptr;
+    }
+    auto* task = array_.load(std::memory_order_acquire)->get(t);
+    if (!top_.compare_exchange_strong(
+            t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+        return nullptr;
+    }
+    return task;
+}
+
+std::vector<int> parse_cpu_list(std::string_view list) {
+    std::vector<int> cpus;
+    auto number = [](std::string_view s, int& out) {
+        auto [end, ec] = std::from_chars(s.data(), s.data() + s.size(), out);
+        return ec == std::errc() && end == s.data() + s.size();
+    };
+    while (!list.empty()) {
+        auto comma = list.find(',');
+        auto item = list.substr(0, comma);
+        list = comma == std::string_view::npos ? std::string_view() : list.substr(comma + 1);
+        while (!item.empty() && (item.back() == '\n' || item.back() == ' ')) {
+            item.remove_suffix(1);
+        }
+        if (item.empty()) {
+            continue;
+        }
+        int first = 0;
+        int last = 0;
+        auto dash = item.find('-');
+        if (dash == std::string_view::npos) {
+            if (!number(item, first)) {
+                return {};
+            }
+            last = first;
+        } else if (!number(item.substr(0, dash), first) ||
+                   !number(item.substr(dash + 1), last) || last < first) {
+            return {};
+        }
+        for (int cpu = first; cpu <= last; ++cpu) {
+            cpus.push_back(cpu);
+        }
+    }
+    return cpus;
+}
+
+std::vector<int> numa_nodes() {
+    namespace fs = std::filesystem;
+    std::vector<int> nodes;
+    std::error_code ec;
+    fs::directory_iterator it("/sys/devices/system/node", ec);
+    if (ec) {
+        return nodes;
+    }
+    for (auto& entry : it) {
+        auto name = entry.path().filename().string();
+        int node = 0;
+        if (name.rfind("node", 0) != 0 ||
+            std::from_chars(name.data() + 4, name.data() + name.size(), node).ec !=
+                std::errc()) {
+            continue;
+        }
+        std::ifstream in(entry.path() / "cpulist");
+        std::string list;
+        std::getline(in, list);
+        for (auto cpu : parse_cpu_list(list)) {
+            if (static_cast<std::size_t>(cpu) >= nodes.size()) {
+                nodes.resize(static_cast<std::size_t>(cpu) + 1, 0);
+            }
+            nodes[cpu] = node;
+        }
+    }
+    return nodes;
+}
+
+std::vector<int> allowed_cpus() {
+    std::vector<int> cpus;
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (pthread_getaffinity_np(pthread_self(), sizeof(set), &set) == 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            if (CPU_ISSET(cpu, &set)) {
+                cpus.push_back(cpu);
+            }
+        }
+    }
+#endif
+    return cpus;
+}
+
+void set_current_thread_cpus(const std::vector<int>& cpus) noexcept {
+#if defined(__linux__)
+    if (cpus.empty()) {
+        return;
+    }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (auto cpu : cpus) {
+        if (cpu >= 0 && cpu < CPU_SETSIZE) {
+            CPU_SET(cpu, &set);
+        }
+    }
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+    (void)cpus;
+#endif
+}
+
+}  // namespace detail
+
+namespace {
+
+// the worker the calling thread is, if any
+thread_local const work_stealing_pool* currentPool = nullptr;
+thread_local std::size_t currentWorker = 0;
+
+int current_cpu() noexcept {
+#if defined(__linux__)
+    return sched_getcpu();
+#else
+    return -1;
+#endif
+}
+
+int node_of(const std::vector<int>& nodes, int cpu) noexcept {
+    return cpu >= 0 && static_cast<std::size_t>(cpu) < nodes.size() ? nodes[cpu] : 0;
+}
+
+}  // namespace
+
+work_stealing_pool::work_stealing_pool(options options) {
+    auto n = options.threads != 0 ? options.threads
+                                   : std::max(std::thread::hardware_concurrency(), 1u);
+    // the cpu of every worker when pinned, ordered by node
+    std::vector<int> cpus;
+    if (options.pin) {
+        cpuNode_ = detail::numa_nodes();
+        cpus = detail::allowed_cpus();
+        if (options.node >= 0) {
+            std::vector<int> local;
+            std::copy_if(cpus.begin(), cpus.end(), std::back_inserter(local), [&](int cpu) {
+                return node_of(cpuNode_, cpu) == options.node;
+            });
+            if (!local.empty()) {
+                cpus = std::move(local);
+            }
+        }
+        std::stable_sort(cpus.begin(), cpus.end(), [&](int a, int b) {
+            return node_of(cpuNode_, a) < node_of(cpuNode_, b);
+        });
+        pinned_ = !cpus.empty();
+    }
+
+    workers_.reserve(n);
+    for (std::size_t i = 0; i < n; ++i) {
+        auto w = std::make_unique<worker>();
+        w->node = pinned_ ? node_of(cpuNode_, cpus[i % cpus.size()]) : 0;
+        if (static_cast<std::size_t>(w->node) >= byNode_.size()) {
+            byNode_.resize(static_cast<std::size_t>(w->node) + 1);
+        }
+        byNode_[w->node].push_back(i);
+        workers_.push_back(std::move(w));
+    }
+    for (std::size_t i = 0; i < n; ++i) {
+        auto& victims = workers_[i]->victims;
+        for (std::size_t k = 1; k < n; ++k) {
+            victims.push_back((i + k) % n);
+        }
+        std::stable_partition(victims.begin(), victims.end(), [&](std::size_t v) {
+            return workers_[v]->node == workers_[i]->node;
+        });
+    }
+    for (std::size_t i = 0; i < n; ++i) {
+        auto cpu = pinned_ ? cpus[i % cpus.size()] : -1;
+        workers_[i]->thread = std::thread([this, i, cpu]() { run(i, cpu); });
+    }
+}
+
+work_stealing_pool::~work_stealing_pool() {
+    stop_.store(true);
+    epoch_.fetch_add(1);
+    epoch_.notify_all();
+    for (auto& w : workers_) {
+        w->thread.join();
+    }
+}
+
+void work_stealing_pool::submit(task_base* task) noexcept {
+    submitted_.add();
+    if (currentPool == this) {
+        workers_[currentWorker]->deque.push(task);
+    } else {
+        auto& w = pick();
+        w.inboxed.fetch_add(1, std::memory_order_relaxed);
+        auto* head = w.inbox.load(std::memory_order_relaxed);
+        do {
+            task->next_ = head;
+        } while (!w.inbox.compare_exchange_weak(
+            head, task, std::memory_order_release, std::memory_order_relaxed));
+    }
+    notify();
+}
+
+work_stealing_pool::worker& work_stealing_pool::pick() noexcept {
+    thread_local std::size_t next = 0;
+    auto i = next++;
+    if (pinned_) {
+        auto node = node_of(cpuNode_, current_cpu());
+        if (static_cast<std::size_t>(node) < byNode_.size() && !byNode_[node].empty()) {
+            auto& local = byNode_[node];
+            return *workers_[local[i % local.size()]];
+        }
+    }
+    return *workers_[i % workers_.size()];
+}
+
+void work_stealing_pool::notify() noexcept {
+    // pairs with the fence in `run()`: either the worker going to sleep sees
+    // the task, or this sees the sleeper
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (sleepers_.load(std::memory_order_relaxed) > 0) {
+        epoch_.fetch_add(1);
+        epoch_.notify_one();
+    }
+}
+
+task_base* work_stealing_pool::take_inbox(worker& from, worker& to) noexcept {
+    auto* head = from.inbox.exchange(nullptr, std::memory_order_acquire);
+    if (head == nullptr) {
+        return nullptr;
+    }
+    // newest first: push all but the oldest, which leaves the next oldest at
+    // the bottom of the deque for `pop()`
+    std::uint64_t count = 1;
+    while (head->next_ != nullptr) {
+        auto* next = head->next_;
+        head->next_ = nullptr;
+        to.deque.push(head);
+        head = next;
+        ++count;
+    }
+    from.inboxTaken.fetch_add(count, std::memory_order_relaxed);
+    if (&from != &to) {
+        detail::bump(to.stolen, count);
+    }
+    if (count > 1) {
+        notify();
+    }
+    return head;
+}
+
+task_base* work_stealing_pool::find(std::size_t index) noexcept {
+    auto& self = *workers_[index];
+    if (auto* task = self.deque.pop()) {
+        return task;
+    }
+    if (auto* task = take_inbox(self, self)) {
+        return task;
+    }
+    for (auto v : self.victims) {
+        auto& victim = *workers_[v];
+        if (victim.deque.size() == 0 &&
+            victim.inbox.load(std::memory_order_relaxed) == nullptr) {
+            continue;
+        }
+        detail::bump(self.stealAttempts);
+        if (auto* task = victim.deque.steal()) {
+            detail::bump(self.stolen);
+            return task;
+        }
+        if (auto* task = take_inbox(victim, self)) {
+            return task;
+        }
+    }
+    return nullptr;
+}
+
+void work_stealing_pool::run(std::size_t index, int cpu) noexcept {
+    if (cpu >= 0) {
+        detail::set_current_thread_cpus({cpu});
+    }
+    currentPool = this;
+    currentWorker = index;
+    auto& self = *workers_[index];
+    for (;;) {
+        auto* task = find(index);
+        if (task == nullptr) {
+            sleepers_.fetch_add(1);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            auto epoch = epoch_.load();
+            task = find(index);
+            if (task == nullptr) {
+                if (stop_.load()) {
+                    sleepers_.fetch_sub(1);
+                    return;
+                }
+                detail::bump(self.parks);
+                epoch_.wait(epoch);
+            }
+            sleepers_.fetch_sub(1);
+            if (task == nullptr) {
+                continue;
+            }
+        }
+        task->execute(true);
+        detail::bump(self.executed);
+    }
+}
+
+worker_pool_stats work_stealing_pool::stats() const {
+    worker_pool_stats s;
+    // executed before submitted: a task is counted submitted before it runs
+    for (auto& w : workers_) {
+        s.executed += w->executed.load(std::memory_order_relaxed);
+        s.stolen += w->stolen.load(std::memory_order_relaxed);
+        s.steal_attempts += w->stealAttempts.load(std::memory_order_relaxed);
+        s.parks += w->parks.load(std::memory_order_relaxed);
+        auto taken = w->inboxTaken.load(std::memory_order_relaxed);
+        auto inboxed = w->inboxed.load(std::memory_order_relaxed);
+        s.depth.push_back(w->deque.size() + (inboxed > taken ? inboxed - taken : 0));
+    }
+    s.submitted = submitted_.load();
+    return s;
+}
+
+}  // namespace agrpc
@@ -0,0 +1,109 @@
+// Producers pushing small events as fast as they can while one consumer
+// drains them in batches: the lock-free rings against `circular_q` behind a
+// mutex.
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <span>
+#include <thread>
+#include <vector>
+#include <async_grpc/circular_q.h>
+#include <async_grpc/concurrent_circular_q.h>
+#include <benchmark/benchmark.h>
+
+namespace {
+
+constexpr std::size_t kCapacity = 4096;
+constexpr std::size_t kBatch = 64;
+
+struct event {
+    std::uint64_t id;
+    std::uint64_t value;
+};
+
+template <class Q>
+struct lock_free {
+    Q q{kCapacity};
+
+    void push(const event& e) { q.push_back(e); }
+    std::size_t pop(std::span<event> out) { return q.pop_n(out).size(); }
+    std::size_t overruns() const { return q.overrun_counter(); }
+};
+
+struct locked {
+    std::mutex mutex;
+    agrpc::circular_q<event> q{kCapacity};
+
+    void push(const event& e) {
+        std::lock_guard lock(mutex);
+        q.push_back(event(e));
+    }
+
+    std::size_t pop(std::span<event> out) {
+        std::lock_guard lock(mutex);
+        std::size_t n = 0;
+        for (; n < out.size() && !q.empty(); ++n) {
+            out[n] = q.front();
+            q.pop_front();
+        }
+        return n;
+    }
+
+    std::size_t overruns() {
+        std::lock_guard lock(mutex);
+        return q.overrun_counter();
+    }
+};
+
+// Items per second are the ones the consumer got, `pushed` the rate of the
+// producers together.
+template <class Ring>
+void BM_ring(benchmark::State& state) {
+    Ring ring;
+    std::atomic<bool> stop{false};
+    std::atomic<std::uint64_t> pushed{0};
+    std::vector<std::thread> producers;
+    for (std::int64_t p = 0; p < state.range(0); ++p) {
+        producers.emplace_back([&]() {
+            event e{0, 0};
+            while (!stop.load(std::memory_order_relaxed)) {
+                ring.push(e);
+                ++e.id;
+            }
+            pushed.fetch_add(e.id);
+        });
+    }
+
+    std::array<event, kBatch> out;
+    std::uint64_t popped = 0;
+    for (auto _ : state) {
+        popped += ring.pop(out);
+    }
+    stop = true;
+    for (auto& th : producers) {
+        th.join();
+    }
+
+    state.SetItemsProcessed(static_cast<std::int64_t>(popped));
+    state.counters["pushed"] =
+        benchmark::Counter(static_cast<double>(pushed.load()), benchmark::Counter::kIsRate);
+    state.counters["overruns"] = static_cast<double>(ring.overruns());
+}
+BENCHMARK_TEMPLATE(BM_ring, lock_free<agrpc::spsc_circular_q<event>>)
+    ->ArgName("producers")
+    ->Arg(1)
+    ->UseRealTime();
+BENCHMARK_TEMPLATE(BM_ring, lock_free<agrpc::mpsc_circular_q<event>>)
+    ->ArgName("producers")
+    ->RangeMultiplier(2)
+    ->Range(1, 8)
+    ->UseRealTime();
+BENCHMARK_TEMPLATE(BM_ring, locked)
+    ->ArgName("producers")
+    ->RangeMultiplier(2)
+    ->Range(1, 8)
+    ->UseRealTime();
+
+}  // namespace
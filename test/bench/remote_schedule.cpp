@@ -0,0 +1,54 @@
+// Handoff from other threads to the io thread: sleeping in the completion
+// queue (woken by an alarm) against spinning before it sleeps.
+#include "running_context.h"
+#include <chrono>
+#include <cstdint>
+#include <async_grpc/grpc_context.h>
+#include <benchmark/benchmark.h>
+#include <unifex/scheduler_concepts.hpp>
+#include <unifex/sync_wait.hpp>
+
+namespace {
+
+agrpc::loop_options spin_options(std::chrono::microseconds spin) {
+    agrpc::loop_options options;
+    options.idle_spin = spin;
+    return options;
+}
+
+// shared by the benchmark threads
+bench::running_context& context_for(std::int64_t spin_us) {
+    static bench::running_context alarm(spin_options(std::chrono::microseconds(0)));
+    static bench::running_context spin(spin_options(std::chrono::microseconds(50)));
+    return spin_us == 0 ? alarm : spin;
+}
+
+// One thread is the round trip latency of a handoff, more threads show how
+// well concurrent handoffs get coalesced.
+void BM_remote_schedule(benchmark::State& state) {
+    auto& rc = context_for(state.range(0));
+    auto sched = rc.ctx.get_scheduler();
+    auto before = rc.ctx.stats();
+
+    for (auto _ : state) {
+        unifex::sync_wait(unifex::schedule(sched));
+    }
+
+    state.SetItemsProcessed(state.iterations());
+    if (state.thread_index() == 0) {
+        auto after = rc.ctx.stats();
+        state.counters["sleeps"] = benchmark::Counter(
+            static_cast<double>(after.sleeps - before.sleeps), benchmark::Counter::kIsRate);
+        state.counters["spin_wakeups"] =
+            benchmark::Counter(static_cast<double>(after.spin_wakeups - before.spin_wakeups),
+                               benchmark::Counter::kIsRate);
+    }
+}
+BENCHMARK(BM_remote_schedule)
+    ->ArgName("idle_spin_us")
+    ->Arg(0)
+    ->Arg(50)
+    ->ThreadRange(1, 8)
+    ->UseRealTime();
+
+}  // namespace
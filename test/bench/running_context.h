@@ -0,0 +1,25 @@
+// A grpc_context running on a thread of its own, for the benchmarks.
+#pragma once
+
+#include <memory>
+#include <thread>
+#include <async_grpc/grpc_context.h>
+#include <grpcpp/grpcpp.h>
+
+namespace bench {
+
+struct running_context {
+    explicit running_context(agrpc::loop_options options = {})
+      : ctx(std::make_unique<grpc::CompletionQueue>(), options)
+      , th([this]() { ctx.run(); }) {}
+
+    ~running_context() {
+        ctx.shutdown();
+        th.join();
+    }
+
+    agrpc::grpc_context ctx;
+    std::thread th;
+};
+
+}  // namespace bench
@@ -0,0 +1,163 @@
+// Hot paths of the scheduler core: the local and remote queue, the
+// completion queue round trip of `async`, and spawning work onto the io
+// thread against the thread pool.
+//
+// For regression tracking run with --benchmark_format=json, or build the
+// async_grpc_tests_bench_json target.
+#include "running_context.h"
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <async_grpc/grpc_context.h>
+#include <async_grpc/grpc_executor.h>
+#include <benchmark/benchmark.h>
+#include <grpc/support/time.h>
+#include <grpcpp/alarm.h>
+#include <grpcpp/grpcpp.h>
+#include <unifex/just_from.hpp>
+#include <unifex/manual_lifetime.hpp>
+#include <unifex/scheduler_concepts.hpp>
+#include <unifex/sender_concepts.hpp>
+#include <unifex/sync_wait.hpp>
+#include <unifex/task.hpp>
+
+namespace {
+
+// items per iteration of the batched benchmarks
+constexpr int kBatch = 64;
+
+bench::running_context& shared_context() {
+    static bench::running_context rc;
+    return rc;
+}
+
+void wait_for(const std::atomic<std::int64_t>& left) {
+    while (left.load(std::memory_order_acquire) != 0) {
+        std::this_thread::yield();
+    }
+}
+
+struct count_receiver {
+    std::atomic<std::int64_t>* left;
+
+    void set_value() && noexcept { left->fetch_sub(1, std::memory_order_release); }
+    void set_error(std::exception_ptr) && noexcept { std::terminate(); }
+    void set_done() && noexcept { left->fetch_sub(1, std::memory_order_release); }
+};
+
+using schedule_op =
+    unifex::connect_result_t<agrpc::grpc_context::schedule_sender, count_receiver>;
+
+// The io thread hopping onto itself through the local queue. The iterations
+// run on the io thread while the benchmark thread waits.
+unifex::task<void> local_hops(agrpc::grpc_context::scheduler sched,
+                              benchmark::State& state) {
+    co_await unifex::schedule(sched);
+    for (auto _ : state) {
+        co_await unifex::schedule(sched);
+    }
+}
+
+void BM_schedule_local(benchmark::State& state) {
+    auto& rc = shared_context();
+    unifex::sync_wait(local_hops(rc.ctx.get_scheduler(), state));
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_schedule_local)->UseRealTime();
+
+// Every producer hands a batch over to the io thread and waits until it
+// ran: the remote queue push, the wakeup if the io thread went to sleep,
+// and collecting the remote queue.
+void BM_schedule_remote(benchmark::State& state) {
+    auto& rc = shared_context();
+    auto sched = rc.ctx.get_scheduler();
+    std::atomic<std::int64_t> left{0};
+    unifex::manual_lifetime<schedule_op> ops[kBatch];
+
+    for (auto _ : state) {
+        left.store(kBatch, std::memory_order_relaxed);
+        for (auto& op : ops) {
+            op.construct_with(
+                [&] { return unifex::connect(sched.schedule(), count_receiver{&left}); });
+        }
+        for (auto& op : ops) {
+            unifex::start(op.get());
+        }
+        wait_for(left);
+        for (auto& op : ops) {
+            op.destruct();
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * kBatch);
+}
+BENCHMARK(BM_schedule_remote)->ThreadRange(1, 8)->UseRealTime();
+
+// `async` with an alarm that is due right away: start the operation, and
+// complete it from the completion queue.
+unifex::task<void> alarm_round_trips(agrpc::grpc_context& ctx, benchmark::State& state) {
+    grpc::Alarm alarm;
+    co_await unifex::schedule(ctx.get_scheduler());
+    for (auto _ : state) {
+        co_await ctx.async([&](grpc::CompletionQueue* cq, void* tag) {
+            alarm.Set(cq, gpr_inf_past(GPR_CLOCK_MONOTONIC), tag);
+        });
+    }
+}
+
+void BM_async_round_trip(benchmark::State& state) {
+    auto& rc = shared_context();
+    unifex::sync_wait(alarm_round_trips(rc.ctx, state));
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_async_round_trip)->UseRealTime();
+
+// The same from a foreign thread, with the hop onto the io thread and back.
+void BM_async_round_trip_remote(benchmark::State& state) {
+    auto& rc = shared_context();
+    grpc::Alarm alarm;
+    for (auto _ : state) {
+        unifex::sync_wait(rc.ctx.async([&](grpc::CompletionQueue* cq, void* tag) {
+            alarm.Set(cq, gpr_inf_past(GPR_CLOCK_MONOTONIC), tag);
+        }));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_async_round_trip_remote)->UseRealTime();
+
+// Spawning a batch of trivial work from a foreign thread, until all of it
+// ran.
+template <bool Blocking>
+void spawn_batches(benchmark::State& state) {
+    agrpc::grpc_executor ex(std::make_unique<grpc::CompletionQueue>(), 2);
+    std::thread th([&]() { ex.run(); });
+    std::atomic<std::int64_t> left{0};
+
+    for (auto _ : state) {
+        left.store(kBatch, std::memory_order_relaxed);
+        for (int i = 0; i < kBatch; ++i) {
+            auto work = unifex::just_from(
+                [&]() noexcept { left.fetch_sub(1, std::memory_order_release); });
+            if constexpr (Blocking) {
+                ex.spawn_blocking(std::move(work));
+            } else {
+                ex.spawn_local(std::move(work));
+            }
+        }
+        wait_for(left);
+    }
+    state.SetItemsProcessed(state.iterations() * kBatch);
+
+    ex.get_grpc_context().shutdown();
+    th.join();
+}
+
+void BM_spawn_local(benchmark::State& state) { spawn_batches<false>(state); }
+BENCHMARK(BM_spawn_local)->UseRealTime();
+
+void BM_spawn_blocking(benchmark::State& state) { spawn_batches<true>(state); }
+BENCHMARK(BM_spawn_blocking)->UseRealTime();
+
+}  // namespace
@@ -0,0 +1,76 @@
+// Blocking work with skewed durations: a batch of short tasks with a few
+// long ones mixed in, handed to the pool from one foreign thread as the io
+// thread does, until all of it ran. With round robin placement the short
+// tasks queued behind a long one wait for it, with stealing they don't.
+//
+// Arguments: threads, and one in how many tasks is long.
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+#include <async_grpc/work_stealing_pool.h>
+#include <benchmark/benchmark.h>
+#include <unifex/async_scope.hpp>
+#include <unifex/scheduler_concepts.hpp>
+#include <unifex/static_thread_pool.hpp>
+#include <unifex/sync_wait.hpp>
+#include <unifex/then.hpp>
+
+namespace {
+
+constexpr int kBatch = 256;
+constexpr auto kShort = std::chrono::microseconds(2);
+constexpr auto kLong = std::chrono::microseconds(500);
+
+void spin_for(std::chrono::nanoseconds d) noexcept {
+    auto end = std::chrono::steady_clock::now() + d;
+    while (std::chrono::steady_clock::now() < end) {
+    }
+}
+
+template <class Pool>
+void run_batches(benchmark::State& state, Pool& pool) {
+    auto every = state.range(1);
+    unifex::async_scope scope;
+    std::atomic<std::int64_t> left{0};
+
+    for (auto _ : state) {
+        left.store(kBatch, std::memory_order_relaxed);
+        for (int i = 0; i < kBatch; ++i) {
+            auto d = every != 0 && i % every == 0 ? std::chrono::nanoseconds(kLong)
+                                                  : std::chrono::nanoseconds(kShort);
+            auto work = [&left, d]() noexcept {
+                spin_for(d);
+                left.fetch_sub(1, std::memory_order_release);
+            };
+            scope.spawn(unifex::then(unifex::schedule(pool.get_scheduler()), work));
+        }
+        while (left.load(std::memory_order_acquire) != 0) {
+            std::this_thread::yield();
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * kBatch);
+    unifex::sync_wait(scope.cleanup());
+}
+
+void BM_skewed_static_thread_pool(benchmark::State& state) {
+    unifex::static_thread_pool pool(static_cast<std::uint32_t>(state.range(0)));
+    run_batches(state, pool);
+}
+BENCHMARK(BM_skewed_static_thread_pool)
+    ->ArgsProduct({{2, 4, 8}, {0, 64, 16}})
+    ->UseRealTime();
+
+void BM_skewed_work_stealing_pool(benchmark::State& state) {
+    agrpc::work_stealing_pool pool({.threads = static_cast<std::size_t>(state.range(0))});
+    run_batches(state, pool);
+    auto stats = pool.stats();
+    state.counters["steal_rate"] = stats.steal_rate();
+    state.counters["parks"] =
+        benchmark::Counter(static_cast<double>(stats.parks), benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_skewed_work_stealing_pool)
+    ->ArgsProduct({{2, 4, 8}, {0, 64, 16}})
+    ->UseRealTime();
+
+}  // namespace
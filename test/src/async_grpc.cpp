@@ -1,16 +1,24 @@
+#include <algorithm>
 #include <chrono>
+#include <optional>
 #include <string>
 #include <thread>
+#include <vector>
 #include <async_grpc/grpc_context.h>
 #include <async_grpc/version.h>
 #include <doctest/doctest.h>
 #include <grpcpp/alarm.h>
 #include <grpcpp/grpcpp.h>
+#include <unifex/async_scope.hpp>
+#include <unifex/done_as_optional.hpp>
 #include <unifex/just_from.hpp>
 #include <unifex/let_value.hpp>
+#include <unifex/scheduler_concepts.hpp>
 #include <unifex/scope_guard.hpp>
+#include <unifex/stop_when.hpp>
 #include <unifex/sync_wait.hpp>
 #include <unifex/task.hpp>
+#include <unifex/then.hpp>
 
 unifex::task<void> timeout(agrpc::grpc_context& ctx, int ms) {
     grpc::Alarm alarm;
@@ -47,5 +55,116 @@ TEST_CASE("grpc context") {
     auto dt = std::chrono::steady_clock::now() - start;
     auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(dt).count();
     std::cout << "run time: " << ms << std::endl;
-    CHECK(abs(ms - 1000) < 3);
-}
\ No newline at end of file
+    // not early, and late by whatever a loaded machine makes it
+    CHECK(ms >= 990);
+    CHECK(ms < 5000);
+}
+
+TEST_CASE("grpc context timer") {
+    grpc::ServerBuilder builder;
+    agrpc::grpc_context ctx(builder.AddCompletionQueue());
+    std::unique_ptr<grpc::Server> server = builder.BuildAndStart();
+
+    unifex::inplace_stop_source stop_source;
+    std::thread th([&]() { ctx.run(stop_source.get_token()); });
+    unifex::scope_guard stop_on_exit = [&]() noexcept {
+        server->Shutdown();
+        stop_source.request_stop();
+        th.join();
+    };
+
+    auto sched = ctx.get_scheduler();
+
+    // schedule_after
+    auto start = std::chrono::steady_clock::now();
+    unifex::sync_wait(unifex::schedule_after(sched, std::chrono::milliseconds(200)));
+    auto dt = std::chrono::steady_clock::now() - start;
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(dt).count();
+    CHECK(ms >= 200);
+
+    // cancelled through the stop token
+    start = std::chrono::steady_clock::now();
+    auto r = unifex::sync_wait(unifex::stop_when(
+        unifex::schedule_after(sched, std::chrono::seconds(10)),
+        unifex::schedule_after(sched, std::chrono::milliseconds(50))));
+    dt = std::chrono::steady_clock::now() - start;
+    ms = std::chrono::duration_cast<std::chrono::milliseconds>(dt).count();
+    CHECK(!r.has_value());
+    // well before the 10s timer, however loaded the machine
+    CHECK(ms < 5000);
+}
+
+TEST_CASE("grpc context shutdown") {
+    grpc::ServerBuilder builder;
+    agrpc::grpc_context ctx(builder.AddCompletionQueue());
+    std::unique_ptr<grpc::Server> server = builder.BuildAndStart();
+
+    // no stop token, `run()` returns once the queue is drained
+    std::thread th([&]() { ctx.run(); });
+
+    unifex::sync_wait(timeout(ctx, 10));
+
+    // a timer still pending at shutdown completes done
+    auto sched = ctx.get_scheduler();
+    unifex::async_scope scope;
+    std::optional<bool> fired;
+    unifex::sync_wait(unifex::then(unifex::schedule(sched), [&]() {
+        scope.spawn(unifex::then(
+            unifex::done_as_optional(unifex::schedule_after(sched, std::chrono::seconds(10))),
+            [&](auto value) { fired = value.has_value(); }));
+    }));
+
+    server->Shutdown();
+    ctx.shutdown();
+    th.join();
+    unifex::sync_wait(scope.cleanup());
+    CHECK(fired == false);
+}
+
+TEST_CASE("grpc context loop budget") {
+    grpc::ServerBuilder builder;
+    agrpc::loop_options options;
+    options.local.events = 4;
+    agrpc::grpc_context ctx(builder.AddCompletionQueue(), options);
+    std::unique_ptr<grpc::Server> server = builder.BuildAndStart();
+
+    unifex::inplace_stop_source stop_source;
+    std::thread th([&]() { ctx.run(stop_source.get_token()); });
+    unifex::scope_guard stop_on_exit = [&]() noexcept {
+        server->Shutdown();
+        stop_source.request_stop();
+        th.join();
+    };
+
+    // From the io thread: a due alarm on the completion queue, an item
+    // handed over by another thread, then a batch of local items 16 times
+    // the budget, all queued at once.
+    constexpr int kBatch = 64;
+    auto sched = ctx.get_scheduler();
+    unifex::async_scope scope;
+    grpc::Alarm alarm;
+    // io thread only
+    std::vector<char> order;
+    unifex::sync_wait(unifex::then(unifex::schedule(sched), [&]() {
+        scope.spawn(unifex::then(
+            ctx.async([&](grpc::CompletionQueue* cq, void* tag) {
+                alarm.Set(cq, gpr_inf_past(GPR_CLOCK_MONOTONIC), tag);
+            }),
+            [&](bool) { order.push_back('c'); }));
+        std::thread([&]() {
+            scope.spawn(unifex::then(unifex::schedule(sched), [&]() { order.push_back('r'); }));
+        }).join();
+        for (int i = 0; i < kBatch; ++i) {
+            scope.spawn(unifex::then(unifex::schedule(sched), [&]() { order.push_back('l'); }));
+        }
+    }));
+    unifex::sync_wait(scope.cleanup());
+
+    auto stats = ctx.stats();
+    CHECK(stats.local_exhausted > 0);
+    REQUIRE(order.size() == kBatch + 2);
+    // neither waited for the whole batch
+    auto last_local = order.rend() - std::find(order.rbegin(), order.rend(), 'l') - 1;
+    CHECK(std::find(order.begin(), order.end(), 'c') - order.begin() < last_local);
+    CHECK(std::find(order.begin(), order.end(), 'r') - order.begin() < last_local);
+}
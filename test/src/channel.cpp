@@ -0,0 +1,70 @@
+#include <algorithm>
+#include <memory>
+#include <optional>
+#include <thread>
+#include <vector>
+#include <async_grpc/channel.h>
+#include <async_grpc/grpc_context.h>
+#include <doctest/doctest.h>
+#include <grpcpp/grpcpp.h>
+#include <unifex/done_as_optional.hpp>
+#include <unifex/scheduler_concepts.hpp>
+#include <unifex/scope_guard.hpp>
+#include <unifex/stream_concepts.hpp>
+#include <unifex/sync_wait.hpp>
+#include <unifex/task.hpp>
+
+unifex::task<std::vector<int>> drain(agrpc::grpc_context& ctx, agrpc::channel<int>& ch) {
+    co_await unifex::schedule(ctx.get_scheduler());
+    std::vector<int> items;
+    while (auto item = co_await unifex::done_as_optional(unifex::next(ch))) {
+        items.push_back(*item);
+    }
+    co_return items;
+}
+
+TEST_CASE("channel") {
+    agrpc::grpc_context ctx(std::make_unique<grpc::CompletionQueue>());
+    unifex::inplace_stop_source stop_source;
+    std::thread th([&]() { ctx.run(stop_source.get_token()); });
+    unifex::scope_guard stop_on_exit = [&]() noexcept {
+        stop_source.request_stop();
+        th.join();
+    };
+
+    // a small channel, the producers spend most of the time suspended
+    constexpr int kProducers = 2;
+    constexpr int kItems = 10000;
+    agrpc::channel<int> ch(ctx, 8);
+    std::vector<std::thread> producers;
+    std::vector<int> failed(kProducers, 0);
+    for (int p = 0; p < kProducers; p++) {
+        producers.emplace_back([&, p]() {
+            for (int i = 0; i < kItems; i++) {
+                failed[p] += !ch.send_blocking(p * kItems + i);
+            }
+        });
+    }
+    std::thread closer([&]() {
+        for (auto& producer : producers) {
+            producer.join();
+        }
+        ch.close();
+    });
+
+    auto items = unifex::sync_wait(drain(ctx, ch));
+    closer.join();
+
+    REQUIRE(items.has_value());
+    CHECK(items->size() == kProducers * kItems);
+    CHECK(std::count(failed.begin(), failed.end(), 0) == kProducers);
+    // in order per producer
+    std::vector<int> next(kProducers, 0);
+    bool ordered = true;
+    for (int item : *items) {
+        int p = item / kItems;
+        ordered = ordered && item % kItems == next[p]++;
+    }
+    CHECK(ordered);
+    CHECK(!ch.send_blocking(0));
+}
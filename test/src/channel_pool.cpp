@@ -0,0 +1,86 @@
+#include <chrono>
+#include <vector>
+#include <async_grpc/channel_pool.h>
+#include <doctest/doctest.h>
+#include <grpcpp/security/credentials.h>
+
+TEST_CASE("channel pool picks the least busy channel") {
+    agrpc::channel_pool pool("127.0.0.1:1", grpc::InsecureChannelCredentials(), {.size = 3});
+    REQUIRE(pool.size() == 3);
+    CHECK(pool.channel(0) != pool.channel(1));
+
+    // one call on each before any gets a second one
+    std::vector<agrpc::channel_pool::lease> leases;
+    std::vector<int> per_channel(3);
+    for (int i = 0; i < 6; i++) {
+        leases.push_back(pool.pick());
+        per_channel[leases.back().index()]++;
+        if (i == 2) {
+            CHECK(per_channel == std::vector<int>{1, 1, 1});
+        }
+    }
+    CHECK(per_channel == std::vector<int>{2, 2, 2});
+
+    // channel 1 frees up
+    for (auto& l : leases) {
+        if (l.index() == 1) {
+            l.done(std::chrono::milliseconds(1), true);
+        }
+    }
+    CHECK(pool.pick().index() == 1);
+    CHECK(pool.stats().channels[1].calls == 2);
+    CHECK(pool.stats().channels[0].inflight == 2);
+}
+
+TEST_CASE("channel pool ejects latency outliers") {
+    using namespace std::chrono_literals;
+    agrpc::channel_pool pool("127.0.0.1:1",
+                             grpc::InsecureChannelCredentials(),
+                             {.size = 4, .check_interval = 0s, .max_ejected = 0.25});
+    auto complete = [&](std::size_t index, std::chrono::nanoseconds latency) {
+        for (;;) {
+            auto l = pool.pick();
+            if (l.index() == index) {
+                l.done(latency, true);
+                return;
+            }
+        }
+    };
+    for (std::size_t i = 0; i < 4; i++) {
+        complete(i, i == 2 ? 100ms : 2ms);
+    }
+    auto stats = pool.stats();
+    CHECK(stats.ejections == 1);
+    CHECK(stats.channels[2].ejected);
+
+    // no more than a quarter of the pool at a time
+    complete(0, 100ms);
+    CHECK(pool.stats().ejections == 1);
+    for (int i = 0; i < 100; i++) {
+        CHECK(pool.pick().index() != 2);
+    }
+}
+
+TEST_CASE("channel pool ejects failing channels") {
+    using namespace std::chrono_literals;
+    agrpc::channel_pool pool("127.0.0.1:1",
+                             grpc::InsecureChannelCredentials(),
+                             {.size = 4, .check_interval = 0s, .max_ejected = 0.25});
+    // failed calls, without a latency to go by, until the channel is out
+    int failed = 0;
+    while (failed < 100 && !pool.stats().channels[2].ejected) {
+        auto l = pool.pick();
+        if (l.index() == 2) {
+            l.done(false);
+            failed++;
+        }
+    }
+    auto stats = pool.stats();
+    CHECK(stats.ejections == 1);
+    CHECK(stats.channels[2].ejected);
+    CHECK(failed < 10);
+    CHECK(stats.channels[0].error_rate == 0);
+    for (int i = 0; i < 100; i++) {
+        CHECK(pool.pick().index() != 2);
+    }
+}
@@ -0,0 +1,110 @@
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <async_grpc/client_cache.h>
+#include <async_grpc/rpcs.h>
+#include <doctest/doctest.h>
+#include <unifex/sync_wait.hpp>
+#include <unifex/task.hpp>
+#include "stream_service.h"
+
+using lookup_result = agrpc::client_cache::lookup_result;
+
+TEST_CASE("client cache single flight") {
+    agrpc::client_cache cache({});
+    auto key = agrpc::client_cache::key_of("method", "request");
+
+    CHECK(cache.lookup(key).state == lookup_result::miss);
+    auto leader = cache.join(key);
+    auto follower = cache.join(key);
+    CHECK(leader.leader);
+    CHECK(!follower.leader);
+    CHECK(leader.call == follower.call);
+    CHECK(!follower.call->done.ready());
+
+    cache.land(key, leader.call, nullptr, "reply");
+    CHECK(follower.call->done.ready());
+    CHECK(follower.call->reply == "reply");
+
+    auto hit = cache.lookup(key);
+    CHECK(hit.state == lookup_result::fresh);
+    CHECK(hit.reply == "reply");
+    // another method, or another request
+    CHECK(cache.lookup(agrpc::client_cache::key_of("method2", "request")).state ==
+          lookup_result::miss);
+    CHECK(cache.lookup(agrpc::client_cache::key_of("method", "request2")).state ==
+          lookup_result::miss);
+
+    // errors are shared, not cached
+    auto other = agrpc::client_cache::key_of("method", "other");
+    auto failed = cache.join(other);
+    cache.land(other, failed.call, std::make_exception_ptr(std::runtime_error("x")), {});
+    CHECK(failed.call->error);
+    CHECK(cache.lookup(other).state == lookup_result::miss);
+
+    auto stats = cache.stats();
+    CHECK(stats.hits == 1);
+    CHECK(stats.misses == 4);
+    CHECK(stats.coalesced == 1);
+    CHECK(stats.entries == 1);
+}
+
+TEST_CASE("client cache stale while revalidate") {
+    using namespace std::chrono_literals;
+    agrpc::client_cache cache({.ttl = 0s, .stale = 1h});
+    auto key = agrpc::client_cache::key_of("method", "request");
+    cache.land(key, cache.join(key).call, nullptr, "v1");
+
+    auto hit = cache.lookup(key);
+    CHECK(hit.state == lookup_result::stale);
+    CHECK(hit.reply == "v1");
+    CHECK(hit.refresh);
+    // one refresh at a time
+    CHECK(!cache.lookup(key).refresh);
+
+    // a failed refresh keeps the stale reply, the next hit tries again
+    cache.land(key, cache.join(key).call, std::make_exception_ptr(std::runtime_error("x")), {});
+    CHECK(cache.lookup(key).refresh);
+    cache.land(key, cache.join(key).call, nullptr, "v2");
+    CHECK(cache.lookup(key).reply == "v2");
+    CHECK(cache.stats().stale_hits == 4);
+}
+
+TEST_CASE("client cache keeps stubs apart") {
+    using namespace std::chrono_literals;
+    std::atomic<int> served{0};
+    streams::server server([&](agrpc::grpc_executor& ex, streams::service* svc) {
+        ex.spawn_local(agrpc::async_call_data<streams::message, streams::message>(
+            ex,
+            &streams::service::RequestGet,
+            svc,
+            [&](const grpc::ServerContext&,
+                const streams::message& request,
+                streams::message& reply) -> unifex::task<bool> {
+                reply = streams::message_of(request.value() + std::to_string(++served));
+                co_return true;
+            }));
+    });
+
+    agrpc::client_cache cache({.ttl = 1h});
+    agrpc::client_options options;
+    options.cache = &cache;
+    auto get = [&](streams::stub& stub) {
+        auto r = unifex::sync_wait(agrpc::async_client_call<streams::message>(
+            *server.ex, &streams::stub::AsyncGet, &stub, streams::message_of("a"), options));
+        REQUIRE(r);
+        REQUIRE(r->has_value());
+        return r->value().value();
+    };
+
+    // e.g. two targets, each with replies of its own
+    streams::stub first(server.channel());
+    streams::stub second(server.channel());
+    CHECK(get(first) == "a1");
+    CHECK(get(first) == "a1");
+    CHECK(get(second) == "a2");
+    CHECK(get(second) == "a2");
+    CHECK(served == 2);
+    CHECK(cache.stats().hits == 2);
+}
@@ -0,0 +1,134 @@
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include <async_grpc/concurrency_limiter.h>
+#include <async_grpc/rpcs.h>
+#include <doctest/doctest.h>
+#include <unifex/async_manual_reset_event.hpp>
+#include <unifex/scheduler_concepts.hpp>
+#include <unifex/sync_wait.hpp>
+#include <unifex/task.hpp>
+#include "stream_service.h"
+
+namespace {
+bool acquire(agrpc::concurrency_limiter& limiter) {
+    return unifex::sync_wait(limiter.acquire()).value_or(false);
+}
+}  // namespace
+
+TEST_CASE("concurrency limiter rejects beyond the limit") {
+    agrpc::concurrency_limiter::options options;
+    options.limit = 2;
+    agrpc::concurrency_limiter limiter(options);
+
+    CHECK(acquire(limiter));
+    CHECK(acquire(limiter));
+    CHECK(!acquire(limiter));
+    limiter.release(std::chrono::milliseconds(1), true);
+    CHECK(acquire(limiter));
+
+    auto stats = limiter.stats();
+    CHECK(stats.limit == 2);
+    CHECK(stats.inflight == 2);
+    CHECK(stats.admitted == 3);
+    CHECK(stats.rejected == 1);
+}
+
+TEST_CASE("concurrency limiter aimd") {
+    using namespace std::chrono_literals;
+    agrpc::concurrency_limiter::options options;
+    options.mode = agrpc::concurrency_limiter::limit_mode::aimd;
+    options.limit = 10;
+    options.latency_target = 10ms;
+    agrpc::concurrency_limiter limiter(options);
+
+    for (int i = 0; i < 10; i++) {
+        REQUIRE(acquire(limiter));
+    }
+    // fast calls at the limit grow it by about one per round
+    for (int i = 0; i < 12; i++) {
+        limiter.release(1ms, true);
+        REQUIRE(acquire(limiter));
+    }
+    CHECK(limiter.stats().limit == 11);
+
+    // slow ones back off
+    for (int i = 0; i < 5; i++) {
+        limiter.release(100ms, true);
+    }
+    CHECK(limiter.stats().limit == 6);
+}
+
+TEST_CASE("concurrency limiter gradient") {
+    using namespace std::chrono_literals;
+    agrpc::concurrency_limiter::options options;
+    options.mode = agrpc::concurrency_limiter::limit_mode::gradient;
+    options.limit = 20;
+    options.queue = 0;
+    agrpc::concurrency_limiter limiter(options);
+
+    for (int i = 0; i < 20; i++) {
+        REQUIRE(acquire(limiter));
+    }
+    for (int i = 0; i < 200; i++) {
+        limiter.release(1ms, true);
+        acquire(limiter);
+    }
+    auto grown = limiter.stats().limit;
+    CHECK(grown > 20);
+
+    // the latency went up, the limit comes down
+    for (int i = 0; i < 200; i++) {
+        limiter.release(20ms, true);
+        acquire(limiter);
+    }
+    CHECK(limiter.stats().limit < grown);
+}
+
+TEST_CASE("concurrency limiter turns calls away") {
+    agrpc::concurrency_limiter::options options;
+    options.limit = 1;
+    agrpc::concurrency_limiter limiter(options);
+    std::atomic<bool> entered{false};
+    unifex::async_manual_reset_event gate;
+    streams::server server([&](agrpc::grpc_executor& ex, streams::service* svc) {
+        ex.spawn_local(agrpc::async_call_data<streams::message, streams::message>(
+            ex,
+            &streams::service::RequestGet,
+            svc,
+            [&](const grpc::ServerContext&,
+                const streams::message& request,
+                streams::message& reply) -> unifex::task<bool> {
+                entered = true;
+                co_await gate.async_wait();
+                co_await unifex::schedule(ex.get_grpc_scheduler());
+                reply = request;
+                co_return true;
+            },
+            {.concurrency = 2, .call_limiter = &limiter}));
+    });
+    grpc::GenericStub stub(server.channel());
+
+    // the first one holds the only slot until the gate opens
+    streams::result first;
+    std::thread th([&]() {
+        grpc::ClientContext context;
+        first = streams::call(stub, context, streams::get_method, {"a"});
+    });
+    while (!entered) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    {
+        grpc::ClientContext context;
+        auto r = streams::call(stub, context, streams::get_method, {"b"});
+        CHECK(r.status.error_code() == grpc::StatusCode::RESOURCE_EXHAUSTED);
+    }
+    gate.set();
+    th.join();
+    CHECK(first.status.ok());
+    CHECK(first.replies == std::vector<std::string>{"a"});
+    CHECK(limiter.stats().rejected == 1);
+    CHECK(limiter.stats().inflight == 0);
+}
@@ -0,0 +1,78 @@
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+#include <async_grpc/concurrent_circular_q.h>
+#include <doctest/doctest.h>
+
+TEST_CASE("concurrent circular q overwrites the oldest") {
+    agrpc::spsc_circular_q<int> q(3);
+    CHECK(q.capacity() == 4);
+    CHECK(q.empty());
+
+    for (int i = 0; i < 6; i++) {
+        q.push_back(i);
+    }
+    CHECK(q.size() == 4);
+
+    std::array<int, 8> out{};
+    auto got = q.pop_n(out);
+    REQUIRE(got.size() == 4);
+    CHECK(got[0] == 2);
+    CHECK(got[3] == 5);
+    CHECK(q.overrun_counter() == 2);
+    CHECK(q.empty());
+
+    int item = 0;
+    CHECK(!q.pop_front(item));
+    std::array<int, 6> in{10, 11, 12, 13, 14, 15};
+    q.push_n(in);
+    CHECK(q.pop_front(item));
+    CHECK(item == 12);
+    CHECK(q.overrun_counter() == 4);
+}
+
+TEST_CASE("concurrent circular q with many producers") {
+    constexpr int kProducers = 4;
+    constexpr std::uint32_t kItems = 100000;
+    struct item {
+        std::uint32_t producer;
+        std::uint32_t seq;
+    };
+    agrpc::mpsc_circular_q<item> q(256);
+
+    std::atomic<int> running{kProducers};
+    std::vector<std::thread> producers;
+    for (int p = 0; p < kProducers; p++) {
+        producers.emplace_back([&, p]() {
+            for (std::uint32_t i = 0; i < kItems; i += 2) {
+                std::array<item, 2> batch{item{std::uint32_t(p), i}, item{std::uint32_t(p), i + 1}};
+                q.push_n(batch);
+            }
+            running.fetch_sub(1);
+        });
+    }
+
+    // items of a producer come out in order, nothing lost but overruns
+    std::array<std::uint32_t, kProducers> next{};
+    std::uint64_t popped = 0;
+    bool ordered = true;
+    std::array<item, 32> out;
+    for (;;) {
+        bool done = running.load() == 0;
+        for (auto& it : q.pop_n(out)) {
+            ordered = ordered && it.seq >= next[it.producer];
+            next[it.producer] = it.seq + 1;
+            popped++;
+        }
+        if (done && q.empty()) {
+            break;
+        }
+    }
+    for (auto& th : producers) {
+        th.join();
+    }
+    CHECK(ordered);
+    CHECK(popped + q.overrun_counter() == std::uint64_t(kProducers) * kItems);
+}
@@ -0,0 +1,42 @@
+#include <string>
+#include <async_grpc/generic_server.h>
+#include <doctest/doctest.h>
+#include <unifex/sync_wait.hpp>
+
+namespace {
+
+agrpc::generic_handler status_of(grpc::StatusCode code) {
+    return [code](grpc::GenericServerContext&,
+                  const grpc::ByteBuffer&,
+                  grpc::ByteBuffer&) -> unifex::task<grpc::Status> {
+        co_return grpc::Status(code, "");
+    };
+}
+
+grpc::StatusCode routed(const agrpc::generic_router& router, std::string method) {
+    auto* handler = router.route(method);
+    if (handler == nullptr) {
+        return grpc::StatusCode::UNIMPLEMENTED;
+    }
+    grpc::GenericServerContext context;
+    grpc::ByteBuffer request, reply;
+    return unifex::sync_wait((*handler)(context, request, reply))->error_code();
+}
+
+}  // namespace
+
+TEST_CASE("generic router") {
+    agrpc::generic_router router;
+    router.add("/pkg.Svc/Get", status_of(grpc::StatusCode::OK));
+    router.add_prefix("/pkg.", status_of(grpc::StatusCode::NOT_FOUND));
+    router.add_prefix("/pkg.Svc/", status_of(grpc::StatusCode::ABORTED));
+
+    CHECK(routed(router, "/pkg.Svc/Get") == grpc::StatusCode::OK);
+    // longest prefix first
+    CHECK(routed(router, "/pkg.Svc/Put") == grpc::StatusCode::ABORTED);
+    CHECK(routed(router, "/pkg.Other/Get") == grpc::StatusCode::NOT_FOUND);
+    CHECK(routed(router, "/other.Svc/Get") == grpc::StatusCode::UNIMPLEMENTED);
+
+    router.set_fallback(status_of(grpc::StatusCode::UNAVAILABLE));
+    CHECK(routed(router, "/other.Svc/Get") == grpc::StatusCode::UNAVAILABLE);
+}
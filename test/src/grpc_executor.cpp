@@ -0,0 +1,75 @@
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <async_grpc/grpc_executor.h>
+#include <async_grpc/rpcs.h>
+#include <doctest/doctest.h>
+#include <grpcpp/grpcpp.h>
+#include <unifex/scheduler_concepts.hpp>
+#include <unifex/task.hpp>
+#include "stream_service.h"
+
+TEST_CASE("grpc executor drain") {
+    using namespace std::chrono_literals;
+    using streams::message;
+    streams::service svc;
+    int port = 0;
+    grpc::ServerBuilder builder;
+    builder.AddListeningPort("127.0.0.1:0", grpc::InsecureServerCredentials(), &port);
+    builder.RegisterService(&svc);
+    agrpc::grpc_executor ex(builder.AddCompletionQueue(), 1);
+    auto server = builder.BuildAndStart();
+
+    // both return once the drain started, "overrun" well past its deadline
+    std::atomic<int> entered{0};
+    ex.spawn_local(agrpc::async_call_data<message, message>(
+        ex,
+        &streams::service::RequestGet,
+        &svc,
+        [&](const grpc::ServerContext&,
+            const message& request,
+            message& reply) -> unifex::task<bool> {
+            ++entered;
+            auto sched = ex.get_grpc_scheduler();
+            while (!ex.draining()) {
+                co_await unifex::schedule_after(sched, 5ms);
+            }
+            if (request.value() == "overrun") {
+                co_await unifex::schedule_after(sched, 1s);
+            }
+            reply = request;
+            co_return true;
+        },
+        {.concurrency = 2}));
+    std::thread th([&]() { ex.run(); });
+
+    auto channel = grpc::CreateChannel("127.0.0.1:" + std::to_string(port),
+                                       grpc::InsecureChannelCredentials());
+    grpc::GenericStub stub(channel);
+    streams::result finished, overrun;
+    std::thread finish_call([&]() {
+        grpc::ClientContext context;
+        finished = streams::call(stub, context, streams::get_method, {"finish"});
+    });
+    std::thread overrun_call([&]() {
+        grpc::ClientContext context;
+        overrun = streams::call(stub, context, streams::get_method, {"overrun"});
+    });
+    while (entered < 2) {
+        std::this_thread::sleep_for(1ms);
+    }
+
+    auto stats = ex.drain(*server, std::chrono::system_clock::now() + 300ms);
+    th.join();
+    finish_call.join();
+    overrun_call.join();
+
+    CHECK(stats.completed == 1);
+    CHECK(stats.cancelled == 1);
+    CHECK(finished.status.ok());
+    CHECK(finished.replies == std::vector<std::string>{"finish"});
+    CHECK(!overrun.status.ok());
+}
@@ -0,0 +1,157 @@
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+#include <async_grpc/grpc_sharded_executor.h>
+#include <async_grpc/rpcs.h>
+#include <doctest/doctest.h>
+#include <grpcpp/grpcpp.h>
+#include <unifex/just.hpp>
+#include <unifex/scheduler_concepts.hpp>
+#include <unifex/sync_wait.hpp>
+#include <unifex/task.hpp>
+#include <unifex/then.hpp>
+#include "stream_service.h"
+
+using namespace std::chrono_literals;
+
+TEST_CASE("sharded executor picks the calling shard") {
+    grpc::ServerBuilder builder;
+    agrpc::grpc_sharded_executor ex(builder, 3, 1);
+    auto server = builder.BuildAndStart();
+
+    // shard 0 runs here, on a thread that must keep its cpus
+    auto cpus = agrpc::detail::allowed_cpus();
+    std::vector<std::vector<int>> pinned(ex.size());
+    unifex::inplace_stop_source stop_source;
+    std::thread th([&]() {
+        ex.run(stop_source.get_token(), true);
+        CHECK(agrpc::detail::allowed_cpus() == cpus);
+    });
+
+    // round robin from elsewhere
+    CHECK(ex.current_shard() == nullptr);
+    std::set<agrpc::grpc_executor*> picked;
+    for (std::size_t i = 0; i < ex.size(); i++) {
+        picked.insert(&ex.pick());
+    }
+    CHECK(picked.size() == ex.size());
+
+    // the shard of the io thread, which is pinned to one of the allowed cpus
+    for (std::size_t i = 0; i < ex.size(); i++) {
+        auto& shard = ex.shard(i);
+        auto on_shard = unifex::schedule(shard.get_grpc_scheduler());
+        auto r = unifex::sync_wait(unifex::then(std::move(on_shard), [&]() {
+            pinned[i] = agrpc::detail::allowed_cpus();
+            return ex.current_shard() == &shard && &ex.pick() == &shard;
+        }));
+        CHECK(r.value_or(false));
+        if (!cpus.empty()) {
+            REQUIRE(pinned[i].size() == 1);
+            CHECK(pinned[i][0] == cpus[i % cpus.size()]);
+        }
+    }
+
+    server->Shutdown();
+    stop_source.request_stop();
+    th.join();
+}
+
+TEST_CASE("sharded executor drains every shard") {
+    streams::service svc;
+    int port = 0;
+    grpc::ServerBuilder builder;
+    builder.AddListeningPort("127.0.0.1:0", grpc::InsecureServerCredentials(), &port);
+    builder.RegisterService(&svc);
+    agrpc::grpc_sharded_executor ex(builder, 2, 1, false);
+    auto server = builder.BuildAndStart();
+
+    // calls get their reply once the drain started
+    std::atomic<int> entered{0};
+    ex.for_each_shard([&](agrpc::grpc_executor& shard) {
+        shard.spawn_local(agrpc::async_call_data<streams::message, streams::message>(
+            shard,
+            &streams::service::RequestGet,
+            &svc,
+            [&entered, &shard = shard](const grpc::ServerContext&,
+                                       const streams::message& request,
+                                       streams::message& reply) -> unifex::task<bool> {
+                ++entered;
+                while (!shard.draining()) {
+                    co_await unifex::schedule_after(shard.get_grpc_scheduler(), 5ms);
+                }
+                reply = request;
+                co_return true;
+            },
+            {.concurrency = 4}));
+    });
+    std::thread th([&]() { ex.run(); });
+
+    auto channel = grpc::CreateChannel("127.0.0.1:" + std::to_string(port),
+                                       grpc::InsecureChannelCredentials());
+    grpc::GenericStub stub(channel);
+    std::vector<streams::result> results(4);
+    std::vector<std::thread> clients;
+    for (std::size_t i = 0; i < results.size(); i++) {
+        clients.emplace_back([&, i]() {
+            grpc::ClientContext context;
+            results[i] = streams::call(stub, context, streams::get_method, {std::to_string(i)});
+        });
+    }
+    while (entered < 4) {
+        std::this_thread::sleep_for(1ms);
+    }
+
+    auto metrics = ex.metrics();
+    CHECK(metrics.calls_inflight == 4);
+
+    auto stats = ex.drain(*server, std::chrono::system_clock::now() + 10s);
+    for (auto& client : clients) {
+        client.join();
+    }
+    th.join();
+    CHECK(stats.completed == 4);
+    CHECK(stats.cancelled == 0);
+    for (std::size_t i = 0; i < results.size(); i++) {
+        CHECK(results[i].status.ok());
+        CHECK(results[i].replies == std::vector<std::string>{std::to_string(i)});
+    }
+}
+
+TEST_CASE("sharded executor metrics sum the shards") {
+    grpc::ServerBuilder builder;
+    agrpc::grpc_sharded_executor ex(builder, 3, 2, false);
+    auto server = builder.BuildAndStart();
+    unifex::inplace_stop_source stop_source;
+    std::thread th([&]() { ex.run(stop_source.get_token()); });
+
+    // blocking work submitted through every shard, 1 + 2 + 3 of it
+    std::atomic<int> done{0};
+    for (std::size_t i = 0; i < ex.size(); i++) {
+        for (std::size_t j = 0; j <= i; j++) {
+            ex.shard(i).spawn_blocking(unifex::then(unifex::just(), [&]() noexcept { ++done; }));
+        }
+    }
+    while (done < 6) {
+        std::this_thread::sleep_for(1ms);
+    }
+
+    auto metrics = ex.metrics();
+    CHECK(metrics.pool_submitted == 6);
+    CHECK(metrics.pool_started == 6);
+    CHECK(metrics.pool_backlog() == 0);
+    CHECK(metrics.calls_inflight == 0);
+    for (std::size_t i = 0; i < ex.size(); i++) {
+        CHECK(ex.shard(i).metrics().pool_submitted == i + 1);
+    }
+    // one pool for all shards, counted once
+    CHECK(metrics.pool.submitted == 6);
+    CHECK(metrics.pool.depth.size() == 2);
+
+    server->Shutdown();
+    stop_source.request_stop();
+    th.join();
+}
@@ -0,0 +1,44 @@
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <async_grpc/method_stats.h>
+#include <doctest/doctest.h>
+
+TEST_CASE("method stats") {
+    agrpc::stats_registry registry;
+    auto& stats = registry.get("/helloworld.Greeter/SayHello");
+    CHECK(&registry.get("/helloworld.Greeter/SayHello") == &stats);
+
+    // shards of all threads get merged
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&]() {
+            for (int i = 1; i <= 100; ++i) {
+                stats.record(agrpc::method_stats::handler, std::chrono::microseconds(i));
+            }
+        });
+    }
+    for (auto& th : threads) {
+        th.join();
+    }
+    stats.record(agrpc::method_stats::client, std::chrono::milliseconds(1));
+
+    auto s = stats.snapshot();
+    CHECK(s[agrpc::method_stats::handler].count == 400);
+    CHECK(s[agrpc::method_stats::handler].max == 100000);
+    CHECK(s[agrpc::method_stats::handler].percentile(0.5) >= 50000);
+    CHECK(s[agrpc::method_stats::handler].percentile(0.5) <= 54000);
+    CHECK(s[agrpc::method_stats::client].count == 1);
+    CHECK(s[agrpc::method_stats::queue].count == 0);
+
+    auto path = std::string("method_stats_test.jsonl");
+    CHECK(registry.dump(path));
+    std::ifstream in(path);
+    std::string line;
+    std::getline(in, line);
+    CHECK(line.find(R"("method":"/helloworld.Greeter/SayHello")") != std::string::npos);
+    std::remove(path.c_str());
+}
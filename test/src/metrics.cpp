@@ -0,0 +1,79 @@
+#include <cstdint>
+#include <thread>
+#include <vector>
+#include <async_grpc/metrics.h>
+#include <doctest/doctest.h>
+
+TEST_CASE("histogram buckets") {
+    using agrpc::histogram;
+    // exact below 32, then within 1/16
+    for (std::uint64_t v = 0; v < 32; ++v) {
+        auto i = histogram::bucket_of(v);
+        CHECK(histogram::bucket_lower(i) == v);
+        CHECK(histogram::bucket_upper(i) == v);
+    }
+    for (std::uint64_t v : {100ull, 4095ull, 4096ull, 123456789ull, ~0ull}) {
+        auto i = histogram::bucket_of(v);
+        CHECK(i < histogram::kBuckets);
+        CHECK(histogram::bucket_lower(i) <= v);
+        CHECK(histogram::bucket_upper(i) >= v);
+        CHECK(histogram::bucket_upper(i) - histogram::bucket_lower(i) <= v / 16);
+    }
+    // adjacent buckets leave no gaps
+    for (std::size_t i = 1; i < histogram::kBuckets; ++i) {
+        CHECK(histogram::bucket_lower(i) == histogram::bucket_upper(i - 1) + 1);
+    }
+}
+
+TEST_CASE("histogram percentiles") {
+    agrpc::histogram a;
+    agrpc::histogram b;
+    for (std::uint64_t v = 1; v <= 1000; ++v) {
+        (v % 2 ? a : b).record(v * 1000);
+    }
+
+    auto s = a.snapshot();
+    s.merge(b.snapshot());
+    CHECK(s.count == 1000);
+    CHECK(s.max == 1000000);
+    CHECK(s.mean() == doctest::Approx(500500.0));
+    CHECK(s.percentile(0.5) >= 500000);
+    CHECK(s.percentile(0.5) <= 500000 + 500000 / 16);
+    CHECK(s.percentile(0.99) >= 990000);
+    CHECK(s.percentile(1.0) == 1000000);
+    CHECK(agrpc::histogram_snapshot{}.percentile(0.5) == 0);
+}
+
+TEST_CASE("sharded counter") {
+    agrpc::sharded_counter counter;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 8; ++t) {
+        threads.emplace_back([&]() {
+            for (int i = 0; i < 10000; ++i) {
+                counter.add();
+            }
+        });
+    }
+    for (auto& th : threads) {
+        th.join();
+    }
+    CHECK(counter.load() == 80000);
+}
+
+TEST_CASE("backlogs of counters read one by one") {
+    agrpc::executor_metrics m;
+    m.pool_submitted = 5;
+    m.pool_started = 7;
+    CHECK(m.pool_backlog() == 0);
+    m.pool_submitted = 9;
+    CHECK(m.pool_backlog() == 2);
+
+    m.loop.local_scheduled = 3;
+    m.loop.local_events = 4;
+    m.loop.remote_scheduled = 1;
+    m.loop.remote_events = 2;
+    CHECK(m.loop.local_depth() == 0);
+    CHECK(m.loop.remote_depth() == 0);
+    m.loop.remote_scheduled = 5;
+    CHECK(m.loop.remote_depth() == 3);
+}
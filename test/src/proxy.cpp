@@ -0,0 +1,241 @@
+#include <chrono>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include <async_grpc/generic_server.h>
+#include <async_grpc/grpc_executor.h>
+#include <async_grpc/proxy.h>
+#include <doctest/doctest.h>
+#include <grpcpp/generic/async_generic_service.h>
+#include <grpcpp/generic/generic_stub.h>
+#include <grpcpp/grpcpp.h>
+#include <unifex/just_done.hpp>
+#include <unifex/task.hpp>
+#include "stream_service.h"
+
+namespace {
+
+grpc::ByteBuffer buffer_of(std::string_view s) {
+    grpc::Slice slice(s.data(), s.size());
+    return grpc::ByteBuffer(&slice, 1);
+}
+
+std::string string_of(const grpc::ByteBuffer& buffer) {
+    std::vector<grpc::Slice> slices;
+    std::string s;
+    if (buffer.Dump(&slices).ok()) {
+        for (auto& slice : slices) {
+            s.append(reinterpret_cast<const char*>(slice.begin()), slice.size());
+        }
+    }
+    return s;
+}
+
+std::string value_of(const std::multimap<grpc::string_ref, grpc::string_ref>& metadata,
+                     std::string_view key) {
+    auto it = metadata.find(grpc::string_ref(key.data(), key.size()));
+    return it == metadata.end() ? "" : std::string(it->second.data(), it->second.size());
+}
+
+// A generic service on a local port, served on its own executor thread and
+// drained on destruction.
+struct test_server {
+    grpc::AsyncGenericService svc;
+    int port = 0;
+    std::unique_ptr<agrpc::grpc_executor> ex;
+    std::unique_ptr<grpc::Server> server;
+    std::thread th;
+
+    template <class Serve>
+    explicit test_server(Serve serve) {
+        grpc::ServerBuilder builder;
+        builder.AddListeningPort("127.0.0.1:0", grpc::InsecureServerCredentials(), &port);
+        builder.RegisterAsyncGenericService(&svc);
+        ex = std::make_unique<agrpc::grpc_executor>(builder.AddCompletionQueue(), 1);
+        server = builder.BuildAndStart();
+        ex->spawn_local(serve(*ex, &svc));
+        th = std::thread([this]() { ex->run(); });
+    }
+
+    ~test_server() {
+        ex->drain(*server, std::chrono::system_clock::now());
+        th.join();
+    }
+
+    std::shared_ptr<grpc::Channel> channel() const {
+        return grpc::CreateChannel("127.0.0.1:" + std::to_string(port),
+                                   grpc::InsecureChannelCredentials());
+    }
+};
+
+struct result {
+    grpc::Status status;
+    std::string reply;
+};
+
+// a unary call, waited for on a queue of its own
+result call(grpc::GenericStub& stub,
+            grpc::ClientContext& context,
+            const std::string& method,
+            std::string_view request) {
+    context.set_deadline(std::chrono::system_clock::now() + std::chrono::seconds(10));
+    grpc::CompletionQueue cq;
+    grpc::ByteBuffer reply;
+    result r;
+    auto rpc = stub.PrepareUnaryCall(&context, method, buffer_of(request), &cq);
+    rpc->StartCall();
+    rpc->Finish(&reply, &r.status, nullptr);
+    void* tag;
+    bool ok;
+    REQUIRE(cq.Next(&tag, &ok));
+    cq.Shutdown();
+    while (cq.Next(&tag, &ok)) {
+    }
+    r.reply = string_of(reply);
+    return r;
+}
+
+unifex::task<grpc::Status> echo(grpc::GenericServerContext& context,
+                                const grpc::ByteBuffer& request,
+                                grpc::ByteBuffer& reply) {
+    reply = request;
+    auto tag = value_of(context.client_metadata(), "x-tag");
+    context.AddInitialMetadata("x-tag", tag);
+    context.AddTrailingMetadata("x-trailer", tag + "!");
+    co_return grpc::Status::OK;
+}
+
+unifex::task<grpc::Status> fail(grpc::GenericServerContext&,
+                                const grpc::ByteBuffer&,
+                                grpc::ByteBuffer&) {
+    co_return grpc::Status(grpc::StatusCode::NOT_FOUND, "missing");
+}
+
+unifex::task<grpc::Status> cancelled(grpc::GenericServerContext&,
+                                     const grpc::ByteBuffer&,
+                                     grpc::ByteBuffer&) {
+    co_await unifex::just_done();
+    co_return grpc::Status::OK;
+}
+
+using streams::message;
+
+// the request, numbered twice
+unifex::task<bool> list(const grpc::ServerContext&,
+                        const message& request,
+                        agrpc::server_writer<message>& writer) {
+    for (auto n : {"1", "2"}) {
+        if (!co_await writer.write(streams::message_of(request.value() + n))) {
+            co_return false;
+        }
+    }
+    co_return true;
+}
+
+unifex::task<bool> join(const grpc::ServerContext&,
+                        agrpc::server_reader<message, message>& reader,
+                        message& reply) {
+    message request;
+    while (co_await reader.read(request)) {
+        reply.set_value(reply.value() + request.value());
+    }
+    co_return true;
+}
+
+unifex::task<bool> echo_each(const grpc::ServerContext&,
+                             agrpc::server_reader_writer<message, message>& rw) {
+    message request;
+    while (co_await rw.read(request)) {
+        if (!co_await rw.write(request)) {
+            co_return false;
+        }
+    }
+    co_return true;
+}
+
+}  // namespace
+
+TEST_CASE("proxy forwards to a backend") {
+    auto router = std::make_shared<agrpc::generic_router>();
+    router->add("/test.Echo/Echo", echo);
+    router->add("/test.Echo/Fail", fail);
+    router->add("/test.Echo/Done", cancelled);
+    test_server backend([&](agrpc::grpc_executor& ex, grpc::AsyncGenericService* svc) {
+        return agrpc::async_generic_call_data(ex, svc, router);
+    });
+    grpc::GenericStub backend_stub(backend.channel());
+    test_server proxy([&](agrpc::grpc_executor& ex, grpc::AsyncGenericService* svc) {
+        return agrpc::async_proxy(ex, svc, backend_stub);
+    });
+    grpc::GenericStub stub(proxy.channel());
+
+    {
+        // metadata both ways
+        grpc::ClientContext context;
+        context.AddMetadata("x-tag", "42");
+        auto r = call(stub, context, "/test.Echo/Echo", "hello");
+        CHECK(r.status.ok());
+        CHECK(r.reply == "hello");
+        CHECK(value_of(context.GetServerInitialMetadata(), "x-tag") == "42");
+        CHECK(value_of(context.GetServerTrailingMetadata(), "x-trailer") == "42!");
+    }
+    {
+        grpc::ClientContext context;
+        auto r = call(stub, context, "/test.Echo/Fail", "hello");
+        CHECK(r.status.error_code() == grpc::StatusCode::NOT_FOUND);
+        CHECK(r.status.error_message() == "missing");
+    }
+    {
+        // a handler that completes done still gets the call a status
+        grpc::ClientContext context;
+        auto r = call(stub, context, "/test.Echo/Done", "hello");
+        CHECK(r.status.error_code() == grpc::StatusCode::UNKNOWN);
+    }
+    {
+        // the backend's own answer to an unknown method
+        grpc::ClientContext context;
+        auto r = call(stub, context, "/test.Echo/Other", "hello");
+        CHECK(r.status.error_code() == grpc::StatusCode::UNIMPLEMENTED);
+    }
+}
+
+TEST_CASE("proxy forwards streams") {
+    streams::server backend([](agrpc::grpc_executor& ex, streams::service* svc) {
+        ex.spawn_local(agrpc::async_call_data_1m<message, message>(
+            ex, &streams::service::RequestList, svc, list));
+        ex.spawn_local(agrpc::async_call_data_m1<message, message>(
+            ex, &streams::service::RequestJoin, svc, join));
+        ex.spawn_local(agrpc::async_call_data_mn<message, message>(
+            ex, &streams::service::RequestEcho, svc, echo_each));
+    });
+    grpc::GenericStub backend_stub(backend.channel());
+    test_server proxy([&](agrpc::grpc_executor& ex, grpc::AsyncGenericService* svc) {
+        return agrpc::async_proxy(ex, svc, backend_stub);
+    });
+    grpc::GenericStub stub(proxy.channel());
+
+    // each a few times, a call must not leave client ops of the last behind
+    for (int i = 0; i < 3; i++) {
+        {
+            grpc::ClientContext context;
+            auto r = streams::call(stub, context, streams::list_method, {"a"});
+            CHECK(r.status.ok());
+            CHECK(r.replies == std::vector<std::string>{"a1", "a2"});
+        }
+        {
+            grpc::ClientContext context;
+            auto r = streams::call(stub, context, streams::join_method, {"a", "b", "c"});
+            CHECK(r.status.ok());
+            CHECK(r.replies == std::vector<std::string>{"abc"});
+        }
+        {
+            grpc::ClientContext context;
+            auto r = streams::call(stub, context, streams::echo_method, {"x", "y"});
+            CHECK(r.status.ok());
+            CHECK(r.replies == std::vector<std::string>{"x", "y"});
+        }
+    }
+}
@@ -0,0 +1,165 @@
+#include <chrono>
+#include <memory>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+#include <async_grpc/rate.h>
+#include <async_grpc/rpcs.h>
+#include <doctest/doctest.h>
+#include <grpcpp/grpcpp.h>
+#include <unifex/scope_guard.hpp>
+#include <unifex/sync_wait.hpp>
+#include <unifex/task.hpp>
+#include "stream_service.h"
+
+namespace {
+long elapsed_ms(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+               std::chrono::steady_clock::now() - start)
+        .count();
+}
+}  // namespace
+
+TEST_CASE("token bucket") {
+    using namespace std::chrono_literals;
+    // 10k tokens per second, 100us apart, 4 at once
+    agrpc::token_bucket bucket(10000, 4);
+    auto now = agrpc::token_bucket::clock::now();
+
+    for (int i = 0; i < 4; i++) {
+        CHECK(bucket.reserve(now) <= now);
+    }
+    CHECK(!bucket.try_acquire(now));
+    // reservations queue up behind each other
+    CHECK(bucket.reserve(now) == now + 100us);
+    CHECK(bucket.reserve(now) == now + 200us);
+
+    // refilled below a millisecond
+    CHECK(!bucket.try_acquire(now + 250us));
+    CHECK(bucket.try_acquire(now + 300us));
+    CHECK(!bucket.idle(now + 300us));
+    CHECK(bucket.idle(now + 700us));
+}
+
+TEST_CASE("rate limiter acquire") {
+    grpc::ServerBuilder builder;
+    agrpc::grpc_context ctx(builder.AddCompletionQueue());
+    std::unique_ptr<grpc::Server> server = builder.BuildAndStart();
+
+    unifex::inplace_stop_source stop_source;
+    std::thread th([&]() { ctx.run(stop_source.get_token()); });
+    unifex::scope_guard stop_on_exit = [&]() noexcept {
+        server->Shutdown();
+        stop_source.request_stop();
+        th.join();
+    };
+
+    // 10ms apart, 2 at once
+    agrpc::rate_limiter limiter(ctx, 100, 2);
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < 5; i++) {
+        unifex::sync_wait(limiter.acquire());
+    }
+    // the last 3 waited for theirs
+    auto ms = elapsed_ms(start);
+    CHECK(ms >= 29);
+    CHECK(ms < 5000);
+}
+
+TEST_CASE("keyed rate limiter") {
+    grpc::ServerBuilder builder;
+    agrpc::grpc_context ctx(builder.AddCompletionQueue());
+    std::unique_ptr<grpc::Server> server = builder.BuildAndStart();
+
+    unifex::inplace_stop_source stop_source;
+    std::thread th([&]() { ctx.run(stop_source.get_token()); });
+    unifex::scope_guard stop_on_exit = [&]() noexcept {
+        server->Shutdown();
+        stop_source.request_stop();
+        th.join();
+    };
+
+    {
+        // a token a second, keys don't share theirs
+        agrpc::keyed_rate_limiter limiter(ctx, 1, 1, 2);
+        CHECK(limiter.try_acquire("a"));
+        CHECK(limiter.try_acquire("b"));
+        CHECK(!limiter.try_acquire("a"));
+        CHECK(limiter.size() == 2);
+
+        // at the cap, "b" was used least recently and goes
+        CHECK(limiter.try_acquire("c"));
+        CHECK(limiter.size() == 2);
+        CHECK(!limiter.try_acquire("a"));
+        CHECK(limiter.try_acquire("b"));
+        CHECK(limiter.size() == 2);
+        CHECK(!limiter.try_acquire("a"));
+        CHECK(!limiter.try_acquire("b"));
+    }
+    {
+        // 10ms apart per key
+        agrpc::keyed_rate_limiter limiter(ctx, 100);
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < 4; i++) {
+            unifex::sync_wait(limiter.acquire("a"));
+            unifex::sync_wait(limiter.acquire(std::to_string(i)));
+        }
+        auto ms = elapsed_ms(start);
+        CHECK(ms >= 29);
+        CHECK(ms < 5000);
+        CHECK(limiter.size() == 5);
+    }
+}
+
+TEST_CASE("rate limiters pace calls") {
+    // 50ms apart
+    std::optional<agrpc::rate_limiter> accept_limiter;
+    streams::server server([&](agrpc::grpc_executor& ex, streams::service* svc) {
+        accept_limiter.emplace(ex.get_grpc_context(), 20);
+        ex.spawn_local(agrpc::async_call_data<streams::message, streams::message>(
+            ex,
+            &streams::service::RequestGet,
+            svc,
+            [](const grpc::ServerContext&,
+               const streams::message& request,
+               streams::message& reply) -> unifex::task<bool> {
+                reply = request;
+                co_return true;
+            },
+            {.accept_limiter = &*accept_limiter}));
+    });
+
+    {
+        // the server accepts a call per token
+        grpc::GenericStub stub(server.channel());
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < 3; i++) {
+            grpc::ClientContext context;
+            auto r = streams::call(stub, context, streams::get_method, {"a"});
+            CHECK(r.status.ok());
+        }
+        auto ms = elapsed_ms(start);
+        CHECK(ms >= 90);
+        CHECK(ms < 5000);
+    }
+    {
+        // the client starts a call per token, 100ms apart, slower than the
+        // server accepts them
+        streams::stub stub(server.channel());
+        agrpc::rate_limiter limiter(server.ex->get_grpc_context(), 10);
+        agrpc::client_options options;
+        options.limiter = &limiter;
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < 3; i++) {
+            auto r = unifex::sync_wait(agrpc::async_client_call<streams::message>(
+                *server.ex, &streams::stub::AsyncGet, &stub, streams::message_of("b"), options));
+            REQUIRE(r);
+            REQUIRE(r->has_value());
+            CHECK(r->value().value() == "b");
+        }
+        auto ms = elapsed_ms(start);
+        CHECK(ms >= 190);
+        CHECK(ms < 5000);
+    }
+}
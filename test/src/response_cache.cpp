@@ -0,0 +1,55 @@
+#include <memory>
+#include <string>
+#include <async_grpc/response_cache.h>
+#include <doctest/doctest.h>
+#include <google/protobuf/wrappers.pb.h>
+
+namespace {
+
+std::shared_ptr<const google::protobuf::StringValue> reply_of(std::string value) {
+    auto reply = std::make_shared<google::protobuf::StringValue>();
+    reply->set_value(std::move(value));
+    return reply;
+}
+
+}  // namespace
+
+TEST_CASE("response cache") {
+    agrpc::response_cache cache({.metadata = {"tenant"}});
+    google::protobuf::StringValue request;
+    request.set_value("request");
+
+    auto key = cache.key_of(request, {"a"});
+    CHECK(key != cache.key_of(request, {"b"}));
+    CHECK(!cache.lookup(key));
+
+    cache.insert(key, reply_of("reply"));
+    auto hit = cache.lookup(key);
+    REQUIRE(hit);
+    CHECK(static_cast<const google::protobuf::StringValue&>(*hit).value() == "reply");
+    CHECK(!cache.lookup(cache.key_of(request, {"b"})));
+
+    cache.invalidate(key);
+    CHECK(!cache.lookup(key));
+
+    auto stats = cache.stats();
+    CHECK(stats.hits == 1);
+    CHECK(stats.misses == 3);
+    CHECK(stats.invalidations == 1);
+    CHECK(stats.entries == 0);
+    CHECK(stats.bytes == 0);
+}
+
+TEST_CASE("response cache ttl") {
+    using namespace std::chrono_literals;
+    agrpc::response_cache cache({.ttl = 0s});
+    google::protobuf::StringValue request;
+    request.set_value("a");
+    cache.insert(cache.key_of(request), reply_of("reply"));
+    CHECK(!cache.lookup(cache.key_of(request)));
+    CHECK(cache.stats().entries == 0);
+
+    cache.insert(cache.key_of(request), reply_of("reply"));
+    cache.clear();
+    CHECK(cache.stats().invalidations == 1);
+}
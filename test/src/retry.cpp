@@ -0,0 +1,229 @@
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <async_grpc/grpc_executor.h>
+#include <async_grpc/method_stats.h>
+#include <async_grpc/retry.h>
+#include <async_grpc/rpcs.h>
+#include <doctest/doctest.h>
+#include <google/protobuf/wrappers.pb.h>
+#include <grpcpp/generic/generic_stub.h>
+#include <grpcpp/grpcpp.h>
+#include <unifex/scheduler_concepts.hpp>
+#include <unifex/scope_guard.hpp>
+#include <unifex/stop_when.hpp>
+#include <unifex/sync_wait.hpp>
+#include <unifex/task.hpp>
+
+TEST_CASE("retry budget") {
+    // one retry per 4 calls, 2 saved up
+    agrpc::retry_budget budget(0.25, 2);
+    CHECK(budget.try_withdraw());
+    CHECK(budget.try_withdraw());
+    CHECK(!budget.try_withdraw());
+
+    for (int i = 0; i < 3; i++) {
+        budget.deposit();
+    }
+    CHECK(!budget.try_withdraw());
+    budget.deposit();
+    CHECK(budget.try_withdraw());
+
+    // no more than `max_tokens` saved up
+    for (int i = 0; i < 100; i++) {
+        budget.deposit();
+    }
+    CHECK(budget.tokens() == doctest::Approx(2));
+    CHECK(budget.granted() == 3);
+    CHECK(budget.denied() == 2);
+}
+
+TEST_CASE("retry backoff") {
+    using namespace std::chrono_literals;
+    agrpc::retry_policy policy;
+    policy.initial_backoff = 10ms;
+    policy.max_backoff = 30ms;
+    policy.multiplier = 2;
+
+    for (int i = 0; i < 100; i++) {
+        CHECK(policy.backoff(1) <= 10ms);
+        CHECK(policy.backoff(2) <= 20ms);
+        CHECK(policy.backoff(5) <= 30ms);
+    }
+    CHECK(policy.is_retryable(grpc::StatusCode::UNAVAILABLE));
+    CHECK(!policy.is_retryable(grpc::StatusCode::INVALID_ARGUMENT));
+    CHECK(!policy.hedging());
+    CHECK(!policy.hedge_after());
+}
+
+TEST_CASE("hedge after a latency percentile") {
+    using namespace std::chrono_literals;
+    agrpc::method_stats stats("hedge");
+    agrpc::latency_percentile p95(stats, 0.95, 100, 0ms);
+
+    agrpc::retry_policy policy;
+    policy.hedge_percentile = &p95;
+    CHECK(policy.hedging());
+    // not enough samples, and no fixed delay to go by
+    CHECK(!policy.hedge_after());
+    policy.hedge_delay = 5ms;
+    CHECK(policy.hedge_after() == 5ms);
+
+    for (int i = 0; i < 100; i++) {
+        stats.record(agrpc::method_stats::client, i < 90 ? 1ms : 10ms);
+    }
+    auto delay = policy.hedge_after();
+    REQUIRE(delay);
+    CHECK(*delay >= 10ms);
+    CHECK(*delay <= 11ms);
+}
+
+namespace {
+
+using reply = google::protobuf::StringValue;
+
+enum class outcome { unavailable, ok, hang };
+
+// Attempts of `retried_call` that play `script`, one outcome per attempt. A
+// hanging attempt is a call to a backend that never comes up, it only ends
+// when its context gets cancelled.
+struct fake_attempts {
+    agrpc::grpc_executor& ex;
+    std::vector<outcome> script;
+    grpc::GenericStub stub{grpc::CreateChannel("127.0.0.1:1", grpc::InsecureChannelCredentials())};
+    int started = 0;
+    std::vector<grpc::StatusCode> finished;
+
+    unifex::task<grpc::Status> attempt(grpc::ClientContext& context, reply& rep) {
+        auto what = script.at(started++);
+        grpc::Status status;
+        if (what == outcome::ok) {
+            rep.set_value("ok");
+        } else if (what == outcome::unavailable) {
+            status = grpc::Status(grpc::StatusCode::UNAVAILABLE, "unavailable");
+        } else {
+            context.set_wait_for_ready(true);
+            grpc::ByteBuffer request;
+            grpc::ByteBuffer response;
+            std::unique_ptr<grpc::GenericClientAsyncResponseReader> call;
+            co_await ex.async([&](grpc::CompletionQueue* cq, void* tag) {
+                call = stub.PrepareUnaryCall(&context, "/test.Fake/Hang", request, cq);
+                call->StartCall();
+                call->Finish(&response, &status, tag);
+            });
+        }
+        finished.push_back(status.error_code());
+        co_return status;
+    }
+
+    unifex::task<agrpc::Try<reply>> run(const agrpc::retry_policy& policy,
+                                        agrpc::method_stats* stats = nullptr) {
+        return agrpc::detail::retried_call<reply>::run(
+            ex,
+            policy,
+            [this](grpc::ClientContext& context, reply& rep) { return attempt(context, rep); },
+            stats);
+    }
+};
+
+struct running_executor {
+    agrpc::grpc_executor ex{std::make_unique<grpc::CompletionQueue>(), 1};
+    unifex::inplace_stop_source stop_source;
+    std::thread th{[this]() { ex.run(stop_source.get_token()); }};
+
+    ~running_executor() {
+        stop_source.request_stop();
+        th.join();
+    }
+};
+
+}  // namespace
+
+TEST_CASE("retried call retries unavailable") {
+    using namespace std::chrono_literals;
+    running_executor rex;
+    agrpc::retry_policy policy;
+    policy.initial_backoff = 1ms;
+
+    fake_attempts fake{rex.ex, {outcome::unavailable, outcome::unavailable, outcome::ok}};
+    auto result = unifex::sync_wait(fake.run(policy));
+    REQUIRE(result);
+    REQUIRE(result->has_value());
+    CHECK(result->value().value() == "ok");
+    CHECK(fake.started == 3);
+
+    // the latency of every attempt, without the backoffs in between
+    agrpc::method_stats stats("retried");
+    policy.initial_backoff = 50ms;
+    policy.max_backoff = 50ms;
+    fake_attempts timed{rex.ex, {outcome::unavailable, outcome::ok}};
+    result = unifex::sync_wait(timed.run(policy, &stats));
+    REQUIRE(result);
+    REQUIRE(result->has_value());
+    auto latency = stats.snapshot()[agrpc::method_stats::client];
+    CHECK(latency.count == 2);
+    CHECK(std::chrono::nanoseconds(latency.max) < 25ms);
+    policy.initial_backoff = 1ms;
+
+    // out of attempts, with the last failure
+    fake_attempts failing{rex.ex, {outcome::unavailable, outcome::unavailable}};
+    policy.max_attempts = 2;
+    result = unifex::sync_wait(failing.run(policy));
+    REQUIRE(result);
+    CHECK(result->has_exception());
+    CHECK(failing.started == 2);
+}
+
+TEST_CASE("retried call hedge cancels the loser") {
+    using namespace std::chrono_literals;
+    running_executor rex;
+    agrpc::retry_policy policy;
+    policy.max_attempts = 2;
+    policy.hedge_delay = 10ms;
+
+    agrpc::method_stats stats("hedged");
+    fake_attempts fake{rex.ex, {outcome::hang, outcome::ok}};
+    auto result = unifex::sync_wait(fake.run(policy, &stats));
+    REQUIRE(result);
+    REQUIRE(result->has_value());
+    CHECK(fake.started == 2);
+    // the loser was cut short, its latency says nothing
+    CHECK(stats.snapshot()[agrpc::method_stats::client].count == 1);
+    // the hedge won, and the first attempt was over before the call returned
+    CHECK(fake.finished == std::vector{grpc::StatusCode::OK, grpc::StatusCode::CANCELLED});
+}
+
+TEST_CASE("retried call budget denies extra attempts") {
+    using namespace std::chrono_literals;
+    running_executor rex;
+    // spent, and nothing deposited per call
+    agrpc::retry_budget budget(0, 1);
+    REQUIRE(budget.try_withdraw());
+    agrpc::retry_policy policy;
+    policy.initial_backoff = 1ms;
+    policy.budget = &budget;
+
+    fake_attempts fake{rex.ex, {outcome::unavailable, outcome::ok}};
+    auto result = unifex::sync_wait(fake.run(policy));
+    REQUIRE(result);
+    CHECK(result->has_exception());
+    CHECK(fake.started == 1);
+    CHECK(budget.denied() == 1);
+}
+
+TEST_CASE("retried call waits for its attempts when the caller stops") {
+    using namespace std::chrono_literals;
+    running_executor rex;
+    agrpc::retry_policy policy;
+    policy.max_attempts = 2;
+    policy.hedge_delay = 20ms;
+
+    fake_attempts fake{rex.ex, {outcome::hang, outcome::hang}};
+    unifex::sync_wait(unifex::stop_when(
+        fake.run(policy), unifex::schedule_after(rex.ex.get_grpc_scheduler(), 5ms)));
+    // woken by the hedge timer, it cancels the attempt and waits for it
+    // instead of starting the hedge
+    CHECK(fake.started == 1);
+    CHECK(fake.finished == std::vector{grpc::StatusCode::CANCELLED});
+}
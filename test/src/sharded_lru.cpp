@@ -0,0 +1,81 @@
+#include <cstdint>
+#include <set>
+#include <string>
+#include <async_grpc/sharded_lru.h>
+#include <doctest/doctest.h>
+
+TEST_CASE("sharded lru memory cap") {
+    agrpc::detail::sharded_lru<std::string> lru(100, 1);
+    auto put = [&](std::string key) {
+        lru.lock(key).put(key, std::string(24, 'x'), 24);
+    };
+    // 25 bytes each
+    put("a");
+    put("b");
+    put("c");
+    put("d");
+    CHECK(lru.lock("a").get("a"));
+    put("e");
+    // b was used least recently, `find` doesn't count as a use
+    CHECK(lru.lock("c").find("c"));
+    CHECK(!lru.lock("b").find("b"));
+    put("f");
+    CHECK(!lru.lock("c").find("c"));
+    CHECK(lru.lock("a").find("a"));
+
+    auto stats = lru.stats();
+    CHECK(stats.entries == 4);
+    CHECK(stats.bytes == 100);
+    CHECK(stats.evictions == 2);
+
+    // replaced in place
+    lru.lock("a").put("a", "y", 1);
+    CHECK(*lru.lock("a").find("a") == "y");
+    CHECK(lru.stats().bytes == 77);
+
+    // too large to be stored at all, the previous value stays
+    lru.lock("a").put("a", std::string(200, 'x'), 200);
+    CHECK(*lru.lock("a").find("a") == "y");
+    CHECK(lru.stats().evictions == 2);
+
+    CHECK(lru.lock("a").erase("a"));
+    CHECK(!lru.lock("a").erase("a"));
+    CHECK(lru.clear() == 3);
+    CHECK(lru.stats().entries == 0);
+    CHECK(lru.stats().bytes == 0);
+}
+
+TEST_CASE("sharded lru shards") {
+    agrpc::detail::sharded_lru<int, std::set<std::string>> lru(1 << 20, 4);
+    for (int i = 0; i < 100; i++) {
+        auto key = std::to_string(i);
+        auto shard = lru.lock(key);
+        shard.put(key, i, sizeof(int));
+        shard.extra().insert(key);
+    }
+    CHECK(lru.stats().entries == 100);
+    std::size_t extra = 0;
+    for (int i = 0; i < 100; i++) {
+        auto key = std::to_string(i);
+        auto shard = lru.lock(key);
+        REQUIRE(shard.get(key));
+        CHECK(*shard.get(key) == i);
+        extra += shard.extra().count(key);
+    }
+    CHECK(extra == 100);
+
+    // extra state outlives `clear`
+    lru.clear();
+    CHECK(lru.lock("1").extra().count("1") == 1);
+}
+
+TEST_CASE("sized keys") {
+    std::string a;
+    agrpc::detail::append_sized(a, "ab");
+    a += "c";
+    std::string b;
+    agrpc::detail::append_sized(b, "a");
+    b += "bc";
+    CHECK(a != b);
+    CHECK(a.size() == sizeof(std::uint32_t) + 3);
+}
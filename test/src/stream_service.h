@@ -0,0 +1,205 @@
+// A streaming service for the tests, the async service protoc would generate
+// for
+//
+//   service Streams {
+//     rpc List(StringValue) returns (stream StringValue);
+//     rpc Join(stream StringValue) returns (StringValue);
+//     rpc Echo(stream StringValue) returns (stream StringValue);
+//     rpc Get(StringValue) returns (StringValue);
+//   }
+//
+// the async stub of Get, and a generic client for all of them.
+#pragma once
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <async_grpc/grpc_executor.h>
+#include <doctest/doctest.h>
+#include <google/protobuf/wrappers.pb.h>
+#include <grpcpp/generic/generic_stub.h>
+#include <grpcpp/grpcpp.h>
+#include <grpcpp/impl/codegen/async_unary_call.h>
+#include <grpcpp/impl/codegen/proto_utils.h>
+#include <grpcpp/impl/codegen/rpc_method.h>
+#include <grpcpp/impl/codegen/rpc_service_method.h>
+
+namespace streams {
+
+using message = google::protobuf::StringValue;
+
+inline constexpr char list_method[] = "/test.Streams/List";
+inline constexpr char join_method[] = "/test.Streams/Join";
+inline constexpr char echo_method[] = "/test.Streams/Echo";
+inline constexpr char get_method[] = "/test.Streams/Get";
+
+class service : public grpc::Service {
+public:
+    service() {
+        // no handlers, served through the completion queue
+        AddMethod(new grpc::internal::RpcServiceMethod(
+            list_method, grpc::internal::RpcMethod::SERVER_STREAMING, nullptr));
+        AddMethod(new grpc::internal::RpcServiceMethod(
+            join_method, grpc::internal::RpcMethod::CLIENT_STREAMING, nullptr));
+        AddMethod(new grpc::internal::RpcServiceMethod(
+            echo_method, grpc::internal::RpcMethod::BIDI_STREAMING, nullptr));
+        AddMethod(new grpc::internal::RpcServiceMethod(
+            get_method, grpc::internal::RpcMethod::NORMAL_RPC, nullptr));
+        for (int i = 0; i < 4; i++) {
+            MarkMethodAsync(i);
+        }
+    }
+
+    void RequestList(grpc::ServerContext* context,
+                     message* request,
+                     grpc::ServerAsyncWriter<message>* writer,
+                     grpc::CompletionQueue* new_call_cq,
+                     grpc::ServerCompletionQueue* cq,
+                     void* tag) {
+        RequestAsyncServerStreaming(0, context, request, writer, new_call_cq, cq, tag);
+    }
+
+    void RequestJoin(grpc::ServerContext* context,
+                     grpc::ServerAsyncReader<message, message>* reader,
+                     grpc::CompletionQueue* new_call_cq,
+                     grpc::ServerCompletionQueue* cq,
+                     void* tag) {
+        RequestAsyncClientStreaming(1, context, reader, new_call_cq, cq, tag);
+    }
+
+    void RequestEcho(grpc::ServerContext* context,
+                     grpc::ServerAsyncReaderWriter<message, message>* stream,
+                     grpc::CompletionQueue* new_call_cq,
+                     grpc::ServerCompletionQueue* cq,
+                     void* tag) {
+        RequestAsyncBidiStreaming(2, context, stream, new_call_cq, cq, tag);
+    }
+
+    void RequestGet(grpc::ServerContext* context,
+                    message* request,
+                    grpc::ServerAsyncResponseWriter<message>* writer,
+                    grpc::CompletionQueue* new_call_cq,
+                    grpc::ServerCompletionQueue* cq,
+                    void* tag) {
+        RequestAsyncUnary(3, context, request, writer, new_call_cq, cq, tag);
+    }
+};
+
+// The async half of the stub protoc would generate, for Get.
+class stub {
+public:
+    explicit stub(std::shared_ptr<grpc::ChannelInterface> channel)
+      : channel_(std::move(channel)) {}
+
+    std::unique_ptr<grpc::ClientAsyncResponseReader<message>>
+    AsyncGet(grpc::ClientContext* context, const message& request, grpc::CompletionQueue* cq) {
+        auto* rpc = grpc::internal::ClientAsyncResponseReaderHelper::Create<message>(
+            channel_.get(), cq, get_, context, request);
+        rpc->StartCall();
+        return std::unique_ptr<grpc::ClientAsyncResponseReader<message>>(rpc);
+    }
+
+private:
+    std::shared_ptr<grpc::ChannelInterface> channel_;
+    const grpc::internal::RpcMethod get_{get_method, grpc::internal::RpcMethod::NORMAL_RPC};
+};
+
+// `service` on a local port, served on its own executor thread and drained on
+// destruction. `serve(ex, svc)` spawns the methods.
+struct server {
+    service svc;
+    int port = 0;
+    std::unique_ptr<agrpc::grpc_executor> ex;
+    std::unique_ptr<grpc::Server> grpc_server;
+    std::thread th;
+
+    template <class Serve>
+    explicit server(Serve serve) {
+        grpc::ServerBuilder builder;
+        builder.AddListeningPort("127.0.0.1:0", grpc::InsecureServerCredentials(), &port);
+        builder.RegisterService(&svc);
+        ex = std::make_unique<agrpc::grpc_executor>(builder.AddCompletionQueue(), 1);
+        grpc_server = builder.BuildAndStart();
+        serve(*ex, &svc);
+        th = std::thread([this]() { ex->run(); });
+    }
+
+    ~server() {
+        ex->drain(*grpc_server, std::chrono::system_clock::now());
+        th.join();
+    }
+
+    std::shared_ptr<grpc::Channel> channel() const {
+        return grpc::CreateChannel("127.0.0.1:" + std::to_string(port),
+                                   grpc::InsecureChannelCredentials());
+    }
+};
+
+inline message message_of(std::string value) {
+    message m;
+    m.set_value(std::move(value));
+    return m;
+}
+
+struct result {
+    grpc::Status status;
+    std::vector<std::string> replies;
+};
+
+// A call of any kind, waited for on a queue of its own: writes
+// `requests`, then reads replies until the server is done.
+inline result call(grpc::GenericStub& stub,
+                   grpc::ClientContext& context,
+                   const std::string& method,
+                   const std::vector<std::string>& requests) {
+    context.set_deadline(std::chrono::system_clock::now() + std::chrono::seconds(10));
+    grpc::CompletionQueue cq;
+    auto next = [&]() {
+        void* tag;
+        bool ok = false;
+        REQUIRE(cq.Next(&tag, &ok));
+        return ok;
+    };
+    result r;
+    auto rpc = stub.PrepareCall(&context, method, &cq);
+    rpc->StartCall(nullptr);
+    bool ok = next();
+    for (auto& request : requests) {
+        if (!ok) {
+            break;
+        }
+        grpc::ByteBuffer buffer;
+        bool own = false;
+        REQUIRE(grpc::SerializationTraits<message>::Serialize(
+                    message_of(request), &buffer, &own)
+                    .ok());
+        rpc->Write(buffer, nullptr);
+        ok = next();
+    }
+    if (ok) {
+        rpc->WritesDone(nullptr);
+        next();
+    }
+    while (true) {
+        grpc::ByteBuffer buffer;
+        rpc->Read(&buffer, nullptr);
+        if (!next()) {
+            break;
+        }
+        message reply;
+        REQUIRE(grpc::SerializationTraits<message>::Deserialize(&buffer, &reply).ok());
+        r.replies.push_back(reply.value());
+    }
+    rpc->Finish(&r.status, nullptr);
+    next();
+    cq.Shutdown();
+    void* tag;
+    while (cq.Next(&tag, &ok)) {
+    }
+    return r;
+}
+
+}  // namespace streams
@@ -0,0 +1,89 @@
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <async_grpc/rpcs.h>
+#include <doctest/doctest.h>
+#include <unifex/just_done.hpp>
+#include <unifex/task.hpp>
+#include "stream_service.h"
+
+namespace {
+
+using streams::message;
+
+// replies with "a", then fails as the request says
+unifex::task<bool> list(const grpc::ServerContext&,
+                        const message& request,
+                        agrpc::server_writer<message>& writer) {
+    co_await writer.write(streams::message_of("a"));
+    if (request.value() == "throw") {
+        throw std::runtime_error("list");
+    }
+    if (request.value() == "done") {
+        co_await unifex::just_done();
+    }
+    co_return true;
+}
+
+unifex::task<bool> join(const grpc::ServerContext&,
+                        agrpc::server_reader<message, message>& reader,
+                        message&) {
+    message request;
+    while (co_await reader.read(request)) {
+    }
+    throw std::runtime_error("join");
+}
+
+unifex::task<bool> echo(const grpc::ServerContext&,
+                        agrpc::server_reader_writer<message, message>& rw) {
+    message request;
+    if (co_await rw.read(request)) {
+        co_await rw.write(request);
+    }
+    co_await unifex::just_done();
+    co_return true;
+}
+
+}  // namespace
+
+TEST_CASE("failed stream handlers still finish the call") {
+    streams::server server([](agrpc::grpc_executor& ex, streams::service* svc) {
+        ex.spawn_local(agrpc::async_call_data_1m<message, message>(
+            ex, &streams::service::RequestList, svc, list));
+        ex.spawn_local(agrpc::async_call_data_m1<message, message>(
+            ex, &streams::service::RequestJoin, svc, join));
+        ex.spawn_local(agrpc::async_call_data_mn<message, message>(
+            ex, &streams::service::RequestEcho, svc, echo));
+    });
+    grpc::GenericStub stub(server.channel());
+
+    {
+        grpc::ClientContext context;
+        auto r = streams::call(stub, context, streams::list_method, {"ok"});
+        CHECK(r.status.ok());
+        CHECK(r.replies == std::vector<std::string>{"a"});
+    }
+    {
+        // what was written before the throw still goes out
+        grpc::ClientContext context;
+        auto r = streams::call(stub, context, streams::list_method, {"throw"});
+        CHECK(r.status.error_code() == grpc::StatusCode::UNKNOWN);
+        CHECK(r.replies == std::vector<std::string>{"a"});
+    }
+    {
+        grpc::ClientContext context;
+        auto r = streams::call(stub, context, streams::list_method, {"done"});
+        CHECK(r.status.error_code() == grpc::StatusCode::UNKNOWN);
+    }
+    {
+        grpc::ClientContext context;
+        auto r = streams::call(stub, context, streams::join_method, {"a", "b"});
+        CHECK(r.status.error_code() == grpc::StatusCode::UNKNOWN);
+    }
+    {
+        grpc::ClientContext context;
+        auto r = streams::call(stub, context, streams::echo_method, {"x"});
+        CHECK(r.status.error_code() == grpc::StatusCode::UNKNOWN);
+        CHECK(r.replies == std::vector<std::string>{"x"});
+    }
+}
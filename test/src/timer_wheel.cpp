@@ -0,0 +1,57 @@
+#include <cstdint>
+#include <vector>
+#include <async_grpc/timer_wheel.h>
+#include <doctest/doctest.h>
+
+TEST_CASE("timer wheel") {
+    agrpc::timer_wheel wheel(100);
+    std::vector<agrpc::timer_wheel::node> nodes(4);
+    nodes[0].tick = 100;      // due
+    nodes[1].tick = 101;      // level 0
+    nodes[2].tick = 5000;     // level 2, its base 64 digits differ from 100's up there
+    nodes[3].tick = 1 << 30;  // overflow
+
+    CHECK(!wheel.insert(&nodes[0]));
+    for (int i = 1; i < 4; i++) {
+        CHECK(wheel.insert(&nodes[i]));
+    }
+    CHECK(nodes[1].level == 0);
+    CHECK(nodes[2].level == 2);
+    CHECK(wheel.size() == 3);
+    CHECK(wheel.next_tick() == 101);
+
+    std::vector<std::uint64_t> fired;
+    auto collect = [&](agrpc::timer_wheel::node* n) { fired.push_back(n->tick); };
+
+    wheel.advance(4999, collect);
+    CHECK(fired == std::vector<std::uint64_t>{101});
+    wheel.advance(5000, collect);
+    CHECK(fired == std::vector<std::uint64_t>{101, 5000});
+
+    wheel.remove(&nodes[3]);
+    CHECK(wheel.empty());
+    CHECK(wheel.next_tick() == agrpc::timer_wheel::never);
+}
+
+TEST_CASE("timer wheel clear") {
+    agrpc::timer_wheel wheel(100);
+    std::vector<agrpc::timer_wheel::node> nodes(3);
+    nodes[0].tick = 101;
+    nodes[1].tick = 5000;
+    nodes[2].tick = 1 << 30;
+    for (auto& n : nodes) {
+        REQUIRE(wheel.insert(&n));
+    }
+
+    std::vector<std::uint64_t> cleared;
+    wheel.clear([&](agrpc::timer_wheel::node* n) { cleared.push_back(n->tick); });
+    CHECK(cleared == std::vector<std::uint64_t>{101, 5000, 1 << 30});
+    CHECK(wheel.empty());
+    CHECK(wheel.next_tick() == agrpc::timer_wheel::never);
+    for (auto& n : nodes) {
+        CHECK(!n.linked());
+    }
+    // usable again
+    CHECK(wheel.insert(&nodes[0]));
+    CHECK(wheel.next_tick() == 101);
+}
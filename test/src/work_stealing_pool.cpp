@@ -0,0 +1,181 @@
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <set>
+#include <thread>
+#include <vector>
+#include <async_grpc/work_stealing_pool.h>
+#include <doctest/doctest.h>
+
+namespace {
+
+// bumps `count` when run, after waiting for `release` if there is one
+struct counting_task : agrpc::task_base {
+    counting_task() noexcept {
+        this->execute_ = [](agrpc::task_base* p, bool) noexcept {
+            auto& self = *static_cast<counting_task*>(p);
+            if (self.release != nullptr) {
+                while (!self.release->load()) {
+                    std::this_thread::yield();
+                }
+            }
+            self.ranOn = std::this_thread::get_id();
+            self.count->fetch_add(1);
+        };
+    }
+
+    std::atomic<int>* count = nullptr;
+    const std::atomic<bool>* release = nullptr;
+    std::thread::id ranOn;
+};
+
+void wait_for(const std::atomic<int>& count, int n) {
+    while (count.load() < n) {
+        std::this_thread::yield();
+    }
+}
+
+// a task bumps `executed` after it returned
+void wait_executed(const agrpc::work_stealing_pool& pool, std::uint64_t n) {
+    while (pool.stats().executed < n) {
+        std::this_thread::yield();
+    }
+}
+
+}  // namespace
+
+TEST_CASE("parse cpu list") {
+    CHECK(agrpc::detail::parse_cpu_list("0-3,8,10-11\n") ==
+          std::vector<int>{0, 1, 2, 3, 8, 10, 11});
+    CHECK(agrpc::detail::parse_cpu_list("5") == std::vector<int>{5});
+    CHECK(agrpc::detail::parse_cpu_list("").empty());
+    CHECK(agrpc::detail::parse_cpu_list("3-1").empty());
+    CHECK(agrpc::detail::parse_cpu_list("a-b").empty());
+}
+
+TEST_CASE("task deque is LIFO for the owner and FIFO for thieves") {
+    agrpc::detail::task_deque q(2);
+    std::vector<counting_task> tasks(100);
+    for (auto& t : tasks) {
+        q.push(&t);
+    }
+    CHECK(q.size() == 100);
+    CHECK(q.pop() == &tasks[99]);
+    CHECK(q.steal() == &tasks[0]);
+    CHECK(q.steal() == &tasks[1]);
+    CHECK(q.pop() == &tasks[98]);
+    CHECK(q.size() == 96);
+    while (q.pop() != nullptr) {
+    }
+    CHECK(q.size() == 0);
+    CHECK(q.steal() == nullptr);
+}
+
+TEST_CASE("task deque hands out every task once under concurrent steals") {
+    constexpr int kTasks = 100000;
+    agrpc::detail::task_deque q;
+    std::vector<counting_task> tasks(kTasks);
+    std::vector<std::atomic<int>> taken(kTasks);
+    std::atomic<bool> done{false};
+    auto take = [&](agrpc::task_base* t) {
+        taken[static_cast<counting_task*>(t) - tasks.data()].fetch_add(1);
+    };
+
+    std::vector<std::thread> thieves;
+    for (int i = 0; i < 3; i++) {
+        thieves.emplace_back([&]() {
+            while (!done.load() || q.size() != 0) {
+                if (auto* t = q.steal()) {
+                    take(t);
+                }
+            }
+        });
+    }
+    for (int i = 0; i < kTasks; i++) {
+        q.push(&tasks[i]);
+        if (i % 3 == 0) {
+            if (auto* t = q.pop()) {
+                take(t);
+            }
+        }
+    }
+    while (auto* t = q.pop()) {
+        take(t);
+    }
+    done = true;
+    for (auto& th : thieves) {
+        th.join();
+    }
+
+    int missing = 0;
+    int twice = 0;
+    for (auto& n : taken) {
+        missing += n.load() == 0;
+        twice += n.load() > 1;
+    }
+    CHECK(missing == 0);
+    CHECK(twice == 0);
+}
+
+TEST_CASE("work stealing pool runs every task") {
+    agrpc::work_stealing_pool pool({.threads = 4});
+    CHECK(pool.size() == 4);
+
+    std::atomic<int> count{0};
+    std::vector<counting_task> tasks(10000);
+    for (auto& t : tasks) {
+        t.count = &count;
+        pool.submit(&t);
+    }
+    wait_for(count, 10000);
+    wait_executed(pool, 10000);
+
+    std::set<std::thread::id> threads;
+    for (auto& t : tasks) {
+        threads.insert(t.ranOn);
+    }
+    CHECK(threads.count(std::this_thread::get_id()) == 0);
+
+    auto stats = pool.stats();
+    CHECK(stats.submitted == 10000);
+    CHECK(stats.executed == 10000);
+    CHECK(stats.queued() == 0);
+    CHECK(stats.depth.size() == 4);
+}
+
+TEST_CASE("work stealing pool runs around a stuck worker") {
+    agrpc::work_stealing_pool pool({.threads = 2});
+    std::atomic<int> count{0};
+    std::atomic<bool> release{false};
+
+    // round robin puts every other task behind the stuck one
+    counting_task stuck;
+    stuck.count = &count;
+    stuck.release = &release;
+    pool.submit(&stuck);
+    std::vector<counting_task> tasks(100);
+    for (auto& t : tasks) {
+        t.count = &count;
+        pool.submit(&t);
+    }
+    wait_for(count, 100);
+    CHECK(count.load() == 100);
+    CHECK(pool.stats().stolen > 0);
+
+    release = true;
+    wait_for(count, 101);
+}
+
+TEST_CASE("work stealing pool pins its workers") {
+    agrpc::work_stealing_pool pool({.threads = 2, .pin = true});
+    std::atomic<int> count{0};
+    std::vector<counting_task> tasks(100);
+    for (auto& t : tasks) {
+        t.count = &count;
+        pool.submit(&t);
+    }
+    wait_for(count, 100);
+    wait_executed(pool, 100);
+    CHECK(pool.stats().executed == 100);
+}